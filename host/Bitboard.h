@@ -0,0 +1,374 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Bitboard engine (candidate)
+//
+// Same rules as Tetris.h, including its corner cases, on a 4 x 19 board
+// held as one 32-bit word per x column (bit y set = block). Checked against
+// the firmware engine tick by tick by host/equivalence.c.
+//
+// Corner cases kept from Tetris.h:
+//  - A new tetromino is not drawn until its first tick, and the first move
+//    or fall clears its cells even if locked blocks were there.
+//  - update_tetromino_location_struct bounds checks blocks 1-3 only.
+//  - remove_complete_rows only looks at rows 0-16 and leaves the top
+//    rows it shifted down from in place.
+//
+// Requires Game.h (INPUT_* codes) and Tetris.h (struct tetromino_location).
+// ---------------------------------------------------------------------------
+
+#ifndef _BITBOARD_H_
+#define _BITBOARD_H_
+
+#if LCD_PANELS > 1
+#error "Bitboard.h models the one panel 4 x 19 board, build without LCD_PANELS"
+#endif
+
+
+#define BITBOARD_ROWS 19
+#define BITBOARD_SCANNED_ROWS 0x1FFFF // Rows 0-16, as scanned by remove_complete_rows
+
+
+//Struct to hold state of one game on a bitboard
+typedef struct bitboard_game {
+
+	uint32_t columns[4]; // Bit y of columns[x] = block at x,y (falling tetromino included)
+
+	int8_t offset_x[4][3], offset_y[4][3]; // Block 1-3 offset from center block per orientation
+	int8_t orientation, center_x, center_y;
+	int8_t block_x[3], block_y[3];
+	int8_t ticks_left;
+	uint8_t rows_removed; // Rows removed by last bitboard_step, as tetris_rows_removed
+
+} bitboard_game;
+
+
+static int bitboard_fault; // Set to make remove_complete_rows scan all 19 rows (tests the harness)
+
+
+
+
+//---------------------------------------
+// Function: bitboard_spawn
+//
+// Description: Start tetromino described by t_loc_p (as filled by init_*_tetromino)
+//
+// Input: bitboard_game *bb,
+//        const struct tetromino_location *t_loc_p
+// Output: None
+//
+//---------------------------------------
+static void bitboard_spawn(bitboard_game *bb, const struct tetromino_location *t_loc_p)
+{
+	for (int o = 0; o < 4; o++) {
+		bb->offset_x[o][0] = t_loc_p->c_b1_x[o];
+		bb->offset_y[o][0] = t_loc_p->c_b1_y[o];
+		bb->offset_x[o][1] = t_loc_p->c_b2_x[o];
+		bb->offset_y[o][1] = t_loc_p->c_b2_y[o];
+		bb->offset_x[o][2] = t_loc_p->c_b3_x[o];
+		bb->offset_y[o][2] = t_loc_p->c_b3_y[o];
+	}
+
+	bb->orientation = t_loc_p->orientation;
+	bb->center_x = t_loc_p->center_x;
+	bb->center_y = t_loc_p->center_y;
+	for (int b = 0; b < 3; b++) {
+		bb->block_x[b] = 0;
+		bb->block_y[b] = 0;
+	}
+
+	bb->ticks_left = GAME_TICKS_PER_TETROMINO;
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_update_blocks
+//
+// Description: Same as update_tetromino_location_struct
+//
+// Input: bitboard_game *bb
+// Output: int
+//		  -1 = A block would be outside display, blocks unchanged
+//         0 = Blocks updated
+//
+//---------------------------------------
+static inline int bitboard_update_blocks(bitboard_game *bb)
+{
+	int8_t x[3], y[3];
+
+	for (int b = 0; b < 3; b++) {
+		x[b] = bb->center_x + bb->offset_x[bb->orientation][b];
+		y[b] = bb->center_y + bb->offset_y[bb->orientation][b];
+		if ((uint8_t)x[b] > 3 || (uint8_t)y[b] > BITBOARD_ROWS - 1) {
+			return -1;
+		}
+	}
+
+	for (int b = 0; b < 3; b++) {
+		bb->block_x[b] = x[b];
+		bb->block_y[b] = y[b];
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_place
+//
+// Description: Set (value = 1) or clear (value = 0) the 4 cells of the tetromino
+//
+// Input: bitboard_game *bb,
+//        int value
+// Output: None
+//
+//---------------------------------------
+static inline void bitboard_place(bitboard_game *bb, int value)
+{
+	if (value) {
+		bb->columns[bb->center_x] |= 1u << bb->center_y;
+		for (int b = 0; b < 3; b++) {
+			bb->columns[bb->block_x[b]] |= 1u << bb->block_y[b];
+		}
+	}
+	else {
+		bb->columns[bb->center_x] &= ~(1u << bb->center_y);
+		for (int b = 0; b < 3; b++) {
+			bb->columns[bb->block_x[b]] &= ~(1u << bb->block_y[b]);
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_valid
+//
+// Description: Same as valid_tetromino_location
+//
+// Input: bitboard_game *bb
+// Output: int
+//		  < 0 = Invalid location (same codes as valid_tetromino_location)
+//         0 = Valid location
+//
+//---------------------------------------
+static inline int bitboard_valid(bitboard_game *bb)
+{
+	if ((bb->center_x < 0) | (bb->block_x[0] < 0) | (bb->block_x[1] < 0) | (bb->block_x[2] < 0)) {
+		return -1;
+	}
+	if ((bb->center_x > 3) | (bb->block_x[0] > 3) | (bb->block_x[1] > 3) | (bb->block_x[2] > 3)) {
+		return -2;
+	}
+	if ((bb->center_y < 0) | (bb->block_y[0] < 0) | (bb->block_x[1] < 0) | (bb->block_y[2] < 0)) {
+		return -3; // Block 2 x, as in valid_tetromino_location
+	}
+	if (((bb->columns[bb->center_x] >> bb->center_y) | (bb->columns[bb->block_x[0]] >> bb->block_y[0]) |
+	(bb->columns[bb->block_x[1]] >> bb->block_y[1]) | (bb->columns[bb->block_x[2]] >> bb->block_y[2])) & 1) {
+		return -4;
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_on_floor
+//
+// Description: Check if any of the 4 blocks is in row 0
+//
+// Input: bitboard_game *bb
+// Output: int
+//
+//---------------------------------------
+static inline int bitboard_on_floor(bitboard_game *bb)
+{
+	return (bb->center_y == 0) | (bb->block_y[0] == 0) | (bb->block_y[1] == 0) | (bb->block_y[2] == 0);
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_shift
+//
+// Description: Same as move_tetromino (direction dx, dy) and rotate_tetromino (rotate = 1)
+//
+// Input: bitboard_game *bb,
+//        int dx,
+//        int dy,
+//        int rotate
+// Output: int
+//		  Same codes as move_tetromino
+//
+//---------------------------------------
+static int bitboard_shift(bitboard_game *bb, int dx, int dy, int rotate)
+{
+	if (bitboard_on_floor(bb)) {
+		return -1;
+	}
+
+	bitboard_place(bb, 0);
+
+	bb->center_x += dx;
+	bb->center_y += dy;
+	bb->orientation = (bb->orientation + (rotate ? 3 : 0)) & 3;
+
+	int rc = bitboard_update_blocks(bb);
+	if (rc == 0) {
+		rc = bitboard_valid(bb);
+		if (rc == 0) {
+			bitboard_place(bb, 1);
+			return 0;
+		}
+		rc = -2;
+	}
+	else {
+		rc = -3;
+	}
+
+	bb->center_x -= dx;
+	bb->center_y -= dy;
+	bb->orientation = (bb->orientation + (rotate ? 1 : 0)) & 3;
+	bitboard_update_blocks(bb);
+	bitboard_place(bb, 1);
+	return rc;
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_fall
+//
+// Description: Same as update_tetris_state
+//
+// Input: bitboard_game *bb
+// Output: int
+//		  Same codes as update_tetris_state
+//
+//---------------------------------------
+static int bitboard_fall(bitboard_game *bb)
+{
+	if (!((bb->center_y > 0) && (bb->block_y[0] > 0) && (bb->block_y[1] > 0) && (bb->block_y[2] > 0))) {
+		return -2;
+	}
+
+	bitboard_place(bb, 0);
+	bb->center_y -= 1;
+	bitboard_update_blocks(bb);
+
+	if (bitboard_valid(bb) >= 0) {
+		bitboard_place(bb, 1);
+		return 0;
+	}
+
+	bb->center_y += 1;
+	bitboard_update_blocks(bb);
+	bitboard_place(bb, 1);
+	return -1;
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_remove_complete_rows
+//
+// Description: Same as remove_complete_rows: compact the rows of 0-16 that are not complete down to row 0, rows above them are left as they were
+//
+// Input: bitboard_game *bb
+// Output: int
+//		  Number of rows removed
+//
+//---------------------------------------
+static int bitboard_remove_complete_rows(bitboard_game *bb)
+{
+	uint32_t scanned = bitboard_fault ? (1u << BITBOARD_ROWS) - 1 : BITBOARD_SCANNED_ROWS;
+	uint32_t full = bb->columns[0] & bb->columns[1] & bb->columns[2] & bb->columns[3] & scanned;
+
+	if (!full) {
+		return 0;
+	}
+
+	uint32_t keep = scanned & ~full;
+	int kept = __builtin_popcount(keep);
+
+	for (int x = 0; x < 4; x++) {
+		uint32_t packed = 0;
+		int n = 0;
+
+		for (uint32_t m = keep; m; m &= m - 1, n++) {
+			if (bb->columns[x] & m & -m) {
+				packed |= 1u << n;
+			}
+		}
+		bb->columns[x] = packed | (bb->columns[x] & ~((1u << kept) - 1));
+	}
+
+	return __builtin_popcount(full);
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_render
+//
+// Description: Character codes sent to the LCD, same as rows 4-5 of tetris_state after update_2_row_tetris_state
+//
+// Input: bitboard_game *bb,
+//        uint8_t lcd[2][19]
+// Output: None
+//
+//---------------------------------------
+static inline void bitboard_render(bitboard_game *bb, uint8_t lcd[2][BITBOARD_ROWS])
+{
+	for (int i = 0; i < 2; i++) {
+		uint32_t top = bb->columns[2 * i];
+		uint32_t bottom = bb->columns[2 * i + 1];
+
+		for (int j = 0; j < BITBOARD_ROWS; j++) {
+			lcd[i][j] = ((top >> j) & 1) | (((bottom >> j) & 1) << 1);
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: bitboard_step
+//
+// Description: Same as game_step: joystick_update, then update_tetris_state and remove_complete_rows once landed
+//
+// Input: bitboard_game *bb,
+//        uint8_t input
+// Output: int
+//		  Same codes as game_step
+//
+//---------------------------------------
+static int bitboard_step(bitboard_game *bb, uint8_t input)
+{
+	if ((input & INPUT_X_MASK) == INPUT_LEFT) bitboard_shift(bb, -1, 0, 0);
+	if ((input & INPUT_X_MASK) == INPUT_RIGHT) bitboard_shift(bb, 1, 0, 0);
+	if ((input & INPUT_Y_MASK) == INPUT_DOWN) bitboard_shift(bb, 0, -1, 0);
+	if ((input & INPUT_Y_MASK) == INPUT_ROTATE) bitboard_shift(bb, 0, 0, 1);
+
+	int rc = bitboard_fall(bb);
+	bb->rows_removed = rc != 0 ? bitboard_remove_complete_rows(bb) : 0;
+
+	if (rc == 0 && --bb->ticks_left > 0) {
+		return 0;
+	}
+
+	return ((bb->columns[0] | bb->columns[1] | bb->columns[2] | bb->columns[3]) >> 15) & 1 ? -2 : -1;
+}
+
+
+#endif // _BITBOARD_H_
@@ -0,0 +1,159 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Tick-by-tick driver for the firmware engine on the host
+//
+// Tetris() and load_tetromino block until the game ends. tetris_game holds
+// the same state they keep on the stack so host programs can advance the
+// real engine one tick at a time with a chosen joystick input, following
+// the same rules: at most TETRIS_TICKS_PER_TETROMINO ticks per tetromino
+// and a new game once a block is left in row TETRIS_TOP_ROW (30 ticks and
+// row 15 with one panel).
+//
+// Requires avr_host.h, LCD1602.h and Tetris.h to be included first.
+// ---------------------------------------------------------------------------
+
+#ifndef _GAME_H_
+#define _GAME_H_
+
+
+//Joystick input for one tick: X action in bits 0-1, Y action in bits 2-3
+#define INPUT_NONE 0x00
+#define INPUT_LEFT 0x01
+#define INPUT_RIGHT 0x02
+#define INPUT_DOWN 0x04
+#define INPUT_ROTATE 0x08
+#define INPUT_X_MASK 0x03
+#define INPUT_Y_MASK 0x0C
+
+
+#define GAME_TICKS_PER_TETROMINO TETRIS_TICKS_PER_TETROMINO // Loop count in load_tetromino
+
+
+//Struct to hold state of one game
+typedef struct tetris_game {
+
+	uint8_t tetris_state[6][TETRIS_ROWS];
+	struct tetromino_location t_loc; // Falling tetromino
+	int ticks_left; // Ticks till load_tetromino gives up on falling tetromino
+
+	unsigned long ticks, pieces, games;
+
+} tetris_game;
+
+
+
+
+//---------------------------------------
+// Function: game_input
+//
+// Description: Set joystick ADC channels so joystick_update reads the given input
+//
+// Input: uint8_t input
+// Output: None
+//
+//---------------------------------------
+static inline void game_input(uint8_t input)
+{
+	uint16_t x_val = 512;
+	uint16_t y_val = 512;
+
+	if ((input & INPUT_X_MASK) == INPUT_LEFT) x_val = 0;
+	if ((input & INPUT_X_MASK) == INPUT_RIGHT) x_val = 1023;
+	if ((input & INPUT_Y_MASK) == INPUT_DOWN) y_val = 0;
+	if ((input & INPUT_Y_MASK) == INPUT_ROTATE) y_val = 1023;
+
+	host_joystick(x_val, y_val);
+}
+
+
+
+
+//---------------------------------------
+// Function: game_spawn
+//
+// Description: Start a tetromino the way load_tetromino does
+//
+// Input: tetris_game *game,
+//        const struct tetromino_location *t_loc_p
+// Output: None
+//
+//---------------------------------------
+static void game_spawn(tetris_game *game, const struct tetromino_location *t_loc_p)
+{
+	game->t_loc = *t_loc_p;
+	update_tetromino_location_struct(&game->t_loc);
+	game->ticks_left = GAME_TICKS_PER_TETROMINO;
+}
+
+
+
+
+//---------------------------------------
+// Function: game_reset
+//
+// Description: Empty tetris_state (start of Tetris()) and spawn t_loc_p
+//
+// Input: tetris_game *game,
+//        const struct tetromino_location *t_loc_p
+// Output: None
+//
+//---------------------------------------
+static void game_reset(tetris_game *game, const struct tetromino_location *t_loc_p)
+{
+	memset(game->tetris_state, 0, sizeof(game->tetris_state));
+	game->games++;
+	game_spawn(game, t_loc_p);
+}
+
+
+
+
+//---------------------------------------
+// Function: game_topped_out
+//
+// Description: Check for a block in row TETRIS_TOP_ROW, which ends Tetris()
+//
+// Input: tetris_game *game
+// Output: int
+//
+//---------------------------------------
+static inline int game_topped_out(tetris_game *game)
+{
+	return (game->tetris_state[0][TETRIS_TOP_ROW] != 0x00) | (game->tetris_state[1][TETRIS_TOP_ROW] != 0x00) |
+		(game->tetris_state[2][TETRIS_TOP_ROW] != 0x00) | (game->tetris_state[3][TETRIS_TOP_ROW] != 0x00);
+}
+
+
+
+
+//---------------------------------------
+// Function: game_step
+//
+// Description: Run one tetris_tick with the given joystick input. The caller spawns the next tetromino (game_spawn, or game_reset after game over)
+//
+// Input: tetris_game *game,
+//        uint8_t input
+// Output: int
+//		  -2 = Tetromino finished and a block is in row TETRIS_TOP_ROW (game over)
+//		  -1 = Tetromino finished (landed or ran out of ticks)
+//         0 = Tetromino still falling
+//
+//---------------------------------------
+static int game_step(tetris_game *game, uint8_t input)
+{
+	game_input(input);
+	game->ticks++;
+
+	int rc = tetris_tick(TETRIS_ROWS, game->tetris_state, &game->t_loc);
+
+	if (rc == 0 && --game->ticks_left > 0) {
+		return 0;
+	}
+
+	game->pieces++;
+	return game_topped_out(game) ? -2 : -1;
+}
+
+
+#endif // _GAME_H_
@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Environment API for training agents on the host
+//
+// Each gym_env is one game on the bitboard engine (Bitboard.h, checked tick
+// for tick against Tetris.h), with its own tetromino generator (Rand.h), so
+// environments do not share state and can be stepped from any thread.
+// Environments and observations are plain structs the caller lays out in
+// contiguous arrays; nothing is allocated after gym_init.
+//
+// Two action spaces:
+//   step   one tick with a joystick input (gym_inputs: what joystick_update
+//          reads), the tetromino falls one row per tick as on the device
+//   place  one tetromino: orientation * 4 + center column (as MoveGen.h),
+//          dropped from the spawn row. A placement MoveGen.h does not list
+//          as legal is played out with no input instead and counted
+// Reward is the number of rows removed; an episode ends when a block is
+// left in row 15 (game over on the device). gym_step_batch starts the next
+// episode of a finished environment itself.
+//
+// Implemented in gym.c, which can be built into a shared library:
+//   gcc -O2 -fPIC -shared -o libtetris_gym.so host/gym.c
+// This header does not need the firmware headers and can be used from C++.
+// ---------------------------------------------------------------------------
+
+#ifndef _GYM_H_
+#define _GYM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define GYM_ACTIONS 9 // Joystick inputs, index into gym_inputs
+#define GYM_PLACEMENTS 16 // Orientation * 4 + center column
+#define GYM_ROWS 19 // Bits used in gym_obs.board words
+
+#define GYM_ENGINE_WORDS 13 // Size of the engine state in gym_env, checked in gym.c
+
+
+//Observation after reset or step
+typedef struct gym_obs {
+
+	uint32_t board[4]; // Bit y of board[x] = block at x,y, falling tetromino included once it has fallen a tick
+	uint8_t piece; // Falling tetromino type: 0 I, 1 O, 2 T, 3 S, 4 Z, 5 J, 6 L
+	uint8_t orientation;
+	int8_t x, y; // Center block
+
+} gym_obs;
+
+
+//One environment
+typedef struct gym_env {
+
+	uint32_t engine[GYM_ENGINE_WORDS]; // bitboard_game, private to gym.c
+	uint32_t rng; // host_rand_r state
+	uint32_t seed; // Seed of this episode
+	uint32_t ticks, pieces, rows; // This episode
+	uint32_t episodes, illegal; // Since gym_reset (illegal placements)
+	uint8_t piece;
+	uint8_t piece_ticks; // Ticks the falling tetromino has been stepped
+
+} gym_env;
+
+
+//Game.h joystick input for each step action: none, left, right, down, rotate, left + down, right + down,
+//left + rotate, right + rotate
+extern const uint8_t gym_inputs[GYM_ACTIONS];
+
+
+void gym_init(void);
+void gym_reset(gym_env *env, uint32_t seed, gym_obs *obs);
+int gym_step(gym_env *env, int action, gym_obs *obs, int *reward);
+int gym_place(gym_env *env, int placement, gym_obs *obs, int *reward);
+uint16_t gym_legal_placements(const gym_env *env);
+void gym_step_batch(gym_env *envs, const uint8_t *actions, size_t count, int placement, gym_obs *obs, int8_t *rewards,
+	uint8_t *dones);
+long gym_check(uint32_t seed, long ticks);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _GYM_H_
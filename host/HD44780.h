@@ -0,0 +1,598 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host model of the HD44780 controller on the LCD1602 module
+//
+// Watches every write to PORTB and PORTC through host_port_hook and latches
+// a nibble from D7-D4 on each falling edge of the Enable pin, timing the
+// pulse from the rising edge, so a pulse without a delay in between is seen
+// (and flagged as shorter than PW_EH). Implements DDRAM, CGRAM, the
+// address counter, entry mode, display/cursor shift and the 8-bit/4-bit
+// interface switch used by LCD_init, and checks every nibble against the
+// execution time of the previous instruction, the power on wait (virtual
+// time 0 is power on) and the waits after the first two function sets of
+// initializing by instruction.
+//
+// Built with LCD_PANELS there is one controller per panel in host_lcds,
+// each latching on its own Enable pin (panel 0 on PORTB, the others on
+// PORTC) from the shared RS and D7-D4 lines.
+//
+// Requires LCD1602.h (pin numbers) to be included first.
+// ---------------------------------------------------------------------------
+
+#ifndef _HD44780_H_
+#define _HD44780_H_
+
+
+//Instruction execution times at fosc = 270 kHz (HD44780U datasheet, table 6)
+#define HD44780_EXEC_NS 37000ULL // Most instructions
+#define HD44780_WRITE_NS 41000ULL // Data write, 37 us + tADD
+#define HD44780_CLEAR_NS 1520000ULL // Clear display and return home
+#define HD44780_POWER_ON_NS 40000000ULL // Wait after VCC rises to 2.7 V
+#define HD44780_INIT_1_NS 4100000ULL // Wait after first function set in 8-bit mode
+#define HD44780_INIT_2_NS 100000ULL // Wait after second function set in 8-bit mode
+#define HD44780_PW_EH_NS 230ULL // Minimum Enable pulse width high (bus timing, VCC = 5 V)
+
+#define HD44780_LINE_LENGTH 40 // DDRAM characters per line in 2 line mode
+#define HD44780_VISIBLE 16 // Characters shown per line on LCD1602
+
+
+//Struct to hold controller state and bus statistics
+typedef struct hd44780 {
+
+	uint8_t ddram[0x80]; // Line 0 at 0x00-0x27, line 1 at 0x40-0x67
+	uint8_t cgram[0x40]; // 8 custom characters x 8 rows
+
+	uint8_t address_counter;
+	uint8_t cgram_selected; // 1 = data writes go to CGRAM
+	uint8_t increment; // Entry mode I/D
+	uint8_t entry_shift; // Entry mode S
+	uint8_t display_on, cursor_on, blink_on;
+	uint8_t four_bit, two_line;
+	uint8_t display_shift; // Leftmost visible DDRAM column (0-39)
+
+	uint8_t nibble_pending; // 4-bit mode: high nibble received, waiting for low nibble
+	uint8_t init_function_sets; // 8-bit mode function sets received, up to 2
+	uint8_t nibble_high;
+
+	uint64_t busy_until_ns; // Controller busy executing last instruction until this time
+	uint64_t enable_rise_ns; // Enable pin went high at this time
+
+	unsigned long nibbles, commands, data_bytes;
+	unsigned long violations; // Nibbles latched while controller was still busy
+	uint64_t worst_violation_ns; // Largest amount a nibble was latched too early
+	unsigned long short_pulses; // Enable pulses shorter than PW_EH, also counted as violations
+
+	uint64_t frame_start_ns;
+	unsigned long frame_nibble_start;
+	unsigned long frames;
+	uint64_t frame_last_ns, frame_min_ns, frame_max_ns, frame_total_ns;
+	unsigned long frame_last_bytes;
+
+	uint8_t visible[2 * HD44780_VISIBLE]; // Character codes on screen after last instruction
+	unsigned long screen_updates; // Instructions that changed what is on screen
+	unsigned long frame_update_start;
+	unsigned long frame_last_updates, frame_max_updates, frame_total_updates;
+
+} hd44780;
+
+
+static hd44780 host_lcds[LCD_PANELS];
+#define host_lcd (host_lcds[0]) // Panel 0, the only one without LCD_PANELS
+
+
+
+
+//---------------------------------------
+// Function: hd44780_reset
+//
+// Description: Put controller in its internal reset state (8-bit interface, 1 line, display off, increment), just powered on
+//
+// Input: hd44780 *lcd
+// Output: None
+//
+//---------------------------------------
+static void hd44780_reset(hd44780 *lcd)
+{
+	memset(lcd, 0, sizeof(*lcd));
+	memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+	memset(lcd->visible, ' ', sizeof(lcd->visible));
+	lcd->increment = 1;
+	lcd->frame_min_ns = UINT64_MAX;
+	lcd->busy_until_ns = HD44780_POWER_ON_NS;
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_ddram_step
+//
+// Description: Move DDRAM address counter one position, wrapping the way the controller does for the current line mode
+//
+// Input: uint8_t address,
+//        int increment,
+//        int two_line
+// Output: uint8_t
+//
+//---------------------------------------
+static uint8_t hd44780_ddram_step(uint8_t address, int increment, int two_line)
+{
+	if (!two_line) {
+		return increment ? (address + 1) % 0x50 : (address + 0x4F) % 0x50;
+	}
+
+	if (increment) {
+		if (address == 0x27) {
+			return 0x40;
+		}
+		if (address == 0x67) {
+			return 0x00;
+		}
+		return address + 1;
+	}
+
+	if (address == 0x00) {
+		return 0x67;
+	}
+	if (address == 0x40) {
+		return 0x27;
+	}
+	return address - 1;
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_move_address
+//
+// Description: Increment or decrement address counter after a data write or cursor shift
+//
+// Input: hd44780 *lcd,
+//        int increment
+// Output: None
+//
+//---------------------------------------
+static void hd44780_move_address(hd44780 *lcd, int increment)
+{
+	if (lcd->cgram_selected) {
+		lcd->address_counter = (lcd->address_counter + (increment ? 1 : 0x3F)) & 0x3F;
+	}
+	else {
+		lcd->address_counter = hd44780_ddram_step(lcd->address_counter, increment, lcd->two_line);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_shift_display
+//
+// Description: Shift visible window of DDRAM one column
+//
+// Input: hd44780 *lcd,
+//        int right
+// Output: None
+//
+//---------------------------------------
+static void hd44780_shift_display(hd44780 *lcd, int right)
+{
+	if (right) {
+		lcd->display_shift = (lcd->display_shift + HD44780_LINE_LENGTH - 1) % HD44780_LINE_LENGTH;
+	}
+	else {
+		lcd->display_shift = (lcd->display_shift + 1) % HD44780_LINE_LENGTH;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_execute
+//
+// Description: Execute a complete instruction (RS = 0) or data write (RS = 1)
+//
+// Input: hd44780 *lcd,
+//        int rs,
+//        uint8_t value
+// Output: uint64_t
+//		  Execution time of instruction in nanoseconds
+//
+//---------------------------------------
+static uint64_t hd44780_execute(hd44780 *lcd, int rs, uint8_t value)
+{
+	if (rs) {
+		lcd->data_bytes++;
+
+		if (lcd->cgram_selected) {
+			lcd->cgram[lcd->address_counter & 0x3F] = value & 0x1F;
+		}
+		else {
+			lcd->ddram[lcd->address_counter & 0x7F] = value;
+			if (lcd->entry_shift) {
+				hd44780_shift_display(lcd, !lcd->increment);
+			}
+		}
+
+		hd44780_move_address(lcd, lcd->increment);
+		return HD44780_WRITE_NS;
+	}
+
+	lcd->commands++;
+
+	if (value & 0x80) { // Set DDRAM address
+		lcd->cgram_selected = 0;
+		lcd->address_counter = value & 0x7F;
+	}
+	else if (value & 0x40) { // Set CGRAM address
+		lcd->cgram_selected = 1;
+		lcd->address_counter = value & 0x3F;
+	}
+	else if (value & 0x20) { // Function set
+		lcd->four_bit = !(value & 0x10);
+		lcd->two_line = (value & 0x08) != 0;
+	}
+	else if (value & 0x10) { // Cursor or display shift
+		if (value & 0x08) {
+			hd44780_shift_display(lcd, (value & 0x04) != 0);
+		}
+		else {
+			hd44780_move_address(lcd, (value & 0x04) != 0);
+		}
+	}
+	else if (value & 0x08) { // Display on/off control
+		lcd->display_on = (value & 0x04) != 0;
+		lcd->cursor_on = (value & 0x02) != 0;
+		lcd->blink_on = (value & 0x01) != 0;
+	}
+	else if (value & 0x04) { // Entry mode set
+		lcd->increment = (value & 0x02) != 0;
+		lcd->entry_shift = (value & 0x01) != 0;
+	}
+	else if (value & 0x02) { // Return home
+		lcd->cgram_selected = 0;
+		lcd->address_counter = 0;
+		lcd->display_shift = 0;
+		return HD44780_CLEAR_NS;
+	}
+	else if (value & 0x01) { // Clear display
+		memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+		lcd->cgram_selected = 0;
+		lcd->address_counter = 0;
+		lcd->display_shift = 0;
+		lcd->increment = 1;
+		return HD44780_CLEAR_NS;
+	}
+
+	return HD44780_EXEC_NS;
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_track_screen
+//
+// Description: Count an update if the last instruction changed any character on screen. A frame drawn in place shows up as many updates (tearing), one that sends only the changed characters (LCD_PANELS) as few
+//
+// Input: hd44780 *lcd
+// Output: None
+//
+//---------------------------------------
+static void hd44780_track_screen(hd44780 *lcd)
+{
+	uint8_t visible[2 * HD44780_VISIBLE];
+
+	for (int line = 0; line < 2; line++) {
+		for (int i = 0; i < HD44780_VISIBLE; i++) {
+			visible[line * HD44780_VISIBLE + i] = lcd->ddram[line * 0x40 + (lcd->display_shift + i) % HD44780_LINE_LENGTH];
+		}
+	}
+
+	if (memcmp(visible, lcd->visible, sizeof(visible)) != 0) {
+		memcpy(lcd->visible, visible, sizeof(visible));
+		lcd->screen_updates++;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_strobe
+//
+// Description: Latch one nibble from D7-D4 on falling edge of Enable and execute instruction once complete. A pulse
+//              shorter than PW_EH is a violation too
+//
+// Input: hd44780 *lcd,
+//        uint8_t port, (PORTB while Enable is high)
+//        uint64_t rise_ns,
+//        uint64_t fall_ns
+// Output: None
+//
+//---------------------------------------
+static void hd44780_strobe(hd44780 *lcd, uint8_t port, uint64_t rise_ns, uint64_t fall_ns)
+{
+	uint8_t nibble = 0;
+	int rs = (port >> RS) & 1;
+
+	if (port & (1 << D4)) nibble |= 0x1;
+	if (port & (1 << D5)) nibble |= 0x2;
+	if (port & (1 << D6)) nibble |= 0x4;
+	if (port & (1 << D7)) nibble |= 0x8;
+
+	lcd->nibbles++;
+
+	if (fall_ns - rise_ns < HD44780_PW_EH_NS) {
+		lcd->short_pulses++;
+		lcd->violations++;
+	}
+
+	// Nibble is latched on falling edge of Enable, so that is when the controller must be idle
+	if (fall_ns < lcd->busy_until_ns) {
+		lcd->violations++;
+		if (lcd->busy_until_ns - fall_ns > lcd->worst_violation_ns) {
+			lcd->worst_violation_ns = lcd->busy_until_ns - fall_ns;
+		}
+	}
+
+	if (!lcd->four_bit) {
+		// 8-bit interface: D3-D0 are not connected, each nibble is a full instruction
+		uint64_t exec_ns = hd44780_execute(lcd, rs, nibble << 4);
+		if (!rs && nibble == 0x3 && lcd->init_function_sets < 2) {
+			exec_ns = lcd->init_function_sets++ ? HD44780_INIT_2_NS : HD44780_INIT_1_NS;
+		}
+		lcd->busy_until_ns = fall_ns + exec_ns;
+		hd44780_track_screen(lcd);
+		return;
+	}
+
+	if (!lcd->nibble_pending) {
+		lcd->nibble_pending = 1;
+		lcd->nibble_high = nibble;
+		return;
+	}
+
+	lcd->nibble_pending = 0;
+	lcd->busy_until_ns = fall_ns + hd44780_execute(lcd, rs, (lcd->nibble_high << 4) | nibble);
+	hd44780_track_screen(lcd);
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_panel_enabled
+//
+// Description: Check the Enable pin of a panel
+//
+// Input: int panel,
+//        uint8_t portb,
+//        uint8_t portc
+// Output: int
+//
+//---------------------------------------
+static int hd44780_panel_enabled(int panel, uint8_t portb, uint8_t portc)
+{
+	if (panel == 0) {
+		return (portb & (1 << ENABLE)) != 0;
+	}
+	return (portc & (1 << (LCD_PANEL_ENABLE_FIRST + panel - 1))) != 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_port_hook
+//
+// Description: host_port_hook for the LCDs. A rising edge on a panel's Enable pin starts a pulse, a falling edge
+//              latches the nibble that was on the bus while it was high
+//
+// Input: uint8_t portb_was,
+//        uint8_t portc_was
+// Output: None
+//
+//---------------------------------------
+static void hd44780_port_hook(uint8_t portb_was, uint8_t portc_was)
+{
+	for (int panel = 0; panel < LCD_PANELS; panel++) {
+		int was = hd44780_panel_enabled(panel, portb_was, portc_was);
+		int now = hd44780_panel_enabled(panel, host_portb, host_portc);
+
+		if (!was && now) {
+			host_lcds[panel].enable_rise_ns = host_time_ns;
+		}
+		else if (was && !now) {
+			hd44780_strobe(&host_lcds[panel], portb_was, host_lcds[panel].enable_rise_ns, host_time_ns);
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_attach
+//
+// Description: Reset host_lcds and connect them to the host shim
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void hd44780_attach()
+{
+	for (int panel = 0; panel < LCD_PANELS; panel++) {
+		hd44780_reset(&host_lcds[panel]);
+	}
+	host_port_hook = hd44780_port_hook;
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_frame_begin
+//
+// Description: Mark start of a frame for bus time accounting
+//
+// Input: hd44780 *lcd
+// Output: None
+//
+//---------------------------------------
+static void hd44780_frame_begin(hd44780 *lcd)
+{
+	host_port_sync(); // Latch a pulse that ended with the last port write
+	lcd->frame_start_ns = host_time_ns;
+	lcd->frame_nibble_start = lcd->nibbles;
+	lcd->frame_update_start = lcd->screen_updates;
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_frame_end
+//
+// Description: Mark end of a frame and add its bus time to the frame statistics
+//
+// Input: hd44780 *lcd
+// Output: None
+//
+//---------------------------------------
+static void hd44780_frame_end(hd44780 *lcd)
+{
+	uint64_t elapsed = host_time_ns - lcd->frame_start_ns;
+
+	host_port_sync(); // Latch a pulse that ended with the last port write
+	lcd->frames++;
+	lcd->frame_last_ns = elapsed;
+	lcd->frame_last_bytes = (lcd->nibbles - lcd->frame_nibble_start) / 2;
+	lcd->frame_total_ns += elapsed;
+	lcd->frame_last_updates = lcd->screen_updates - lcd->frame_update_start;
+	lcd->frame_total_updates += lcd->frame_last_updates;
+
+	if (lcd->frame_last_updates > lcd->frame_max_updates) {
+		lcd->frame_max_updates = lcd->frame_last_updates;
+	}
+
+	if (elapsed < lcd->frame_min_ns) {
+		lcd->frame_min_ns = elapsed;
+	}
+	if (elapsed > lcd->frame_max_ns) {
+		lcd->frame_max_ns = elapsed;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_glyph
+//
+// Description: Text for one character cell. Custom characters are drawn as block elements from their CGRAM rows
+//
+// Input: hd44780 *lcd,
+//        uint8_t code
+// Output: const char *
+//
+//---------------------------------------
+static const char *hd44780_glyph(hd44780 *lcd, uint8_t code)
+{
+	static char ascii[2];
+
+	if (code < 0x10) {
+		const uint8_t *rows = &lcd->cgram[(code & 0x07) * 8];
+		int top = rows[0] | rows[1] | rows[2] | rows[3];
+		int bottom = rows[4] | rows[5] | rows[6] | rows[7];
+
+		if (top && bottom) return "\xE2\x96\x88"; // Full block
+		if (top) return "\xE2\x96\x80"; // Upper half block
+		if (bottom) return "\xE2\x96\x84"; // Lower half block
+		return " ";
+	}
+
+	ascii[0] = (code >= 0x20 && code < 0x7F) ? (char)code : '?';
+	return ascii;
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_render
+//
+// Description: Print the 16x2 visible windows (after display shift) of panels side by side, the first on the left,
+//              framed in one box
+//
+// Input: hd44780 *lcds,
+//        int panels,
+//        FILE *out
+// Output: None
+//
+//---------------------------------------
+static void hd44780_render(hd44780 *lcds, int panels, FILE *out)
+{
+	fputc('+', out);
+	for (int i = 0; i < panels * HD44780_VISIBLE; i++) {
+		fputc('-', out);
+	}
+	fprintf(out, "+%s\n", lcds[0].display_on ? "" : " (display off)");
+
+	for (int line = 0; line < 2; line++) {
+		fputc('|', out);
+		for (int panel = 0; panel < panels; panel++) {
+			hd44780 *lcd = &lcds[panel];
+
+			for (int i = 0; i < HD44780_VISIBLE; i++) {
+				uint8_t column = (lcd->display_shift + i) % HD44780_LINE_LENGTH;
+				fputs(hd44780_glyph(lcd, lcd->ddram[line * 0x40 + column]), out);
+			}
+		}
+		fputs("|\n", out);
+	}
+
+	fputc('+', out);
+	for (int i = 0; i < panels * HD44780_VISIBLE; i++) {
+		fputc('-', out);
+	}
+	fputs("+\n", out);
+}
+
+
+
+
+//---------------------------------------
+// Function: hd44780_report
+//
+// Description: Print bus statistics and timing violations
+//
+// Input: hd44780 *lcd,
+//        FILE *out
+// Output: None
+//
+//---------------------------------------
+static void hd44780_report(hd44780 *lcd, FILE *out)
+{
+	host_port_sync(); // Latch a pulse that ended with the last port write
+	fprintf(out, "nibbles %lu, commands %lu, data bytes %lu\n", lcd->nibbles, lcd->commands, lcd->data_bytes);
+	fprintf(out, "timing violations %lu (worst %.1f us early)\n", lcd->violations, lcd->worst_violation_ns / 1000.0);
+	if (lcd->short_pulses) {
+		fprintf(out, "Enable pulses shorter than %llu ns: %lu\n", HD44780_PW_EH_NS, lcd->short_pulses);
+	}
+
+	if (lcd->frames) {
+		fprintf(out, "frames %lu, bus time per frame: min %.1f us, avg %.1f us, max %.1f us, last %lu bytes\n",
+			lcd->frames, lcd->frame_min_ns / 1000.0, lcd->frame_total_ns / 1000.0 / lcd->frames,
+			lcd->frame_max_ns / 1000.0, lcd->frame_last_bytes);
+		fprintf(out, "screen updates per frame: avg %.1f, max %lu\n",
+			(double)lcd->frame_total_updates / lcd->frames, lcd->frame_max_updates);
+	}
+}
+
+
+#endif // _HD44780_H_
@@ -0,0 +1,404 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Batch legal-move generator
+//
+// For each board in a batch and the tetromino to place on it, finds all 16
+// moves (orientation 0-3 x center column 0-3): whether the move is legal,
+// the row the center block lands on when dropped straight down from the
+// spawn row, the rows it completes and the board after they are removed.
+// Boards are held as in Bitboard.h, one 32-bit word per x column (bit y set
+// = block). The piece shapes come from the init_*_tetromino tables.
+//
+// A move is legal when the tetromino fits at the spawn row in that
+// orientation and column and in every column between it and the spawn
+// column that it does not overhang. Completed rows are removed from all 19
+// rows and the top is refilled with empty rows (Tetris.h only looks at rows
+// 0-16; the two differ only once a block is at row 15, which ends the game).
+//
+// movegen_batch uses AVX2 (all 16 moves of a board side by side, 8 per
+// register) when the CPU has it and BMI2, and movegen_board_scalar
+// otherwise (always on CPUs other than x86). Call movegen_init once first.
+//
+// Requires avr_host.h and Tetris.h (init_tetromino) to be included first.
+// ---------------------------------------------------------------------------
+
+#ifndef _MOVEGEN_H_
+#define _MOVEGEN_H_
+
+#if LCD_PANELS > 1
+#error "MoveGen.h models the one panel 4 x 19 board, build without LCD_PANELS"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MOVEGEN_AVX2
+#endif
+
+
+#define MOVEGEN_PIECES TETROMINO_TYPES // Piece = init_tetromino type
+#define MOVEGEN_MOVES 16 // Move = orientation * 4 + center x
+#define MOVEGEN_SPAWN_X 2
+#define MOVEGEN_SPAWN_Y 16
+#define MOVEGEN_ROWS 19
+#define MOVEGEN_SPAWN_LOW 14 // Lowest block row of any tetromino at the spawn row
+
+
+//Struct to hold all moves of one tetromino on one board
+typedef struct movegen_result {
+
+	uint16_t legal; // Bit m set = move m is legal
+	int8_t landing_y[MOVEGEN_MOVES]; // Center block row after the drop, -1 for illegal moves
+	uint8_t lines[MOVEGEN_MOVES]; // Rows completed
+	uint32_t columns[4][MOVEGEN_MOVES]; // Board after the move, [x column][move] (unchanged for illegal moves)
+
+} movegen_result;
+
+
+//Tetromino blocks at the spawn row, [piece][x column][move]. All zero for moves that overhang the board
+static uint32_t movegen_spawn[MOVEGEN_PIECES][4][MOVEGEN_MOVES] __attribute__((aligned(32)));
+static uint16_t movegen_in_bounds[MOVEGEN_PIECES]; // Bit m set = move m does not overhang
+static uint8_t movegen_path[16]; // Columns 0-3 whose path from the spawn column is clear, by columns clear
+
+
+
+
+//---------------------------------------
+// Function: movegen_init
+//
+// Description: Build movegen_spawn and movegen_in_bounds from the init_*_tetromino tables, and movegen_path
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void movegen_init()
+{
+	for (int clear = 0; clear < 16; clear++) {
+		movegen_path[clear] = 0;
+		for (int x = 0; x < 4; x++) {
+			int lo = x < MOVEGEN_SPAWN_X ? x : MOVEGEN_SPAWN_X;
+			int hi = x < MOVEGEN_SPAWN_X ? MOVEGEN_SPAWN_X : x;
+			int span = ((1 << (hi + 1)) - 1) & ~((1 << lo) - 1);
+			if ((clear & span) == span) {
+				movegen_path[clear] |= 1 << x;
+			}
+		}
+	}
+
+	for (int p = 0; p < MOVEGEN_PIECES; p++) {
+		struct tetromino_location t_loc;
+		init_tetromino(p, &t_loc);
+
+		movegen_in_bounds[p] = 0;
+		for (int m = 0; m < MOVEGEN_MOVES; m++) {
+			int o = m / 4;
+			int dx[4] = {0, t_loc.c_b1_x[o], t_loc.c_b2_x[o], t_loc.c_b3_x[o]};
+			int dy[4] = {0, t_loc.c_b1_y[o], t_loc.c_b2_y[o], t_loc.c_b3_y[o]};
+			uint32_t spawn[4] = {0, 0, 0, 0};
+			int in_bounds = 1;
+
+			for (int b = 0; b < 4; b++) {
+				int x = m % 4 + dx[b];
+				int y = MOVEGEN_SPAWN_Y + dy[b];
+				if (x < 0 || x > 3 || y < 0 || y >= MOVEGEN_ROWS) {
+					in_bounds = 0;
+					break;
+				}
+				spawn[x] |= 1u << y;
+			}
+
+			for (int x = 0; x < 4; x++) {
+				movegen_spawn[p][x][m] = in_bounds ? spawn[x] : 0;
+			}
+			movegen_in_bounds[p] |= in_bounds << m;
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: movegen_reachable
+//
+// Description: Legal moves from the moves that fit at the spawn row: each column between the move and the spawn column
+//              must fit too, unless the tetromino would overhang there
+//
+// Input: uint16_t fits,
+//        uint16_t in_bounds
+// Output: uint16_t
+//
+//---------------------------------------
+static inline uint16_t movegen_reachable(uint16_t fits, uint16_t in_bounds)
+{
+	uint16_t clear = fits | ~in_bounds; // Per orientation nibble: columns that fit or are overhung
+	uint16_t legal = 0;
+
+	for (int o = 0; o < 4; o++) {
+		legal |= movegen_path[(clear >> (4 * o)) & 0xF] << (4 * o);
+	}
+	return legal & fits;
+}
+
+
+
+
+//---------------------------------------
+// Function: movegen_compact
+//
+// Description: Remove the rows set in full from a column, moving the rows above them down
+//
+// Input: uint32_t column,
+//        uint32_t full
+// Output: uint32_t
+//
+//---------------------------------------
+static inline uint32_t movegen_compact(uint32_t column, uint32_t full)
+{
+	uint32_t packed = 0;
+	int n = 0;
+
+	for (uint32_t keep = ((1u << MOVEGEN_ROWS) - 1) & ~full; keep; keep &= keep - 1, n++) {
+		if (column & keep & -keep) {
+			packed |= 1u << n;
+		}
+	}
+	return packed;
+}
+
+
+
+
+//---------------------------------------
+// Function: movegen_free_fall
+//
+// Description: Rows every tetromino can fall from the spawn row before it can touch a block
+//
+// Input: const uint32_t board[4]
+// Output: int
+//
+//---------------------------------------
+static inline int movegen_free_fall(const uint32_t board[4])
+{
+	uint32_t stack = board[0] | board[1] | board[2] | board[3];
+	int height = stack ? 32 - __builtin_clz(stack) : 0; // First empty row above all blocks
+
+	return height < MOVEGEN_SPAWN_LOW ? MOVEGEN_SPAWN_LOW - height : 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: movegen_board_scalar
+//
+// Description: All moves of piece on board, one move at a time
+//
+// Input: const uint32_t board[4],
+//        int piece,
+//        movegen_result *r
+// Output: None
+//
+//---------------------------------------
+static void movegen_board_scalar(const uint32_t board[4], int piece, movegen_result *r)
+{
+	int free_fall = movegen_free_fall(board);
+	uint16_t fits = 0;
+
+	for (int m = 0; m < MOVEGEN_MOVES; m++) {
+		uint32_t pos[4];
+		int y = MOVEGEN_SPAWN_Y;
+
+		for (int x = 0; x < 4; x++) {
+			pos[x] = movegen_spawn[piece][x][m];
+		}
+
+		if (((movegen_in_bounds[piece] >> m) & 1) &&
+		!((board[0] & pos[0]) | (board[1] & pos[1]) | (board[2] & pos[2]) | (board[3] & pos[3]))) {
+			fits |= 1 << m;
+
+			for (int x = 0; x < 4; x++) {
+				pos[x] >>= free_fall;
+			}
+			y -= free_fall;
+
+			// Drop till a block is on row 0 or the next row down is taken
+			while (!((pos[0] | pos[1] | pos[2] | pos[3]) & 1) &&
+			!((board[0] & pos[0] >> 1) | (board[1] & pos[1] >> 1) | (board[2] & pos[2] >> 1) | (board[3] & pos[3] >> 1))) {
+				for (int x = 0; x < 4; x++) {
+					pos[x] >>= 1;
+				}
+				y--;
+			}
+		}
+
+		uint32_t full = (board[0] | pos[0]) & (board[1] | pos[1]) & (board[2] | pos[2]) & (board[3] | pos[3]);
+
+		r->landing_y[m] = y;
+		r->lines[m] = __builtin_popcount(full);
+		for (int x = 0; x < 4; x++) {
+			r->columns[x][m] = full ? movegen_compact(board[x] | pos[x], full) : board[x] | pos[x];
+		}
+	}
+
+	r->legal = movegen_reachable(fits, movegen_in_bounds[piece]);
+
+	for (int m = 0; m < MOVEGEN_MOVES; m++) {
+		if (!((r->legal >> m) & 1)) {
+			r->landing_y[m] = -1;
+			r->lines[m] = 0;
+			for (int x = 0; x < 4; x++) {
+				r->columns[x][m] = board[x];
+			}
+		}
+	}
+}
+
+
+
+
+#ifdef MOVEGEN_AVX2
+//---------------------------------------
+// Function: movegen_board_avx2
+//
+// Description: All moves of piece on board, 8 moves per AVX2 register: all legal moves fall clear of the stack at once, then every
+//              move that can still fall drops one row per step
+//
+// Input: const uint32_t board[4],
+//        int piece,
+//        movegen_result *r
+// Output: None
+//
+//---------------------------------------
+__attribute__((target("avx2,bmi2")))
+static void movegen_board_avx2(const uint32_t board[4], int piece, movegen_result *r)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i all = _mm256_set1_epi32(-1);
+	int free_fall = movegen_free_fall(board);
+	__m256i b[4], pos[4][2], legal[2], falling[2], y[2];
+	uint32_t full[MOVEGEN_MOVES] __attribute__((aligned(32)));
+	uint16_t fits = 0;
+
+	for (int x = 0; x < 4; x++) {
+		b[x] = _mm256_set1_epi32(board[x]);
+		pos[x][0] = _mm256_load_si256((const __m256i *)&movegen_spawn[piece][x][0]);
+		pos[x][1] = _mm256_load_si256((const __m256i *)&movegen_spawn[piece][x][8]);
+	}
+
+	for (int h = 0; h < 2; h++) {
+		__m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(b[0], pos[0][h]), _mm256_and_si256(b[1], pos[1][h])),
+			_mm256_or_si256(_mm256_and_si256(b[2], pos[2][h]), _mm256_and_si256(b[3], pos[3][h])));
+		fits |= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(hit, zero))) << (8 * h);
+	}
+	fits &= movegen_in_bounds[piece];
+
+	r->legal = movegen_reachable(fits, movegen_in_bounds[piece]);
+
+	for (int h = 0; h < 2; h++) {
+		__m256i bits = _mm256_set1_epi32((r->legal >> (8 * h)) & 0xFF);
+		__m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+		legal[h] = _mm256_cmpeq_epi32(_mm256_and_si256(bits, lane), lane);
+		falling[h] = legal[h];
+		y[h] = _mm256_set1_epi32(MOVEGEN_SPAWN_Y - free_fall);
+		for (int x = 0; x < 4; x++) {
+			pos[x][h] = _mm256_srli_epi32(pos[x][h], free_fall);
+		}
+	}
+
+	for (int step = free_fall; step < MOVEGEN_SPAWN_Y; step++) {
+		for (int h = 0; h < 2; h++) {
+			__m256i any = _mm256_or_si256(_mm256_or_si256(pos[0][h], pos[1][h]), _mm256_or_si256(pos[2][h], pos[3][h]));
+			__m256i down[4], hit = zero;
+
+			for (int x = 0; x < 4; x++) {
+				down[x] = _mm256_srli_epi32(pos[x][h], 1);
+				hit = _mm256_or_si256(hit, _mm256_and_si256(b[x], down[x]));
+			}
+
+			// Keep falling = was falling, no block on row 0 and next row down is free
+			falling[h] = _mm256_andnot_si256(_mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(any, one), one),
+				_mm256_xor_si256(_mm256_cmpeq_epi32(hit, zero), all)), falling[h]);
+
+			for (int x = 0; x < 4; x++) {
+				pos[x][h] = _mm256_blendv_epi8(pos[x][h], down[x], falling[h]);
+			}
+			y[h] = _mm256_add_epi32(y[h], falling[h]); // Lanes still falling are -1
+		}
+
+		if (_mm256_testz_si256(_mm256_or_si256(falling[0], falling[1]), _mm256_or_si256(falling[0], falling[1]))) {
+			break;
+		}
+	}
+
+	// Illegal moves: board unchanged, landing row -1
+	uint32_t full_lanes = 0;
+
+	for (int h = 0; h < 2; h++) {
+		__m256i merged[4];
+
+		for (int x = 0; x < 4; x++) {
+			merged[x] = _mm256_or_si256(b[x], _mm256_and_si256(pos[x][h], legal[h]));
+			_mm256_storeu_si256((__m256i *)&r->columns[x][8 * h], merged[x]);
+		}
+		__m256i rows = _mm256_and_si256(_mm256_and_si256(_mm256_and_si256(merged[0], merged[1]),
+			_mm256_and_si256(merged[2], merged[3])), legal[h]);
+		_mm256_store_si256((__m256i *)&full[8 * h], rows);
+		full_lanes |= (~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(rows, zero))) & 0xFF) << (8 * h);
+
+		y[h] = _mm256_or_si256(_mm256_and_si256(y[h], legal[h]), _mm256_andnot_si256(legal[h], all));
+	}
+
+	// 16 landing rows to int8, packs works within 128-bit lanes so put the 64-bit groups back in order first
+	__m256i y16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(y[0], y[1]), 0xD8);
+	_mm_storeu_si128((__m128i *)r->landing_y, _mm_packs_epi16(_mm256_castsi256_si128(y16), _mm256_extracti128_si256(y16, 1)));
+	_mm_storeu_si128((__m128i *)r->lines, _mm_setzero_si128());
+
+	for (; full_lanes; full_lanes &= full_lanes - 1) {
+		int m = __builtin_ctz(full_lanes);
+		uint32_t keep = ((1u << MOVEGEN_ROWS) - 1) & ~full[m];
+
+		r->lines[m] = __builtin_popcount(full[m]);
+		for (int x = 0; x < 4; x++) {
+			r->columns[x][m] = _pext_u32(r->columns[x][m], keep);
+		}
+	}
+}
+#endif // MOVEGEN_AVX2
+
+
+
+
+//---------------------------------------
+// Function: movegen_batch
+//
+// Description: All moves for count boards, pieces[i] on boards[i]. Uses AVX2 when the CPU has it unless scalar is set
+//
+// Input: const uint32_t boards[][4],
+//        const uint8_t pieces[],
+//        size_t count,
+//        movegen_result results[],
+//        int scalar
+// Output: None
+//
+//---------------------------------------
+static inline void movegen_batch(const uint32_t boards[][4], const uint8_t pieces[], size_t count, movegen_result results[], int scalar)
+{
+#ifdef MOVEGEN_AVX2
+	if (!scalar && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+		for (size_t i = 0; i < count; i++) {
+			movegen_board_avx2(boards[i], pieces[i], &results[i]);
+		}
+		return;
+	}
+#endif
+
+	for (size_t i = 0; i < count; i++) {
+		movegen_board_scalar(boards[i], pieces[i], &results[i]);
+	}
+}
+
+
+#endif // _MOVEGEN_H_
@@ -0,0 +1,82 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Portable seeded generator for the engine's tetromino picks on the host
+//
+// The C library's rand() differs between libc versions and is shared with
+// everything else in the program, so a game recorded on one machine could
+// not be replayed on another. host_rand() is the ANSI C example generator
+// (same sequence everywhere, same 0-32767 range as avr-libc's rand()) and
+// its state is behind a pointer so several games can each keep their own.
+//
+// Include before Tetris.h: it defines TETRIS_RAND().
+// ---------------------------------------------------------------------------
+
+#ifndef _RAND_H_
+#define _RAND_H_
+
+#include <stdint.h>
+
+
+static uint32_t host_rand_default = 1;
+static uint32_t *host_rand_state = &host_rand_default; // Generator used by host_rand, point at a game's own state to switch
+
+
+
+
+//---------------------------------------
+// Function: host_srand
+//
+// Description: Seed the generator host_rand_state points at
+//
+// Input: uint32_t seed
+// Output: None
+//
+//---------------------------------------
+static inline void host_srand(uint32_t seed)
+{
+	*host_rand_state = seed;
+}
+
+
+
+
+//---------------------------------------
+// Function: host_rand_r
+//
+// Description: Next number from the generator state points at
+//
+// Input: uint32_t *state
+// Output: int
+//		  0 - 32767
+//
+//---------------------------------------
+static inline int host_rand_r(uint32_t *state)
+{
+	*state = *state * 1103515245u + 12345u;
+	return (*state >> 16) & 0x7FFF;
+}
+
+
+
+
+//---------------------------------------
+// Function: host_rand
+//
+// Description: Next number from the generator host_rand_state points at
+//
+// Input: None
+// Output: int
+//		  0 - 32767
+//
+//---------------------------------------
+static inline int host_rand()
+{
+	return host_rand_r(host_rand_state);
+}
+
+
+#define TETRIS_RAND() host_rand()
+
+
+#endif // _RAND_H_
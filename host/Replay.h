@@ -0,0 +1,704 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Replay corpus: recorded games in an append-only binary file
+//
+// A game is its host_rand() seed (Rand.h), one joystick input per tick and
+// one 16-bit outcome per finished tetromino. Replaying the inputs through
+// the engine (Game.h) with the same seed gives the same game, so the
+// outcomes can be checked against the engine or queried without replaying.
+//
+// File layout, all fields little endian:
+//
+//   file header    16 bytes  "TRPC", version, header size, flags
+//   chunk ...                appended one after another, each self-contained
+//
+//   chunk header   24 bytes  "CHNK", games, chunk size, CRC-32 of the rest
+//   index          24 bytes per game (replay_entry)
+//   records        per game: inputs, 4 bits per tick (Game.h INPUT_*, low
+//                  nibble first), padded to 2 bytes, then the outcomes
+//
+// Offsets in the index are from the start of the chunk, so chunks can be
+// copied between files unchanged (merge) and a chunk cut short by a crash
+// is dropped when the file is next opened for writing. The reader maps the
+// file and hands out pointers into it (replay_game), nothing is copied.
+//
+// Requires avr_host.h, Rand.h, LCD1602.h, Tetris.h and Game.h to be
+// included first.
+// ---------------------------------------------------------------------------
+
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "Replay.h reads and writes the corpus in host byte order, which must be little endian"
+#endif
+
+
+#define REPLAY_MAGIC "TRPC"
+#define REPLAY_CHUNK_MAGIC "CHNK"
+#define REPLAY_VERSION 1
+#define REPLAY_CHUNK_GAMES 4096 // Games buffered by replay_writer before a chunk is written
+
+#define REPLAY_TOPPED_OUT 0x01 // replay_entry.flags: game ended with a block in row 15 (else it was cut off)
+
+
+//Per tetromino outcome: type (init_tetromino), ticks it fell for, rows it completed and stack height after it
+#define REPLAY_OUTCOME(type, ticks, rows, height) ((uint16_t)((type) | ((ticks) << 3) | ((rows) << 8) | ((height) << 11)))
+#define REPLAY_OUTCOME_TYPE(o) ((o) & 0x07)
+#define REPLAY_OUTCOME_TICKS(o) (((o) >> 3) & 0x1F)
+#define REPLAY_OUTCOME_ROWS(o) (((o) >> 8) & 0x07)
+#define REPLAY_OUTCOME_HEIGHT(o) ((o) >> 11)
+
+
+typedef struct replay_file_header {
+
+	char magic[4];
+	uint16_t version;
+	uint16_t header_bytes;
+	uint32_t flags;
+	uint32_t reserved;
+
+} replay_file_header;
+
+
+typedef struct replay_chunk_header {
+
+	char magic[4];
+	uint32_t games;
+	uint64_t bytes; // Whole chunk, header included, multiple of 8
+	uint32_t crc; // CRC-32 of the index and records
+	uint32_t reserved;
+
+} replay_chunk_header;
+
+
+//Index entry for one game
+typedef struct replay_entry {
+
+	uint32_t offset; // Record offset from the start of the chunk
+	uint32_t seed;
+	uint32_t ticks;
+	uint32_t rows; // Rows removed
+	uint16_t pieces; // Finished tetrominoes (outcomes)
+	uint8_t max_height;
+	uint8_t flags;
+	uint32_t reserved;
+
+} replay_entry;
+
+_Static_assert(sizeof(replay_file_header) == 16, "replay_file_header layout");
+_Static_assert(sizeof(replay_chunk_header) == 24, "replay_chunk_header layout");
+_Static_assert(sizeof(replay_entry) == 24, "replay_entry layout");
+
+
+//One game in a mapped corpus
+typedef struct replay_game {
+
+	const replay_entry *entry;
+	const uint8_t *inputs;
+	const uint16_t *outcomes;
+	const uint8_t *record; // Start of the record, replay_record_bytes long
+
+} replay_game;
+
+
+//Mapped corpus file
+typedef struct replay_corpus {
+
+	uint8_t *base;
+	size_t size;
+	size_t valid_bytes; // End of the last complete chunk
+	size_t chunks;
+	size_t count;
+	replay_game *games;
+
+} replay_corpus;
+
+
+//Appends chunks to a corpus file
+typedef struct replay_writer {
+
+	int fd;
+	replay_entry index[REPLAY_CHUNK_GAMES];
+	uint32_t games; // Buffered
+	uint8_t *data;
+	size_t data_bytes, data_capacity;
+	unsigned long chunks_written, games_written;
+	size_t dropped_bytes; // Torn tail removed by replay_writer_open
+
+} replay_writer;
+
+
+
+
+//---------------------------------------
+// Function: replay_crc32
+//
+// Description: CRC-32 (IEEE, reflected) of len bytes, continuing from crc (0 to start)
+//
+// Input: uint32_t crc,
+//        const uint8_t *data,
+//        size_t len
+// Output: uint32_t
+//
+//---------------------------------------
+static uint32_t replay_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+	static uint32_t table[256];
+
+	if (!table[1]) {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+			table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	while (len--) {
+		crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_record_bytes
+//
+// Description: Size of a game's record: packed inputs padded to 2 bytes, then the outcomes
+//
+// Input: uint32_t ticks,
+//        uint32_t pieces
+// Output: size_t
+//
+//---------------------------------------
+static inline size_t replay_record_bytes(uint32_t ticks, uint32_t pieces)
+{
+	return ((((size_t)ticks + 1) / 2 + 1) & ~(size_t)1) + 2 * (size_t)pieces;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_input
+//
+// Description: Joystick input (Game.h INPUT_*) of tick in game
+//
+// Input: const replay_game *g,
+//        uint32_t tick
+// Output: uint8_t
+//
+//---------------------------------------
+static inline uint8_t replay_input(const replay_game *g, uint32_t tick)
+{
+	return (g->inputs[tick >> 1] >> ((tick & 1) * 4)) & 0x0F;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_chunk_games
+//
+// Description: Check the chunk at offset and fill games (if not NULL) with its games. Does not check the CRC
+//
+// Input: uint8_t *base,
+//        size_t size,
+//        size_t offset,
+//        replay_game *games
+// Output: size_t
+//		  0 = Chunk missing, cut short or damaged
+//		  Otherwise size of the chunk
+//
+//---------------------------------------
+static size_t replay_chunk_games(uint8_t *base, size_t size, size_t offset, replay_game *games)
+{
+	const replay_chunk_header *ch = (const replay_chunk_header *)(base + offset);
+
+	if (size - offset < sizeof(*ch) || memcmp(ch->magic, REPLAY_CHUNK_MAGIC, 4) != 0 || ch->bytes < sizeof(*ch) ||
+		ch->bytes > size - offset || ch->bytes % 8 || (ch->bytes - sizeof(*ch)) / sizeof(replay_entry) < ch->games) {
+		return 0;
+	}
+
+	const replay_entry *index = (const replay_entry *)(base + offset + sizeof(*ch));
+	for (uint32_t i = 0; i < ch->games; i++) {
+		size_t bytes = replay_record_bytes(index[i].ticks, index[i].pieces);
+		if (index[i].offset % 2 || index[i].offset > ch->bytes || bytes > ch->bytes - index[i].offset) {
+			return 0;
+		}
+		if (games) {
+			const uint8_t *record = base + offset + index[i].offset;
+			games[i].entry = &index[i];
+			games[i].record = record;
+			games[i].inputs = record;
+			games[i].outcomes = (const uint16_t *)(record + bytes - 2 * (size_t)index[i].pieces);
+		}
+	}
+	return ch->bytes;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_scan
+//
+// Description: Walk the chunks of a mapped corpus, filling games (if not NULL). Stops at the first damaged or incomplete chunk
+//
+// Input: uint8_t *base,
+//        size_t size,
+//        replay_game *games,
+//        size_t *chunks,
+//        size_t *count
+// Output: size_t
+//		  End of the last complete chunk
+//
+//---------------------------------------
+static size_t replay_scan(uint8_t *base, size_t size, replay_game *games, size_t *chunks, size_t *count)
+{
+	size_t offset = sizeof(replay_file_header);
+	size_t chunk_bytes;
+
+	*chunks = 0;
+	*count = 0;
+	while (offset < size && (chunk_bytes = replay_chunk_games(base, size, offset, games ? games + *count : NULL))) {
+		*count += ((const replay_chunk_header *)(base + offset))->games;
+		(*chunks)++;
+		offset += chunk_bytes;
+	}
+	return offset;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_header_ok
+//
+// Description: Check the file header of a mapped corpus
+//
+// Input: const uint8_t *base,
+//        size_t size
+// Output: int
+//
+//---------------------------------------
+static int replay_header_ok(const uint8_t *base, size_t size)
+{
+	const replay_file_header *fh = (const replay_file_header *)base;
+
+	return size >= sizeof(*fh) && memcmp(fh->magic, REPLAY_MAGIC, 4) == 0 && fh->version == REPLAY_VERSION &&
+		fh->header_bytes == sizeof(*fh);
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_open
+//
+// Description: Map a corpus file read only and index its games. Bytes after the last complete chunk are ignored
+//
+// Input: replay_corpus *c,
+//        const char *path
+// Output: int
+//		  -1 = Error (message on stderr)
+//         0 = Success
+//
+//---------------------------------------
+static int replay_open(replay_corpus *c, const char *path)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	memset(c, 0, sizeof(*c));
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		if (fd >= 0) close(fd);
+		return -1;
+	}
+
+	c->size = st.st_size;
+	c->base = c->size ? mmap(NULL, c->size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (c->base == MAP_FAILED || !replay_header_ok(c->base, c->size)) {
+		fprintf(stderr, "%s: not a replay corpus\n", path);
+		if (c->base != MAP_FAILED) munmap(c->base, c->size);
+		c->base = NULL;
+		return -1;
+	}
+	madvise(c->base, c->size, MADV_SEQUENTIAL);
+
+	replay_scan(c->base, c->size, NULL, &c->chunks, &c->count);
+	c->games = malloc((c->count ? c->count : 1) * sizeof(replay_game));
+	if (!c->games) {
+		fprintf(stderr, "%s: out of memory\n", path);
+		munmap(c->base, c->size);
+		return -1;
+	}
+	c->valid_bytes = replay_scan(c->base, c->size, c->games, &c->chunks, &c->count);
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_close
+//
+// Description: Unmap a corpus opened with replay_open
+//
+// Input: replay_corpus *c
+// Output: None
+//
+//---------------------------------------
+static void replay_close(replay_corpus *c)
+{
+	if (c->base) {
+		munmap(c->base, c->size);
+	}
+	free(c->games);
+	memset(c, 0, sizeof(*c));
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_chunk_crc_ok
+//
+// Description: Check the CRC of a chunk found by replay_scan
+//
+// Input: const uint8_t *chunk
+// Output: int
+//
+//---------------------------------------
+static inline int replay_chunk_crc_ok(const uint8_t *chunk)
+{
+	const replay_chunk_header *ch = (const replay_chunk_header *)chunk;
+
+	return replay_crc32(0, chunk + sizeof(*ch), ch->bytes - sizeof(*ch)) == ch->crc;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_writer_open
+//
+// Description: Open a corpus file for appending, creating it if needed. A chunk cut short at the end is removed
+//
+// Input: replay_writer *w,
+//        const char *path
+// Output: int
+//		  -1 = Error (message on stderr)
+//         0 = Success
+//
+//---------------------------------------
+static int replay_writer_open(replay_writer *w, const char *path)
+{
+	struct stat st;
+
+	memset(w, 0, sizeof(*w));
+	w->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (w->fd < 0 || fstat(w->fd, &st) < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (st.st_size == 0) {
+		replay_file_header fh = {0};
+		memcpy(fh.magic, REPLAY_MAGIC, 4);
+		fh.version = REPLAY_VERSION;
+		fh.header_bytes = sizeof(fh);
+		if (write(w->fd, &fh, sizeof(fh)) != sizeof(fh)) {
+			fprintf(stderr, "%s: %s\n", path, strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+
+	uint8_t *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, w->fd, 0);
+	if (base == MAP_FAILED || !replay_header_ok(base, st.st_size)) {
+		fprintf(stderr, "%s: not a replay corpus\n", path);
+		if (base != MAP_FAILED) munmap(base, st.st_size);
+		return -1;
+	}
+
+	size_t chunks, count;
+	size_t valid = replay_scan(base, st.st_size, NULL, &chunks, &count);
+	munmap(base, st.st_size);
+
+	w->dropped_bytes = st.st_size - valid;
+	if ((w->dropped_bytes && ftruncate(w->fd, valid) < 0) || lseek(w->fd, valid, SEEK_SET) < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_writer_flush
+//
+// Description: Write the buffered games as one chunk
+//
+// Input: replay_writer *w
+// Output: int
+//		  -1 = Write failed
+//         0 = Success
+//
+//---------------------------------------
+static int replay_writer_flush(replay_writer *w)
+{
+	static const uint8_t zeros[8];
+	replay_chunk_header ch = {0};
+	size_t index_bytes = w->games * sizeof(replay_entry);
+	size_t pad = (8 - (sizeof(ch) + index_bytes + w->data_bytes) % 8) % 8;
+
+	if (!w->games) {
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < w->games; i++) {
+		w->index[i].offset += sizeof(ch) + index_bytes;
+	}
+
+	memcpy(ch.magic, REPLAY_CHUNK_MAGIC, 4);
+	ch.games = w->games;
+	ch.bytes = sizeof(ch) + index_bytes + w->data_bytes + pad;
+	ch.crc = replay_crc32(0, (const uint8_t *)w->index, index_bytes);
+	ch.crc = replay_crc32(ch.crc, w->data, w->data_bytes);
+	ch.crc = replay_crc32(ch.crc, zeros, pad);
+
+	struct iovec iov[4] = {
+		{&ch, sizeof(ch)},
+		{w->index, index_bytes},
+		{w->data, w->data_bytes},
+		{(void *)zeros, pad},
+	};
+	if (writev(w->fd, iov, 4) != (ssize_t)ch.bytes) {
+		return -1;
+	}
+
+	w->chunks_written++;
+	w->games_written += w->games;
+	w->games = 0;
+	w->data_bytes = 0;
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_writer_add
+//
+// Description: Buffer one game. record is replay_record_bytes(entry->ticks, entry->pieces) long. entry->offset is filled in
+//
+// Input: replay_writer *w,
+//        const replay_entry *entry,
+//        const uint8_t *record
+// Output: int
+//		  -1 = Write failed or out of memory
+//         0 = Success
+//
+//---------------------------------------
+static int replay_writer_add(replay_writer *w, const replay_entry *entry, const uint8_t *record)
+{
+	size_t bytes = replay_record_bytes(entry->ticks, entry->pieces);
+
+	if (w->data_bytes + bytes > w->data_capacity) {
+		size_t capacity = w->data_capacity ? w->data_capacity * 2 : 1 << 20;
+		while (capacity < w->data_bytes + bytes) {
+			capacity *= 2;
+		}
+		uint8_t *data = realloc(w->data, capacity);
+		if (!data) {
+			return -1;
+		}
+		w->data = data;
+		w->data_capacity = capacity;
+	}
+
+	w->index[w->games] = *entry;
+	w->index[w->games].offset = w->data_bytes; // Made relative to the chunk by replay_writer_flush
+	memcpy(w->data + w->data_bytes, record, bytes);
+	w->data_bytes += bytes;
+
+	if (++w->games == REPLAY_CHUNK_GAMES) {
+		return replay_writer_flush(w);
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_writer_add_chunk
+//
+// Description: Copy a whole chunk found by replay_scan (after the buffered games)
+//
+// Input: replay_writer *w,
+//        const uint8_t *chunk
+// Output: int
+//		  -1 = Write failed
+//         0 = Success
+//
+//---------------------------------------
+static inline int replay_writer_add_chunk(replay_writer *w, const uint8_t *chunk)
+{
+	const replay_chunk_header *ch = (const replay_chunk_header *)chunk;
+
+	if (replay_writer_flush(w) < 0 || write(w->fd, chunk, ch->bytes) != (ssize_t)ch->bytes) {
+		return -1;
+	}
+	w->chunks_written++;
+	w->games_written += ch->games;
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_writer_close
+//
+// Description: Write the buffered games and close the file
+//
+// Input: replay_writer *w
+// Output: int
+//		  -1 = Write failed
+//         0 = Success
+//
+//---------------------------------------
+static int replay_writer_close(replay_writer *w)
+{
+	int rc = replay_writer_flush(w);
+
+	if (close(w->fd) < 0) {
+		rc = -1;
+	}
+	free(w->data);
+	w->data = NULL;
+	return rc;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_stack_height
+//
+// Description: Height of the highest block on the board (0 = empty)
+//
+// Input: const tetris_game *game
+// Output: uint8_t
+//
+//---------------------------------------
+static uint8_t replay_stack_height(const tetris_game *game)
+{
+	for (int y = 16; y >= 0; y--) {
+		if (game->tetris_state[0][y] | game->tetris_state[1][y] | game->tetris_state[2][y] | game->tetris_state[3][y]) {
+			return y + 1;
+		}
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_next_tetromino
+//
+// Description: Pick the next tetromino from host_rand() the way init_random_tetromino does, returning its type
+//
+// Input: struct tetromino_location *t_loc_p
+// Output: int
+//
+//---------------------------------------
+static int replay_next_tetromino(struct tetromino_location *t_loc_p)
+{
+	int type = host_rand() % TETROMINO_TYPES;
+
+	init_tetromino(type, t_loc_p);
+	return type;
+}
+
+
+
+
+//---------------------------------------
+// Function: replay_run
+//
+// Description: Replay a game through the engine from its seed and inputs and compare each tetromino's outcome with the recorded one.
+//              Uses its own host_rand() state and leaves host_rand_state as it was
+//
+// Input: const replay_game *g,
+//        tetris_game *game
+// Output: long
+//		  Number of differences (outcomes, tetromino count, how the game ended), 0 = replayed exactly
+//
+//---------------------------------------
+static long replay_run(const replay_game *g, tetris_game *game)
+{
+	const replay_entry *e = g->entry;
+	uint32_t *saved_state = host_rand_state;
+	uint32_t state = e->seed;
+	struct tetromino_location t_loc;
+	uint32_t piece = 0;
+	int piece_ticks = 0;
+	int topped_out = 0;
+	long differences = 0;
+
+	host_rand_state = &state;
+	int type = replay_next_tetromino(&t_loc);
+	game_reset(game, &t_loc);
+
+	for (uint32_t tick = 0; tick < e->ticks && !topped_out; tick++) {
+		int rc = game_step(game, replay_input(g, tick));
+		piece_ticks++;
+		if (rc == 0) {
+			continue;
+		}
+
+		if (piece < e->pieces &&
+			g->outcomes[piece] != REPLAY_OUTCOME(type, piece_ticks, tetris_rows_removed, replay_stack_height(game))) {
+			differences++;
+		}
+		piece++;
+		piece_ticks = 0;
+
+		if (rc == -2) {
+			topped_out = 1;
+		}
+		else {
+			type = replay_next_tetromino(&t_loc);
+			game_spawn(game, &t_loc);
+		}
+	}
+
+	differences += piece != e->pieces;
+	differences += topped_out != (e->flags & REPLAY_TOPPED_OUT);
+	host_rand_state = saved_state;
+	return differences;
+}
+
+
+#endif // _REPLAY_H_
@@ -0,0 +1,255 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// VCD (value change dump) trace of the LCD bus and the profiling phases
+//
+// Writes what a logic analyser on the board would capture with the firmware
+// built with -DTETRIS_TRACE: RS, E and D7-D4 from PORTB, and one signal per
+// profiling phase (Profile.h), high from PROFILE_BEGIN to PROFILE_END.
+// Timestamps are the host shim's virtual clock in ns, so a frame opens in
+// GTKWave with the phases lined up against the nibbles sent to the LCD.
+//
+// PORTB is sampled at the start of every delay (the virtual clock only
+// moves during delays, so no pin change is missed) and before every marker.
+// Firmware code between delays takes no virtual time, so Enable falling and
+// rising again for the next nibble would land on the same timestamp: an
+// Enable pulse is drawn as the delay it is high for, ending one CPU cycle
+// early (VCD_CYCLE_NS).
+//
+// The program routes markers here by defining PROFILE_HOOK to call
+// vcd_marker before including Profile.h.
+//
+// Requires LCD1602.h (pin numbers) and Profile.h (phase IDs) to be included first.
+// ---------------------------------------------------------------------------
+
+#ifndef _VCD_H_
+#define _VCD_H_
+
+
+//Struct to hold the trace file and the last values written
+typedef struct vcd_trace {
+
+	FILE *out;
+	uint64_t time_ns; // Last timestamp written
+	uint8_t port; // PORTB as last written (RS, E, D4-D7 only)
+	uint8_t phases; // Bit p set = phase p active
+	uint64_t enable_fall_ns; // Enable drawn low at this time, 0 = not pending
+	unsigned long changes;
+
+	void (*delay_hook)(uint64_t start_ns, uint64_t end_ns); // host_delay_hook called after sampling PORTB
+
+} vcd_trace;
+
+
+static vcd_trace host_vcd;
+
+#define VCD_PORT_PINS ((1 << RS) | (1 << ENABLE) | (1 << D4) | (1 << D5) | (1 << D6) | (1 << D7))
+#define VCD_CYCLE_NS 62 // One CPU cycle at 16 MHz
+
+//Signal names of phases 1 to PROFILE_PHASES - 1, identifier code is '$' + phase
+static const char *vcd_phase_names[PROFILE_PHASES] = {NULL, "boot", "tick", "render", "line_clear", "link", "input"};
+
+
+
+
+//---------------------------------------
+// Function: vcd_time
+//
+// Description: Write a timestamp if ns is later than the last one
+//
+// Input: vcd_trace *vcd,
+//        uint64_t ns
+// Output: None
+//
+//---------------------------------------
+static void vcd_time(vcd_trace *vcd, uint64_t ns)
+{
+	if (ns > vcd->time_ns) {
+		fprintf(vcd->out, "#%llu\n", (unsigned long long)ns);
+		vcd->time_ns = ns;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: vcd_port
+//
+// Description: Write the LCD pins of PORTB that changed since the last call
+//
+// Input: vcd_trace *vcd,
+//        uint64_t ns,
+//        uint8_t port
+// Output: None
+//
+//---------------------------------------
+static void vcd_port(vcd_trace *vcd, uint64_t ns, uint8_t port)
+{
+	if (vcd->enable_fall_ns && vcd->enable_fall_ns <= ns) {
+		vcd_time(vcd, vcd->enable_fall_ns);
+		fprintf(vcd->out, "0\"\n");
+		vcd->port &= ~(1 << ENABLE);
+		vcd->enable_fall_ns = 0;
+	}
+
+	uint8_t changed = (port ^ vcd->port) & VCD_PORT_PINS;
+
+	if (!changed) {
+		return;
+	}
+
+	vcd_time(vcd, ns);
+	if (changed & (1 << RS)) {
+		fprintf(vcd->out, "%d!\n", (port >> RS) & 1);
+	}
+	if (changed & (1 << ENABLE)) {
+		fprintf(vcd->out, "%d\"\n", (port >> ENABLE) & 1);
+	}
+	if (changed & ((1 << D4) | (1 << D5) | (1 << D6) | (1 << D7))) {
+		fprintf(vcd->out, "b%d%d%d%d #\n", (port >> D7) & 1, (port >> D6) & 1, (port >> D5) & 1, (port >> D4) & 1);
+	}
+	vcd->port = port & VCD_PORT_PINS;
+	vcd->changes++;
+}
+
+
+
+
+//---------------------------------------
+// Function: vcd_marker
+//
+// Description: Write a profiling marker (phase ID, PROFILE_EXIT set on exit)
+//
+// Input: vcd_trace *vcd,
+//        uint64_t ns,
+//        uint8_t marker
+// Output: None
+//
+//---------------------------------------
+static void vcd_marker(vcd_trace *vcd, uint64_t ns, uint8_t marker)
+{
+	uint8_t phase = marker & ~PROFILE_EXIT;
+	uint8_t active = !(marker & PROFILE_EXIT);
+
+	if (!vcd->out || phase == 0 || phase >= PROFILE_PHASES) {
+		return;
+	}
+
+	vcd_port(vcd, ns, PORTB); // Pins set since the last delay come first
+	if (((vcd->phases >> phase) & 1) == active) {
+		return;
+	}
+
+	vcd_time(vcd, ns);
+	fprintf(vcd->out, "%d%c\n", active, '$' + phase);
+	vcd->phases ^= 1 << phase;
+	vcd->changes++;
+}
+
+
+
+
+//---------------------------------------
+// Function: vcd_delay_hook
+//
+// Description: host_delay_hook. Sample PORTB into host_vcd (Enable high = a pulse as long as the delay), then call the
+//              hook installed before vcd_attach
+//
+// Input: uint64_t start_ns,
+//        uint64_t end_ns
+// Output: None
+//
+//---------------------------------------
+static void vcd_delay_hook(uint64_t start_ns, uint64_t end_ns)
+{
+	vcd_port(&host_vcd, start_ns, PORTB);
+	if ((PORTB & (1 << ENABLE)) && end_ns - start_ns > VCD_CYCLE_NS) {
+		host_vcd.enable_fall_ns = end_ns - VCD_CYCLE_NS;
+	}
+
+	if (host_vcd.delay_hook) {
+		host_vcd.delay_hook(start_ns, end_ns);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: vcd_attach
+//
+// Description: Create a trace file, write its header and start tracing host_time_ns onwards. Call after any other
+//              host_delay_hook is installed, it is chained
+//
+// Input: const char *path
+// Output: int
+//		  -1 = File could not be created
+//         0 = Tracing
+//
+//---------------------------------------
+static int vcd_attach(const char *path)
+{
+	FILE *out = fopen(path, "w");
+
+	if (!out) {
+		return -1;
+	}
+
+	memset(&host_vcd, 0, sizeof(host_vcd));
+	host_vcd.out = out;
+	host_vcd.time_ns = host_time_ns;
+	host_vcd.port = PORTB & VCD_PORT_PINS;
+
+	fprintf(out, "$timescale 1ns $end\n$scope module lcd $end\n");
+	fprintf(out, "$var wire 1 ! rs $end\n$var wire 1 \" e $end\n$var wire 4 # d $end\n$upscope $end\n");
+	fprintf(out, "$scope module phase $end\n");
+	for (int p = 1; p < PROFILE_PHASES; p++) {
+		fprintf(out, "$var wire 1 %c %s $end\n", '$' + p, vcd_phase_names[p]);
+	}
+	fprintf(out, "$upscope $end\n$enddefinitions $end\n");
+
+	fprintf(out, "#%llu\n$dumpvars\n", (unsigned long long)host_time_ns);
+	fprintf(out, "%d!\n%d\"\nb%d%d%d%d #\n", (PORTB >> RS) & 1, (PORTB >> ENABLE) & 1,
+		(PORTB >> D7) & 1, (PORTB >> D6) & 1, (PORTB >> D5) & 1, (PORTB >> D4) & 1);
+	for (int p = 1; p < PROFILE_PHASES; p++) {
+		fprintf(out, "0%c\n", '$' + p);
+	}
+	fprintf(out, "$end\n");
+
+	host_vcd.delay_hook = host_delay_hook;
+	host_delay_hook = vcd_delay_hook;
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: vcd_close
+//
+// Description: Write the pins as they are now, stop tracing and close the file
+//
+// Input: None
+// Output: int
+//		  -1 = Write error
+//         0 = Trace complete
+//
+//---------------------------------------
+static int vcd_close()
+{
+	if (!host_vcd.out) {
+		return 0;
+	}
+
+	vcd_port(&host_vcd, host_time_ns, PORTB);
+	vcd_time(&host_vcd, host_time_ns); // Length of the trace
+	host_delay_hook = host_vcd.delay_hook;
+
+	int rc = ferror(host_vcd.out) | fclose(host_vcd.out);
+	host_vcd.out = NULL;
+	return rc ? -1 : 0;
+}
+
+
+#endif // _VCD_H_
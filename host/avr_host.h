@@ -0,0 +1,289 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host shim for <avr/io.h> and <util/delay.h>
+//
+// Lets LCD1602.h and Tetris.h be compiled with a desktop C compiler. I/O
+// registers are plain variables, the joystick ADC channels are fed from
+// host_adc_channel[] and delays advance a virtual clock (host_time_ns)
+// instead of sleeping. A hook is called for every delay, and another for
+// every write to PORTB or PORTC, so an emulator can observe the port pins
+// while the firmware is waiting and see each edge when it is written.
+// ---------------------------------------------------------------------------
+
+#ifndef _AVR_HOST_H_
+#define _AVR_HOST_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+
+//The host has no interrupts: the ISRs these options send the LCD bytes and read the ADC from would never run
+#if defined(LCD_ASYNC) || defined(TETRIS_INPUT_ISR)
+#error "LCD_ASYNC and TETRIS_INPUT_ISR are firmware only, the host shim has no interrupts"
+#endif
+
+//Stack.h paints and checks the AVR's SRAM between the linker symbols _end and __stack
+#ifdef TETRIS_STACK_CHECK
+#error "TETRIS_STACK_CHECK is firmware only, Stack.h needs the AVR memory layout"
+#endif
+
+
+//I/O register bit numbers used by the firmware
+#define PORTC0 0
+#define PORTC1 1
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define REFS0 6
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+
+
+//I/O registers
+static uint8_t DDRB, DDRC, DIDR0, ADMUX;
+static uint8_t PORTD __attribute__((unused)), DDRD __attribute__((unused)); // Trace pins (TETRIS_TRACE)
+static uint8_t GPIOR0 __attribute__((unused)); // Written by profiling markers
+static uint8_t ADCSRA = (1 << ADIF); // Conversions complete instantly on the host
+static uint8_t TCCR1A __attribute__((unused)), TCCR1B __attribute__((unused)); // Timer1 always runs at F_CPU/64 on the host
+static uint8_t MCUSR __attribute__((unused)) = (1 << PORF); // Host programs start from power on
+
+
+//EEPROM (1 KB, erased = 0xFF). Every byte programmed takes 3.4 ms of virtual time and counts in host_eeprom_writes.
+//host_eeprom_budget >= 0 is the number of bytes that can still be programmed before the power is cut: the writes
+//after it are lost, as on a board whose supply fails in the middle of eeprom_update_block
+static uint8_t host_eeprom[1024] = {[0 ... 1023] = 0xFF};
+static unsigned long host_eeprom_writes;
+static long host_eeprom_budget = -1;
+
+#define HOST_EEPROM_WRITE_NS 3400000
+
+
+//Joystick input: 10-bit value returned for each ADC channel (512 = stick at rest)
+static uint16_t host_adc_channel[8] = {512, 512, 512, 512, 512, 512, 512, 512};
+static uint16_t host_adc_result;
+
+
+//Virtual clock in nanoseconds, advanced only by _delay_us and _delay_ms
+static uint64_t host_time_ns;
+
+
+//Called at the start of every delay with the delay's start and end time
+static void (*host_delay_hook)(uint64_t start_ns, uint64_t end_ns);
+
+
+//PORTB and PORTC (LCD pins), and their values when host_port_hook was last called
+static uint8_t host_portb, host_portc;
+static uint8_t host_portb_seen, host_portc_seen;
+
+
+//Called for every write that changed PORTB or PORTC, at the virtual time of the write, with both ports before it.
+//host_portb and host_portc hold them after it
+static void (*host_port_hook)(uint8_t portb_was, uint8_t portc_was);
+
+
+
+
+//---------------------------------------
+// Function: host_adc_register
+//
+// Description: Latch the value of the channel selected in ADMUX and return the ADC data register
+//
+// Input: None
+// Output: uint16_t *
+//
+//---------------------------------------
+static inline uint16_t *host_adc_register()
+{
+	host_adc_result = host_adc_channel[ADMUX & 0x07];
+	return &host_adc_result;
+}
+
+#define ADC (*host_adc_register())
+
+
+
+
+//---------------------------------------
+// Function: host_port_sync
+//
+// Description: Pass the last write to PORTB or PORTC to host_port_hook if it changed the port. Every access to the
+//              ports and every delay calls this first, so a write is reported before the next one and before time moves
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static inline void host_port_sync()
+{
+	uint8_t portb_was = host_portb_seen;
+	uint8_t portc_was = host_portc_seen;
+
+	if (host_portb == portb_was && host_portc == portc_was) {
+		return;
+	}
+	host_portb_seen = host_portb;
+	host_portc_seen = host_portc;
+
+	if (host_port_hook) {
+		host_port_hook(portb_was, portc_was);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: host_port_register
+//
+// Description: Report the last port write to host_port_hook and return the port register
+//
+// Input: uint8_t *port
+// Output: uint8_t *
+//
+//---------------------------------------
+static inline uint8_t *host_port_register(uint8_t *port)
+{
+	host_port_sync();
+	return port;
+}
+
+#define PORTB (*host_port_register(&host_portb))
+#define PORTC (*host_port_register(&host_portc))
+
+
+//Timer1 count at F_CPU/64 (4 us per count) since host_time_ns = 0. Read only
+#define TCNT1 ((uint16_t)(host_time_ns / 4000))
+
+
+
+
+//---------------------------------------
+// Function: host_delay_ns
+//
+// Description: Report the last port write, then notify host_delay_hook and advance virtual clock by ns nanoseconds
+//
+// Input: uint64_t ns
+// Output: None
+//
+//---------------------------------------
+static inline void host_delay_ns(uint64_t ns)
+{
+	uint64_t start_ns = host_time_ns;
+
+	host_port_sync();
+	host_time_ns += ns;
+
+	if (host_delay_hook) {
+		host_delay_hook(start_ns, host_time_ns);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: host_joystick
+//
+// Description: Set the joystick position read by joystick_update (X on channel 1, Y on channel 0)
+//
+// Input: uint16_t x_val,
+//        uint16_t y_val
+// Output: None
+//
+//---------------------------------------
+static inline void host_joystick(uint16_t x_val, uint16_t y_val)
+{
+	host_adc_channel[1] = x_val;
+	host_adc_channel[0] = y_val;
+}
+
+
+//---------------------------------------
+// Function: eeprom_read_block
+//
+// Description: Copy n bytes from EEPROM address src to dst (avr/eeprom.h)
+//
+// Input: void *dst,
+//        const void *src,
+//        size_t n
+// Output: None
+//
+//---------------------------------------
+static inline void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+	memcpy(dst, host_eeprom + (uintptr_t)src, n);
+}
+
+
+
+
+//---------------------------------------
+// Function: eeprom_update_byte
+//
+// Description: Program one EEPROM byte if it differs from value and the power has not been cut (avr/eeprom.h)
+//
+// Input: uint8_t *address,
+//        uint8_t value
+// Output: None
+//
+//---------------------------------------
+static inline void eeprom_update_byte(uint8_t *address, uint8_t value)
+{
+	uint8_t *cell = host_eeprom + (uintptr_t)address;
+
+	if (*cell == value || host_eeprom_budget == 0) {
+		return;
+	}
+	if (host_eeprom_budget > 0) {
+		host_eeprom_budget--;
+	}
+	*cell = value;
+	host_eeprom_writes++;
+	host_delay_ns(HOST_EEPROM_WRITE_NS);
+}
+
+
+
+
+//---------------------------------------
+// Function: eeprom_update_block
+//
+// Description: Program the bytes of EEPROM from address dst on that differ from src (avr/eeprom.h)
+//
+// Input: const void *src,
+//        void *dst,
+//        size_t n
+// Output: None
+//
+//---------------------------------------
+static inline void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		eeprom_update_byte((uint8_t *)dst + i, ((const uint8_t *)src)[i]);
+	}
+}
+
+
+//Program memory (avr/pgmspace.h): flash is ordinary memory on the host
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+
+
+#define _delay_us(us) host_delay_ns((uint64_t)((us) * 1000.0))
+#define _delay_ms(ms) host_delay_ns((uint64_t)((ms) * 1000000.0))
+
+
+#endif // _AVR_HOST_H_
@@ -0,0 +1,621 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: record, merge, filter, summarise and verify replay corpora
+// (Replay.h)
+//
+//   record  plays games with random joystick input through the engine and
+//           appends them to a corpus, one host_rand() seed per game
+//   merge   appends the chunks of other corpora, copied unchanged
+//   filter  copies the games matching all the given conditions
+//   stats   aggregates the index and per-tetromino outcomes in parallel,
+//           one thread per slice of the mapped file, without replaying
+//   verify  checks every chunk's CRC and replays every game through the
+//           engine, comparing each tetromino's outcome. The engine keeps
+//           its state in globals, so replay runs in forked workers
+//
+// Build: gcc -O2 -pthread -o corpus host/corpus.c
+// Usage: corpus record <file> [-g games] [-s seed] [-p max tetrominoes per game]
+//        corpus merge <file> <input>...
+//        corpus filter <input> <file> [--min-height h] [--min-rows n] [--min-pieces n] [--topped-out] [--cut-off]
+//        corpus stats <file> [-j threads]
+//        corpus verify <file> [-j jobs]
+// ---------------------------------------------------------------------------
+
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "avr_host.h"
+#include "Rand.h"
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "Game.h"
+#include "Replay.h"
+
+
+#define MAX_HEIGHT 17 // Rows 0-16 count towards stack height
+
+
+//Aggregates for stats, one per thread
+typedef struct corpus_stats {
+
+	const replay_corpus *c;
+	size_t first, last;
+
+	unsigned long games, topped_out, ticks, pieces, rows;
+	unsigned long max_pieces;
+	unsigned long game_height[MAX_HEIGHT + 1]; // Games by highest stack
+	unsigned long types[TETROMINO_TYPES];
+	unsigned long clears[5]; // Tetrominoes by rows completed
+	unsigned long timed_out; // Tetrominoes that used all GAME_TICKS_PER_TETROMINO ticks
+
+} corpus_stats;
+
+
+
+
+//---------------------------------------
+// Function: wall_seconds
+//
+// Description: Monotonic wall clock time
+//
+// Input: None
+// Output: double
+//
+//---------------------------------------
+static double wall_seconds()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//---------------------------------------
+// Function: random_input
+//
+// Description: Pick a random joystick input, biased towards rest. Uses rand(), tetrominoes come from host_rand()
+//
+// Input: None
+// Output: uint8_t
+//
+//---------------------------------------
+static uint8_t random_input()
+{
+	static const uint8_t x_inputs[] = {INPUT_LEFT, INPUT_NONE, INPUT_NONE, INPUT_NONE, INPUT_RIGHT};
+	static const uint8_t y_inputs[] = {INPUT_DOWN, INPUT_NONE, INPUT_NONE, INPUT_NONE, INPUT_ROTATE};
+
+	return x_inputs[rand() % 5] | y_inputs[rand() % 5];
+}
+
+
+
+
+//---------------------------------------
+// Function: record_game
+//
+// Description: Play one game from seed with random input until top out or max_pieces tetrominoes, and fill entry and record
+//
+// Input: uint32_t seed,
+//        uint32_t max_pieces,
+//        tetris_game *game,
+//        replay_entry *entry,
+//        uint8_t *record,
+//        uint16_t *outcomes
+// Output: None
+//
+//---------------------------------------
+static void record_game(uint32_t seed, uint32_t max_pieces, tetris_game *game, replay_entry *entry, uint8_t *record,
+	uint16_t *outcomes)
+{
+	uint32_t state = seed;
+	struct tetromino_location t_loc;
+	int piece_ticks = 0;
+
+	memset(entry, 0, sizeof(*entry));
+	entry->seed = seed;
+
+	host_rand_state = &state;
+	int type = replay_next_tetromino(&t_loc);
+	game_reset(game, &t_loc);
+
+	while (entry->pieces < max_pieces) {
+		uint8_t input = random_input();
+		if (entry->ticks % 2 == 0) {
+			record[entry->ticks / 2] = input;
+		}
+		else {
+			record[entry->ticks / 2] |= input << 4;
+		}
+		entry->ticks++;
+		piece_ticks++;
+
+		int rc = game_step(game, input);
+		if (rc == 0) {
+			continue;
+		}
+
+		uint8_t height = replay_stack_height(game);
+		outcomes[entry->pieces++] = REPLAY_OUTCOME(type, piece_ticks, tetris_rows_removed, height);
+		entry->rows += tetris_rows_removed;
+		if (height > entry->max_height) {
+			entry->max_height = height;
+		}
+		piece_ticks = 0;
+
+		if (rc == -2) {
+			entry->flags |= REPLAY_TOPPED_OUT;
+			break;
+		}
+		type = replay_next_tetromino(&t_loc);
+		game_spawn(game, &t_loc);
+	}
+
+	host_rand_state = &host_rand_default;
+
+	size_t bytes = replay_record_bytes(entry->ticks, entry->pieces);
+	size_t input_bytes = bytes - 2 * (size_t)entry->pieces;
+	memset(record + (entry->ticks + 1) / 2, 0, input_bytes - (entry->ticks + 1) / 2);
+	memcpy(record + input_bytes, outcomes, 2 * (size_t)entry->pieces);
+}
+
+
+
+
+//---------------------------------------
+// Function: cmd_record
+//
+// Description: corpus record
+//
+// Input: int argc,
+//        char **argv
+// Output: int
+//
+//---------------------------------------
+static int cmd_record(int argc, char **argv)
+{
+	unsigned long games = 10000;
+	uint32_t seed = 1;
+	uint32_t max_pieces = 1000;
+
+	for (int i = 3; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-g") == 0) {
+			games = strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			seed = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-p") == 0) {
+			max_pieces = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+		}
+	}
+	if (max_pieces > 0xFFFF) {
+		max_pieces = 0xFFFF;
+	}
+
+	replay_writer *w = malloc(sizeof(*w));
+	uint8_t *record = malloc(replay_record_bytes(max_pieces * GAME_TICKS_PER_TETROMINO, max_pieces));
+	uint16_t *outcomes = malloc(2 * (size_t)max_pieces);
+	static tetris_game game;
+	replay_entry entry;
+
+	if (!w || !record || !outcomes || replay_writer_open(w, argv[2]) < 0) {
+		return 2;
+	}
+	if (w->dropped_bytes) {
+		printf("%s: removed %zu bytes of an incomplete chunk\n", argv[2], w->dropped_bytes);
+	}
+
+	srand(seed);
+	double start = wall_seconds();
+	unsigned long ticks = 0;
+	for (unsigned long g = 0; g < games; g++) {
+		record_game((seed + (uint32_t)g) * 2654435761u, max_pieces, &game, &entry, record, outcomes);
+		ticks += entry.ticks;
+		if (replay_writer_add(w, &entry, record) < 0) {
+			fprintf(stderr, "%s: write failed\n", argv[2]);
+			return 2;
+		}
+	}
+	if (replay_writer_close(w) < 0) {
+		fprintf(stderr, "%s: write failed\n", argv[2]);
+		return 2;
+	}
+
+	double elapsed = wall_seconds() - start;
+	printf("recorded %lu games, %lu ticks in %.2f s (%.0f games/s) to %s\n", games, ticks, elapsed, games / elapsed, argv[2]);
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: cmd_merge
+//
+// Description: corpus merge
+//
+// Input: int argc,
+//        char **argv
+// Output: int
+//
+//---------------------------------------
+static int cmd_merge(int argc, char **argv)
+{
+	replay_writer *w = malloc(sizeof(*w));
+
+	if (!w || replay_writer_open(w, argv[2]) < 0) {
+		return 2;
+	}
+
+	for (int i = 3; i < argc; i++) {
+		replay_corpus c;
+		size_t offset = sizeof(replay_file_header);
+
+		if (replay_open(&c, argv[i]) < 0) {
+			return 2;
+		}
+		for (size_t n = 0; n < c.chunks; n++) {
+			if (replay_writer_add_chunk(w, c.base + offset) < 0) {
+				fprintf(stderr, "%s: write failed\n", argv[2]);
+				return 2;
+			}
+			offset += ((const replay_chunk_header *)(c.base + offset))->bytes;
+		}
+		printf("%s: %zu games in %zu chunks\n", argv[i], c.count, c.chunks);
+		replay_close(&c);
+	}
+
+	unsigned long games = w->games_written;
+	if (replay_writer_close(w) < 0) {
+		fprintf(stderr, "%s: write failed\n", argv[2]);
+		return 2;
+	}
+	printf("appended %lu games to %s\n", games, argv[2]);
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: cmd_filter
+//
+// Description: corpus filter
+//
+// Input: int argc,
+//        char **argv
+// Output: int
+//
+//---------------------------------------
+static int cmd_filter(int argc, char **argv)
+{
+	unsigned long min_height = 0, min_rows = 0, min_pieces = 0;
+	int want_topped_out = 0, want_cut_off = 0;
+	replay_corpus c;
+
+	for (int i = 4; i < argc; i++) {
+		if (strcmp(argv[i], "--min-height") == 0 && i + 1 < argc) {
+			min_height = strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "--min-rows") == 0 && i + 1 < argc) {
+			min_rows = strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "--min-pieces") == 0 && i + 1 < argc) {
+			min_pieces = strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "--topped-out") == 0) {
+			want_topped_out = 1;
+		}
+		else if (strcmp(argv[i], "--cut-off") == 0) {
+			want_cut_off = 1;
+		}
+	}
+
+	replay_writer *w = malloc(sizeof(*w));
+	if (!w || replay_open(&c, argv[2]) < 0 || replay_writer_open(w, argv[3]) < 0) {
+		return 2;
+	}
+
+	for (size_t i = 0; i < c.count; i++) {
+		const replay_entry *e = c.games[i].entry;
+		int topped_out = e->flags & REPLAY_TOPPED_OUT;
+
+		if (e->max_height < min_height || e->rows < min_rows || e->pieces < min_pieces ||
+			(want_topped_out && !topped_out) || (want_cut_off && topped_out)) {
+			continue;
+		}
+		if (replay_writer_add(w, e, c.games[i].record) < 0) {
+			fprintf(stderr, "%s: write failed\n", argv[3]);
+			return 2;
+		}
+	}
+
+	unsigned long games = w->games_written + w->games;
+	if (replay_writer_close(w) < 0) {
+		fprintf(stderr, "%s: write failed\n", argv[3]);
+		return 2;
+	}
+	printf("%lu of %zu games copied to %s\n", games, c.count, argv[3]);
+	replay_close(&c);
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: stats_thread
+//
+// Description: Aggregate games first to last - 1 of the corpus into a corpus_stats
+//
+// Input: void *arg (corpus_stats *)
+// Output: void *
+//
+//---------------------------------------
+static void *stats_thread(void *arg)
+{
+	corpus_stats *s = arg;
+
+	for (size_t i = s->first; i < s->last; i++) {
+		const replay_game *g = &s->c->games[i];
+		const replay_entry *e = g->entry;
+
+		s->games++;
+		s->topped_out += e->flags & REPLAY_TOPPED_OUT;
+		s->ticks += e->ticks;
+		s->pieces += e->pieces;
+		s->rows += e->rows;
+		if (e->pieces > s->max_pieces) {
+			s->max_pieces = e->pieces;
+		}
+		s->game_height[e->max_height <= MAX_HEIGHT ? e->max_height : MAX_HEIGHT]++;
+
+		for (uint32_t p = 0; p < e->pieces; p++) {
+			uint16_t o = g->outcomes[p];
+			s->types[REPLAY_OUTCOME_TYPE(o) % TETROMINO_TYPES]++;
+			s->clears[REPLAY_OUTCOME_ROWS(o) <= 4 ? REPLAY_OUTCOME_ROWS(o) : 4]++;
+			s->timed_out += REPLAY_OUTCOME_TICKS(o) == GAME_TICKS_PER_TETROMINO;
+		}
+	}
+	return NULL;
+}
+
+
+
+
+//---------------------------------------
+// Function: cmd_stats
+//
+// Description: corpus stats
+//
+// Input: int argc,
+//        char **argv
+// Output: int
+//
+//---------------------------------------
+static int cmd_stats(int argc, char **argv)
+{
+	static const char type_names[TETROMINO_TYPES] = {'I', 'O', 'T', 'S', 'Z', 'J', 'L'};
+	int threads = sysconf(_SC_NPROCESSORS_ONLN);
+	replay_corpus c;
+
+	for (int i = 3; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-j") == 0) {
+			threads = atoi(argv[i + 1]);
+		}
+	}
+	if (threads < 1) {
+		threads = 1;
+	}
+
+	if (replay_open(&c, argv[2]) < 0) {
+		return 2;
+	}
+
+	double start = wall_seconds();
+	corpus_stats *s = calloc(threads, sizeof(corpus_stats));
+	pthread_t *tid = malloc(threads * sizeof(pthread_t));
+	for (int t = 0; t < threads; t++) {
+		s[t].c = &c;
+		s[t].first = c.count * t / threads;
+		s[t].last = c.count * (t + 1) / threads;
+		pthread_create(&tid[t], NULL, stats_thread, &s[t]);
+	}
+
+	corpus_stats total = {0};
+	for (int t = 0; t < threads; t++) {
+		pthread_join(tid[t], NULL);
+		total.games += s[t].games;
+		total.topped_out += s[t].topped_out;
+		total.ticks += s[t].ticks;
+		total.pieces += s[t].pieces;
+		total.rows += s[t].rows;
+		total.timed_out += s[t].timed_out;
+		if (s[t].max_pieces > total.max_pieces) {
+			total.max_pieces = s[t].max_pieces;
+		}
+		for (int h = 0; h <= MAX_HEIGHT; h++) {
+			total.game_height[h] += s[t].game_height[h];
+		}
+		for (int p = 0; p < TETROMINO_TYPES; p++) {
+			total.types[p] += s[t].types[p];
+		}
+		for (int r = 0; r < 5; r++) {
+			total.clears[r] += s[t].clears[r];
+		}
+	}
+	double elapsed = wall_seconds() - start;
+
+	double games = total.games ? total.games : 1;
+	double pieces = total.pieces ? total.pieces : 1;
+	printf("%s: %zu games in %zu chunks, %zu bytes (%.1f per game)", argv[2], c.count, c.chunks, c.valid_bytes,
+		c.valid_bytes / games);
+	if (c.valid_bytes != c.size) {
+		printf(", %zu bytes after the last complete chunk ignored", c.size - c.valid_bytes);
+	}
+	printf("\n");
+	printf("topped out %.1f%%, %.1f tetrominoes (max %lu), %.1f ticks and %.2f rows per game\n",
+		100.0 * total.topped_out / games, total.pieces / games, total.max_pieces, total.ticks / games, total.rows / games);
+	printf("tetrominoes completing 0-4 rows: %lu %lu %lu %lu %lu, out of ticks %.2f%%\n", total.clears[0], total.clears[1],
+		total.clears[2], total.clears[3], total.clears[4], 100.0 * total.timed_out / pieces);
+	printf("tetromino types:");
+	for (int p = 0; p < TETROMINO_TYPES; p++) {
+		printf(" %c %.1f%%", type_names[p], 100.0 * total.types[p] / pieces);
+	}
+	printf("\ngames by highest stack:\n");
+	for (int h = 0; h <= MAX_HEIGHT; h++) {
+		if (total.game_height[h]) {
+			printf("  %2d %10lu %5.1f%%\n", h, total.game_height[h], 100.0 * total.game_height[h] / games);
+		}
+	}
+	printf("%d threads, %.3f s (%.1f M tetrominoes/s)\n", threads, elapsed, total.pieces / elapsed / 1e6);
+
+	free(s);
+	free(tid);
+	replay_close(&c);
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: verify_games
+//
+// Description: Replay every jobs-th game from first and count the ones that differ from their record, printing the first few
+//
+// Input: const replay_corpus *c,
+//        size_t first,
+//        int jobs
+// Output: unsigned long
+//
+//---------------------------------------
+static unsigned long verify_games(const replay_corpus *c, size_t first, int jobs)
+{
+	static tetris_game game;
+	unsigned long bad = 0;
+
+	for (size_t i = first; i < c->count; i += jobs) {
+		long differences = replay_run(&c->games[i], &game);
+		if (differences && bad++ < 5) {
+			printf("game %zu (seed 0x%08x): %ld differences\n", i, c->games[i].entry->seed, differences);
+		}
+	}
+	return bad;
+}
+
+
+
+
+//---------------------------------------
+// Function: cmd_verify
+//
+// Description: corpus verify
+//
+// Input: int argc,
+//        char **argv
+// Output: int
+//
+//---------------------------------------
+static int cmd_verify(int argc, char **argv)
+{
+	int jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	replay_corpus c;
+
+	for (int i = 3; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-j") == 0) {
+			jobs = atoi(argv[i + 1]);
+		}
+	}
+	if (jobs < 1) {
+		jobs = 1;
+	}
+
+	if (replay_open(&c, argv[2]) < 0) {
+		return 2;
+	}
+
+	double start = wall_seconds();
+	size_t offset = sizeof(replay_file_header);
+	unsigned long bad_chunks = 0;
+	for (size_t n = 0; n < c.chunks; n++) {
+		bad_chunks += !replay_chunk_crc_ok(c.base + offset);
+		offset += ((const replay_chunk_header *)(c.base + offset))->bytes;
+	}
+
+	// Workers report bad game counts in a shared page
+	unsigned long *bad = mmap(NULL, jobs * sizeof(unsigned long), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (bad == MAP_FAILED) {
+		fprintf(stderr, "out of memory\n");
+		return 2;
+	}
+	fflush(stdout);
+	for (int job = 0; job < jobs; job++) {
+		if (fork() == 0) {
+			bad[job] = verify_games(&c, job, jobs);
+			fflush(stdout);
+			_exit(0);
+		}
+	}
+
+	unsigned long bad_games = 0;
+	int failed = 0;
+	for (int job = 0; job < jobs; job++) {
+		int status;
+		wait(&status);
+		failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+	}
+	for (int job = 0; job < jobs; job++) {
+		bad_games += bad[job];
+	}
+	double elapsed = wall_seconds() - start;
+
+	unsigned long ticks = 0;
+	for (size_t i = 0; i < c.count; i++) {
+		ticks += c.games[i].entry->ticks;
+	}
+	printf("%s: %lu of %zu chunks fail CRC, %lu of %zu games differ on replay\n", argv[2], bad_chunks, c.chunks, bad_games,
+		c.count);
+	printf("%d jobs, %.3f s (%.0f games/s, %.2f M ticks/s)\n", jobs, elapsed, c.count / elapsed, ticks / elapsed / 1e6);
+
+	replay_close(&c);
+	return (bad_chunks || bad_games || failed) ? 1 : 0;
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	if (argc >= 3 && strcmp(argv[1], "record") == 0) {
+		return cmd_record(argc, argv);
+	}
+	if (argc >= 4 && strcmp(argv[1], "merge") == 0) {
+		return cmd_merge(argc, argv);
+	}
+	if (argc >= 4 && strcmp(argv[1], "filter") == 0) {
+		return cmd_filter(argc, argv);
+	}
+	if (argc >= 3 && strcmp(argv[1], "stats") == 0) {
+		return cmd_stats(argc, argv);
+	}
+	if (argc >= 3 && strcmp(argv[1], "verify") == 0) {
+		return cmd_verify(argc, argv);
+	}
+
+	fprintf(stderr,
+		"usage: corpus record <file> [-g games] [-s seed] [-p max tetrominoes per game]\n"
+		"       corpus merge <file> <input>...\n"
+		"       corpus filter <input> <file> [--min-height h] [--min-rows n] [--min-pieces n] [--topped-out] [--cut-off]\n"
+		"       corpus stats <file> [-j threads]\n"
+		"       corpus verify <file> [-j jobs]\n");
+	return 2;
+}
@@ -0,0 +1,381 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Differential equivalence harness
+//
+// Plays the firmware engine (Tetris.h through Game.h) and the candidate
+// engine (Bitboard.h) side by side from random seeds and random joystick
+// input, and compares tetris_state rows 0-3, the LCD character codes
+// (rows 4-5), the falling tetromino and the tick result after every tick.
+// On a mismatch the input sequence is shrunk to a minimal one that still
+// reproduces it.
+//
+// Build: gcc -O2 -o equivalence host/equivalence.c
+// Usage: equivalence [-n ticks] [-s seed] [-l ticks per game] [-j jobs] [--fault]
+//        -j forks jobs worker processes, each taking every jobs-th seed
+//        --fault plants a bug in the candidate to check the harness finds it
+// ---------------------------------------------------------------------------
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "avr_host.h"
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "Game.h"
+#include "Bitboard.h"
+
+
+#define MAX_TRACE 100000
+
+
+static tetris_game legacy;
+static bitboard_game candidate;
+static uint8_t trace[MAX_TRACE];
+static char mismatch[256];
+
+
+
+
+//---------------------------------------
+// Function: next_random
+//
+// Description: xorshift32 generator for joystick input (independent of rand(), which picks tetrominoes)
+//
+// Input: uint32_t *state
+// Output: uint32_t
+//
+//---------------------------------------
+static inline uint32_t next_random(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+
+
+
+//---------------------------------------
+// Function: compare_engines
+//
+// Description: Compare board, LCD output, falling tetromino and tick result of both engines
+//
+// Input: int legacy_rc,
+//        int candidate_rc
+// Output: int
+//		  -1 = Engines differ, description in mismatch
+//         0 = Engines agree
+//
+//---------------------------------------
+static int compare_engines(int legacy_rc, int candidate_rc)
+{
+	uint8_t lcd[2][BITBOARD_ROWS];
+
+	if (legacy_rc != candidate_rc) {
+		snprintf(mismatch, sizeof(mismatch), "tick result %d vs %d", legacy_rc, candidate_rc);
+		return -1;
+	}
+
+	for (int x = 0; x < 4; x++) {
+		for (int y = 0; y < BITBOARD_ROWS; y++) {
+			uint8_t expected = ((candidate.columns[x] >> y) & 1) ? 0x03 : 0x00;
+			if (legacy.tetris_state[x][y] != expected) {
+				snprintf(mismatch, sizeof(mismatch), "tetris_state[%d][%d] = 0x%02X vs 0x%02X", x, y, legacy.tetris_state[x][y], expected);
+				return -1;
+			}
+		}
+	}
+
+	bitboard_render(&candidate, lcd);
+	for (int i = 0; i < 2; i++) {
+		if (memcmp(legacy.tetris_state[i + 4], lcd[i], BITBOARD_ROWS) != 0) {
+			snprintf(mismatch, sizeof(mismatch), "LCD line %d differs", i);
+			return -1;
+		}
+	}
+
+	struct tetromino_location *t = &legacy.t_loc;
+	if (t->orientation != candidate.orientation || t->center_x != candidate.center_x || t->center_y != candidate.center_y ||
+	t->block1_x != candidate.block_x[0] || t->block1_y != candidate.block_y[0] ||
+	t->block2_x != candidate.block_x[1] || t->block2_y != candidate.block_y[1] ||
+	t->block3_x != candidate.block_x[2] || t->block3_y != candidate.block_y[2]) {
+		snprintf(mismatch, sizeof(mismatch), "tetromino o=%d c=(%d,%d) vs o=%d c=(%d,%d)",
+			t->orientation, t->center_x, t->center_y, candidate.orientation, candidate.center_x, candidate.center_y);
+		return -1;
+	}
+
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: spawn_both
+//
+// Description: Draw the next tetromino with rand() and start it in both engines
+//
+// Input: int new_game
+// Output: None
+//
+//---------------------------------------
+static void spawn_both(int new_game)
+{
+	struct tetromino_location t_loc;
+	init_random_tetromino(&t_loc);
+
+	if (new_game) {
+		game_reset(&legacy, &t_loc);
+		memset(candidate.columns, 0, sizeof(candidate.columns));
+	}
+	else {
+		game_spawn(&legacy, &t_loc);
+	}
+	bitboard_spawn(&candidate, &t_loc);
+	bitboard_update_blocks(&candidate); // Blocks are computed on spawn, as load_tetromino does
+}
+
+
+
+
+//---------------------------------------
+// Function: run_trace
+//
+// Description: Play both engines from seed with the given inputs
+//
+// Input: unsigned seed,
+//        const uint8_t *inputs,
+//        int length
+// Output: int
+//		  -1 = Engines agree for all ticks
+//		  Otherwise index of first tick where they differ
+//
+//---------------------------------------
+static int run_trace(unsigned seed, const uint8_t *inputs, int length)
+{
+	srand(seed);
+	spawn_both(1);
+
+	for (int i = 0; i < length; i++) {
+		int legacy_rc = game_step(&legacy, inputs[i]);
+		int candidate_rc = bitboard_step(&candidate, inputs[i]);
+
+		if (compare_engines(legacy_rc, candidate_rc) != 0) {
+			return i;
+		}
+
+		if (legacy_rc != 0) {
+			spawn_both(legacy_rc == -2);
+		}
+	}
+
+	return -1;
+}
+
+
+
+
+//---------------------------------------
+// Function: shrink_trace
+//
+// Description: Delta-debug inputs down to a short sequence that still makes the engines differ:
+//              drop chunks of ticks, then replace single inputs with INPUT_NONE
+//
+// Input: unsigned seed,
+//        uint8_t *inputs,
+//        int length (inputs[length - 1] is the first tick that differs)
+// Output: int
+//		  Length of shrunk sequence
+//
+//---------------------------------------
+static int shrink_trace(unsigned seed, uint8_t *inputs, int length)
+{
+	static uint8_t attempt[MAX_TRACE];
+
+	for (int chunk = length / 2; chunk >= 1; chunk /= 2) {
+		for (int start = 0; start + chunk <= length; ) {
+			memcpy(attempt, inputs, start);
+			memcpy(attempt + start, inputs + start + chunk, length - start - chunk);
+
+			int fail = run_trace(seed, attempt, length - chunk);
+			if (fail >= 0) {
+				length = fail + 1;
+				memcpy(inputs, attempt, length);
+			}
+			else {
+				start += chunk;
+			}
+		}
+	}
+
+	for (int i = 0; i < length; i++) {
+		if (inputs[i] == INPUT_NONE) {
+			continue;
+		}
+		uint8_t saved = inputs[i];
+		inputs[i] = INPUT_NONE;
+
+		int fail = run_trace(seed, inputs, length);
+		if (fail >= 0) {
+			length = fail + 1;
+		}
+		else {
+			inputs[i] = saved;
+		}
+	}
+
+	return length;
+}
+
+
+
+
+//---------------------------------------
+// Function: input_name
+//
+// Description: Short text for an input, as used in the shrunk sequence report
+//
+// Input: uint8_t input
+// Output: const char *
+//
+//---------------------------------------
+static const char *input_name(uint8_t input)
+{
+	static const char *x_names[] = {"", "L", "R", "?"};
+	static const char *y_names[] = {"", "D", "U", "?"};
+	static char name[4];
+
+	snprintf(name, sizeof(name), "%s%s", x_names[input & INPUT_X_MASK], y_names[(input & INPUT_Y_MASK) >> 2]);
+	if (name[0] == '\0') {
+		return ".";
+	}
+	return name;
+}
+
+
+
+
+//---------------------------------------
+// Function: run_seeds
+//
+// Description: Run games of game_length random ticks from seed, seed + stride, ... till total_ticks are done
+//
+// Input: unsigned seed,
+//        unsigned stride,
+//        unsigned long total_ticks,
+//        int game_length
+// Output: int
+//		  1 = Engines differ (shrunk sequence printed)
+//		  0 = Engines agree
+//
+//---------------------------------------
+static int run_seeds(unsigned seed, unsigned stride, unsigned long total_ticks, int game_length)
+{
+	static const uint8_t inputs[] = {
+		INPUT_NONE, INPUT_NONE, INPUT_NONE, INPUT_LEFT, INPUT_RIGHT, INPUT_DOWN, INPUT_ROTATE,
+		INPUT_LEFT | INPUT_DOWN, INPUT_LEFT | INPUT_ROTATE, INPUT_RIGHT | INPUT_DOWN, INPUT_RIGHT | INPUT_ROTATE,
+	};
+
+	for (unsigned long ticks = 0; ticks < total_ticks; seed += stride) {
+		uint32_t input_state = seed * 2654435761u + 1;
+
+		for (int i = 0; i < game_length; i++) {
+			trace[i] = inputs[next_random(&input_state) % sizeof(inputs)];
+		}
+
+		int fail = run_trace(seed, trace, game_length);
+		if (fail >= 0) {
+			printf("MISMATCH seed %u tick %d: %s\n", seed, fail, mismatch);
+
+			int length = shrink_trace(seed, trace, fail + 1);
+			run_trace(seed, trace, length);
+
+			printf("shrunk to %d ticks: %s\n  inputs:", length, mismatch);
+			for (int i = 0; i < length; i++) {
+				printf(" %s", input_name(trace[i]));
+			}
+			printf("\n");
+			fflush(stdout);
+			return 1;
+		}
+
+		ticks += game_length;
+	}
+
+	return 0;
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	unsigned long total_ticks = 10000000;
+	unsigned seed = 1;
+	int game_length = 2000;
+	int jobs = 1;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--fault") == 0) {
+			bitboard_fault = 1;
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			total_ticks = strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = (unsigned)strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			game_length = (int)strtol(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			jobs = (int)strtol(argv[++i], NULL, 0);
+		}
+	}
+	if (game_length < 1 || game_length > MAX_TRACE) {
+		game_length = MAX_TRACE;
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	int failed = 0;
+
+	if (jobs <= 1) {
+		failed = run_seeds(seed, 1, total_ticks, game_length);
+		if (!failed) {
+			printf("engines agree: %lu tetrominoes, %lu games\n", legacy.pieces, legacy.games);
+		}
+	}
+	else {
+		// Engine and host shim state are globals, so workers are processes
+		fflush(stdout);
+		for (int job = 0; job < jobs; job++) {
+			if (fork() == 0) {
+				exit(run_seeds(seed + job, jobs, total_ticks / jobs, game_length));
+			}
+		}
+		for (int job = 0; job < jobs; job++) {
+			int status;
+			wait(&status);
+			failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	if (failed) {
+		return 1;
+	}
+
+	printf("%lu ticks in %d job(s), %.0f ticks/s (both engines)\n", total_ticks, jobs, total_ticks / seconds);
+	return 0;
+}
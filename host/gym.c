@@ -0,0 +1,441 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Environment API (Gym.h) on the bitboard engine
+//
+// Build as a shared library:  gcc -O2 -fPIC -shared -o libtetris_gym.so host/gym.c
+// or with a program:          gcc -O2 -o prog prog.c host/gym.c
+// ---------------------------------------------------------------------------
+
+#include "avr_host.h"
+#include "Rand.h"
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "Game.h"
+#include "Bitboard.h"
+#include "MoveGen.h"
+#include "Gym.h"
+
+
+_Static_assert(sizeof(bitboard_game) <= sizeof(((gym_env *)0)->engine), "GYM_ENGINE_WORDS too small for bitboard_game");
+
+
+const uint8_t gym_inputs[GYM_ACTIONS] = {
+	INPUT_NONE, INPUT_LEFT, INPUT_RIGHT, INPUT_DOWN, INPUT_ROTATE,
+	INPUT_LEFT | INPUT_DOWN, INPUT_RIGHT | INPUT_DOWN, INPUT_LEFT | INPUT_ROTATE, INPUT_RIGHT | INPUT_ROTATE,
+};
+
+
+//Block 1-3 offsets per tetromino type and orientation, from init_tetromino
+static int8_t gym_offset_x[TETROMINO_TYPES][4][3], gym_offset_y[TETROMINO_TYPES][4][3];
+static int8_t gym_orientation[TETROMINO_TYPES]; // Spawn orientation, -1 = drawn from the generator
+static int8_t gym_spawn_x, gym_spawn_y;
+
+
+
+
+//---------------------------------------
+// Function: gym_engine
+//
+// Description: Bitboard engine state of an environment
+//
+// Input: const gym_env *env
+// Output: bitboard_game *
+//
+//---------------------------------------
+static inline bitboard_game *gym_engine(const gym_env *env)
+{
+	return (bitboard_game *)env->engine;
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_init
+//
+// Description: Build the tetromino tables. Call once before any other function
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void gym_init(void)
+{
+	uint32_t state = 1;
+	uint32_t *saved_state = host_rand_state;
+
+	host_rand_state = &state; // Only to see which types draw their orientation
+	for (int p = 0; p < TETROMINO_TYPES; p++) {
+		struct tetromino_location t_loc;
+		bitboard_game bb;
+
+		uint32_t before = state;
+
+		init_tetromino(p, &t_loc);
+		bitboard_spawn(&bb, &t_loc);
+		gym_orientation[p] = state != before ? -1 : t_loc.orientation;
+		memcpy(gym_offset_x[p], bb.offset_x, sizeof(bb.offset_x));
+		memcpy(gym_offset_y[p], bb.offset_y, sizeof(bb.offset_y));
+		gym_spawn_x = bb.center_x;
+		gym_spawn_y = bb.center_y;
+	}
+	host_rand_state = saved_state;
+
+	movegen_init();
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_spawn
+//
+// Description: Start the next tetromino from the environment's generator, as init_random_tetromino and game_spawn
+//
+// Input: gym_env *env
+// Output: None
+//
+//---------------------------------------
+static inline void gym_spawn(gym_env *env)
+{
+	bitboard_game *bb = gym_engine(env);
+	int type = host_rand_r(&env->rng) % TETROMINO_TYPES;
+
+	memcpy(bb->offset_x, gym_offset_x[type], sizeof(bb->offset_x));
+	memcpy(bb->offset_y, gym_offset_y[type], sizeof(bb->offset_y));
+	bb->orientation = gym_orientation[type] < 0 ? host_rand_r(&env->rng) % 4 : gym_orientation[type];
+	bb->center_x = gym_spawn_x;
+	bb->center_y = gym_spawn_y;
+	bitboard_update_blocks(bb); // Blocks are computed on spawn, as load_tetromino does
+	bb->ticks_left = GAME_TICKS_PER_TETROMINO;
+
+	env->piece = type;
+	env->piece_ticks = 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_observe
+//
+// Description: Fill an observation from the environment
+//
+// Input: const gym_env *env,
+//        gym_obs *obs
+// Output: None
+//
+//---------------------------------------
+static inline void gym_observe(const gym_env *env, gym_obs *obs)
+{
+	const bitboard_game *bb = gym_engine(env);
+
+	memcpy(obs->board, bb->columns, sizeof(obs->board));
+	obs->piece = env->piece;
+	obs->orientation = bb->orientation;
+	obs->x = bb->center_x;
+	obs->y = bb->center_y;
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_reset
+//
+// Description: Start an episode: empty board and the first tetromino from seed
+//
+// Input: gym_env *env,
+//        uint32_t seed,
+//        gym_obs *obs (may be NULL)
+// Output: None
+//
+//---------------------------------------
+void gym_reset(gym_env *env, uint32_t seed, gym_obs *obs)
+{
+	uint32_t episodes = env->episodes + 1;
+	uint32_t illegal = env->illegal;
+
+	memset(env, 0, sizeof(*env));
+	env->rng = seed;
+	env->seed = seed;
+	env->episodes = episodes;
+	env->illegal = illegal;
+	gym_spawn(env);
+
+	if (obs) {
+		gym_observe(env, obs);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_piece_done
+//
+// Description: Count a finished tetromino and start the next one unless the episode is over
+//
+// Input: gym_env *env,
+//        int rc (bitboard_step result)
+// Output: int
+//		  1 = Episode over
+//		  0 = Episode goes on
+//
+//---------------------------------------
+static inline int gym_piece_done(gym_env *env, int rc)
+{
+	env->pieces++;
+	env->rows += gym_engine(env)->rows_removed;
+
+	if (rc == -2) {
+		return 1;
+	}
+	gym_spawn(env);
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_step
+//
+// Description: Run one tick with joystick input gym_inputs[action]. Once the episode is over, call gym_reset
+//
+// Input: gym_env *env,
+//        int action (0 - GYM_ACTIONS - 1),
+//        gym_obs *obs (may be NULL),
+//        int *reward (rows removed)
+// Output: int
+//		  1 = Episode over
+//		  0 = Episode goes on
+//
+//---------------------------------------
+int gym_step(gym_env *env, int action, gym_obs *obs, int *reward)
+{
+	bitboard_game *bb = gym_engine(env);
+	int rc = bitboard_step(bb, gym_inputs[action]);
+	int done = 0;
+
+	env->ticks++;
+	env->piece_ticks++;
+	*reward = 0;
+	if (rc != 0) {
+		*reward = bb->rows_removed;
+		done = gym_piece_done(env, rc);
+	}
+
+	if (obs) {
+		gym_observe(env, obs);
+	}
+	return done;
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_legal_placements
+//
+// Description: Placements MoveGen.h lists as legal for the falling tetromino (none once it has been stepped)
+//
+// Input: const gym_env *env
+// Output: uint16_t
+//		  Bit p set = placement p is legal
+//
+//---------------------------------------
+uint16_t gym_legal_placements(const gym_env *env)
+{
+	const uint32_t *board = gym_engine(env)->columns;
+	uint16_t in_bounds = movegen_in_bounds[env->piece];
+	uint16_t fits = 0;
+
+	if (env->piece_ticks) {
+		return 0;
+	}
+
+	for (int m = 0; m < MOVEGEN_MOVES; m++) {
+		const uint32_t *pos = &movegen_spawn[env->piece][0][m];
+		if (!((board[0] & pos[0]) | (board[1] & pos[1 * MOVEGEN_MOVES]) | (board[2] & pos[2 * MOVEGEN_MOVES]) |
+			(board[3] & pos[3 * MOVEGEN_MOVES]))) {
+			fits |= 1 << m;
+		}
+	}
+	return movegen_reachable(fits & in_bounds, in_bounds);
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_place
+//
+// Description: Play the falling tetromino out: drop it from the spawn row in placement's orientation and column if that is
+//              legal, else let it fall with no input (counted in env->illegal). Once the episode is over, call gym_reset
+//
+// Input: gym_env *env,
+//        int placement (orientation * 4 + center column),
+//        gym_obs *obs (may be NULL),
+//        int *reward (rows removed)
+// Output: int
+//		  1 = Episode over
+//		  0 = Episode goes on
+//
+//---------------------------------------
+int gym_place(gym_env *env, int placement, gym_obs *obs, int *reward)
+{
+	bitboard_game *bb = gym_engine(env);
+	int rc;
+
+	if ((gym_legal_placements(env) >> placement) & 1) {
+		bb->orientation = placement / 4;
+		bb->center_x = placement % 4;
+		bitboard_update_blocks(bb);
+		do {
+			env->ticks++;
+		} while (bitboard_fall(bb) == 0); // Fewer rows than GAME_TICKS_PER_TETROMINO to fall
+		bb->rows_removed = bitboard_remove_complete_rows(bb);
+		rc = ((bb->columns[0] | bb->columns[1] | bb->columns[2] | bb->columns[3]) >> 15) & 1 ? -2 : -1;
+	}
+	else {
+		env->illegal++;
+		do {
+			env->ticks++;
+		} while ((rc = bitboard_step(bb, INPUT_NONE)) == 0);
+	}
+
+	*reward = bb->rows_removed;
+	int done = gym_piece_done(env, rc);
+	if (obs) {
+		gym_observe(env, obs);
+	}
+	return done;
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_step_batch
+//
+// Description: Step count environments, each with its own action (gym_step, or gym_place when placement is set). A finished
+//              environment is reset at once with its generator's state as the next seed; its observation is the new
+//              episode's and its done flag is set
+//
+// Input: gym_env *envs,
+//        const uint8_t *actions,
+//        size_t count,
+//        int placement,
+//        gym_obs *obs,
+//        int8_t *rewards,
+//        uint8_t *dones
+// Output: None
+//
+//---------------------------------------
+void gym_step_batch(gym_env *envs, const uint8_t *actions, size_t count, int placement, gym_obs *obs, int8_t *rewards,
+	uint8_t *dones)
+{
+	for (size_t i = 0; i < count; i++) {
+		int reward;
+		int done = placement ? gym_place(&envs[i], actions[i], NULL, &reward) : gym_step(&envs[i], actions[i], NULL, &reward);
+
+		if (done) {
+			gym_reset(&envs[i], envs[i].rng, NULL);
+		}
+		gym_observe(&envs[i], &obs[i]);
+		rewards[i] = reward;
+		dones[i] = done;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: gym_check
+//
+// Description: Play random step and place actions on an environment and on the firmware engine (Tetris.h through Game.h)
+//              side by side, comparing board, reward and episode end after every action. Not thread safe (the firmware
+//              engine's state is global)
+//
+// Input: uint32_t seed,
+//        long ticks
+// Output: long
+//		  Number of mismatches (first few printed on stderr)
+//
+//---------------------------------------
+long gym_check(uint32_t seed, long ticks)
+{
+	static tetris_game game;
+	struct tetromino_location t_loc;
+	uint32_t *saved_state = host_rand_state;
+	uint32_t firmware_rng = seed;
+	uint32_t input_rng = seed ^ 0x9E3779B9u;
+	gym_env env = {0};
+	gym_obs obs;
+	long mismatches = 0;
+
+	gym_reset(&env, seed, &obs);
+	host_rand_state = &firmware_rng;
+	init_random_tetromino(&t_loc);
+	game_reset(&game, &t_loc);
+
+	for (long tick = 0; tick < ticks; ) {
+		int reward, done, rc;
+
+		if (env.piece_ticks == 0 && host_rand_r(&input_rng) % 4 == 0) {
+			int p = host_rand_r(&input_rng) % GYM_PLACEMENTS;
+			int legal = (gym_legal_placements(&env) >> p) & 1;
+			uint32_t before = env.ticks;
+
+			done = gym_place(&env, p, &obs, &reward);
+			tick += env.ticks - before;
+			if (legal) {
+				game.t_loc.orientation = p / 4;
+				game.t_loc.center_x = p % 4;
+				update_tetromino_location_struct(&game.t_loc);
+			}
+			while ((rc = game_step(&game, INPUT_NONE)) == 0);
+		}
+		else {
+			int a = host_rand_r(&input_rng) % GYM_ACTIONS;
+
+			done = gym_step(&env, a, &obs, &reward);
+			rc = game_step(&game, gym_inputs[a]);
+			tick++;
+		}
+
+		int wrong = done != (rc == -2) || reward != (rc != 0 ? tetris_rows_removed : 0);
+		for (int x = 0; x < 4; x++) {
+			for (int y = 0; y < GYM_ROWS; y++) {
+				wrong |= ((obs.board[x] >> y) & 1) != (game.tetris_state[x][y] != 0);
+			}
+		}
+		if (wrong && mismatches++ < 5) {
+			fprintf(stderr, "gym_check: seed 0x%08x episode %u tick %u: environment and firmware differ\n", seed,
+				env.episodes, env.ticks);
+		}
+
+		if (done) {
+			gym_reset(&env, env.rng, &obs);
+			firmware_rng = env.seed;
+		}
+		if (rc != 0) {
+			init_random_tetromino(&t_loc);
+			if (rc == -2) {
+				game_reset(&game, &t_loc);
+			}
+			else {
+				game_spawn(&game, &t_loc);
+			}
+		}
+	}
+
+	host_rand_state = saved_state;
+	return mismatches;
+}
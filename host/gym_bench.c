@@ -0,0 +1,191 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: throughput of the environment API (Gym.h)
+//
+// Checks environments against the firmware engine first (gym_check), then
+// steps a batch of environments with gym_step_batch for a while, splitting
+// the batch over threads, and reports steps per second. Actions are drawn
+// from a table filled up front, so the timed loop only steps environments.
+//
+// Build: gcc -O2 -pthread -o gym_bench host/gym_bench.c host/gym.c
+// Usage: gym_bench [-n environments] [-s seed] [-t seconds] [-j threads] [-p 1 = placement actions]
+// ---------------------------------------------------------------------------
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Gym.h"
+
+
+#define BENCH_ACTION_TABLE 4096 // Random actions, power of two
+
+
+//Slice of the batch stepped by one thread
+typedef struct bench_slice {
+
+	gym_env *envs;
+	gym_obs *obs;
+	int8_t *rewards;
+	uint8_t *dones;
+	size_t count;
+	int placement;
+	double seconds;
+	size_t offset; // First action in bench_actions
+
+	unsigned long steps, episodes, rows;
+
+} bench_slice;
+
+
+static uint8_t bench_actions[BENCH_ACTION_TABLE + 1024];
+
+
+
+
+//---------------------------------------
+// Function: wall_seconds
+//
+// Description: Monotonic wall clock time
+//
+// Input: None
+// Output: double
+//
+//---------------------------------------
+static double wall_seconds()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_thread
+//
+// Description: Step a slice with gym_step_batch for at least slice->seconds, taking actions from bench_actions
+//
+// Input: void *arg (bench_slice *)
+// Output: void *
+//
+//---------------------------------------
+static void *bench_thread(void *arg)
+{
+	bench_slice *s = arg;
+	size_t offset = s->offset;
+	double start = wall_seconds();
+
+	do {
+		// Batches of at most 1024 so the action window stays inside the table
+		for (size_t i = 0; i < s->count; i += 1024) {
+			size_t n = s->count - i < 1024 ? s->count - i : 1024;
+
+			gym_step_batch(&s->envs[i], &bench_actions[offset], n, s->placement, &s->obs[i], &s->rewards[i], &s->dones[i]);
+			for (size_t j = 0; j < n; j++) {
+				s->episodes += s->dones[i + j];
+				s->rows += s->rewards[i + j];
+			}
+			offset = (offset + 61) & (BENCH_ACTION_TABLE - 1);
+		}
+		s->steps += s->count;
+	} while (wall_seconds() - start < s->seconds);
+
+	return NULL;
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	size_t count = 1 << 12;
+	unsigned seed = 1;
+	double seconds = 1.0;
+	int threads = 1;
+	int placement = 0;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) {
+			count = strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			seed = (unsigned)strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-t") == 0) {
+			seconds = atof(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-j") == 0) {
+			threads = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-p") == 0) {
+			placement = atoi(argv[i + 1]) != 0;
+		}
+	}
+	if (count == 0 || threads < 1 || (size_t)threads > count) {
+		fprintf(stderr, "need at least one environment per thread\n");
+		return 2;
+	}
+
+	gym_env *envs = calloc(count, sizeof(*envs));
+	gym_obs *obs = malloc(count * sizeof(*obs));
+	int8_t *rewards = malloc(count);
+	uint8_t *dones = malloc(count);
+	bench_slice *slices = calloc(threads, sizeof(*slices));
+	pthread_t *ids = malloc(threads * sizeof(*ids));
+	if (!envs || !obs || !rewards || !dones || !slices || !ids) {
+		fprintf(stderr, "out of memory\n");
+		return 2;
+	}
+
+	gym_init();
+
+	long mismatches = gym_check(seed, 1000000);
+	printf("gym_check: 1000000 ticks against the firmware engine, %ld mismatches\n", mismatches);
+
+	srand(seed);
+	for (size_t i = 0; i < sizeof(bench_actions); i++) {
+		bench_actions[i] = rand() % (placement ? GYM_PLACEMENTS : GYM_ACTIONS);
+	}
+	for (size_t i = 0; i < count; i++) {
+		gym_reset(&envs[i], seed + i, &obs[i]);
+	}
+
+	double start = wall_seconds();
+	for (int t = 0; t < threads; t++) {
+		size_t first = count * t / threads;
+		size_t last = count * (t + 1) / threads;
+
+		slices[t] = (bench_slice){.envs = &envs[first], .obs = &obs[first], .rewards = &rewards[first],
+			.dones = &dones[first], .count = last - first, .placement = placement, .seconds = seconds,
+			.offset = first & (BENCH_ACTION_TABLE - 1)};
+		pthread_create(&ids[t], NULL, bench_thread, &slices[t]);
+	}
+
+	unsigned long steps = 0, episodes = 0, rows = 0, illegal = 0;
+	for (int t = 0; t < threads; t++) {
+		pthread_join(ids[t], NULL);
+		steps += slices[t].steps;
+		episodes += slices[t].episodes;
+		rows += slices[t].rows;
+	}
+	double elapsed = wall_seconds() - start;
+	for (size_t i = 0; i < count; i++) {
+		illegal += envs[i].illegal;
+	}
+
+	printf("%zu environments, %d thread(s), %s actions: %.2f M steps/s (%.1f ns/step)\n", count, threads,
+		placement ? "placement" : "step", steps / elapsed / 1e6, elapsed * 1e9 / steps * threads);
+	printf("%lu steps, %lu episodes, %.2f rows per episode", steps, episodes, episodes ? (double)rows / episodes : 0.0);
+	if (placement) {
+		printf(", %.1f%% illegal placements", 100.0 * illegal / steps);
+	}
+	printf("\n");
+
+	return mismatches != 0;
+}
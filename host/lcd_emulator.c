@@ -0,0 +1,270 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: boot the firmware against the HD44780 model, play a game
+// with random joystick input and report boot phase times (the firmware's
+// own TETRIS_BOOT_REPORT line), time to first frame, bus time per frame,
+// timing violations and the final screen.
+//
+// Build: gcc -O2 -o lcd_emulator host/lcd_emulator.c
+// Usage: lcd_emulator [frames] [seed] [-v] [-t trace.vcd] [-b] [-e]
+//        -v prints the screen after every frame
+//        -b runs the on-device benchmarks (tetris/Bench.h) instead of a game
+//        -e checks that the model flags Enable pulses with no hold delay
+//        -t writes the LCD pins and profiling phases to a VCD file (Vcd.h)
+//        Built with -DTETRIS_AUTOPLAY, the game plays tetris/PolicyTable.h instead
+//        Built with -DLCD_PANELS=N, the board is N panels tall and each panel
+//        has its own controller model; bus time per frame covers all panels
+// ---------------------------------------------------------------------------
+
+#ifndef TETRIS_BOOT_REPORT
+#define TETRIS_BOOT_REPORT
+#endif
+#ifndef TETRIS_BENCH
+#define TETRIS_BENCH
+#endif
+
+#include "avr_host.h"
+
+static void emulator_marker(uint8_t marker);
+#define PROFILE_HOOK(marker) emulator_marker(marker)
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "usart_host.h"
+#include "../tetris/Boot.h"
+#ifdef TETRIS_AUTOPLAY
+#include "../tetris/PolicyTable.h"
+#endif
+#include "../tetris/Tetris.h"
+#include "../tetris/Bench.h"
+
+#include "Game.h"
+#include "HD44780.h"
+#include "Vcd.h"
+
+
+
+
+//---------------------------------------
+// Function: emulator_marker
+//
+// Description: PROFILE_HOOK. Write the marker to the VCD trace, if one is open
+//
+// Input: uint8_t marker
+// Output: None
+//
+//---------------------------------------
+static void emulator_marker(uint8_t marker)
+{
+	vcd_marker(&host_vcd, host_time_ns, marker);
+}
+
+
+
+
+//---------------------------------------
+// Function: random_input
+//
+// Description: Pick a random joystick input, biased towards rest
+//
+// Input: None
+// Output: uint8_t
+//
+//---------------------------------------
+static uint8_t random_input()
+{
+	static const uint8_t x_inputs[] = {INPUT_LEFT, INPUT_NONE, INPUT_NONE, INPUT_NONE, INPUT_RIGHT};
+	static const uint8_t y_inputs[] = {INPUT_DOWN, INPUT_NONE, INPUT_NONE, INPUT_NONE, INPUT_ROTATE};
+
+	return x_inputs[rand() % 5] | y_inputs[rand() % 5];
+}
+
+
+
+
+//---------------------------------------
+// Function: emulator_report
+//
+// Description: Print bus statistics of every panel
+//
+// Input: None
+// Output: unsigned long
+//		  Timing violations on all panels
+//
+//---------------------------------------
+static unsigned long emulator_report()
+{
+	unsigned long violations = 0;
+
+	for (int panel = 0; panel < LCD_PANELS; panel++) {
+		if (LCD_PANELS > 1) {
+			printf("panel %d: ", panel);
+		}
+		hd44780_report(&host_lcds[panel], stdout);
+		violations += host_lcds[panel].violations;
+	}
+	return violations;
+}
+
+
+
+
+//---------------------------------------
+// Function: emulator_pulse_check
+//
+// Description: Send Display On (as LCD_init leaves it) with two Enable pulses that have no hold delay, as a driver
+//              that drops the delay from pulse_enable_pin would (about 125 ns on the board). The model must latch
+//              both nibbles and flag both pulses as shorter than PW_EH
+//
+// Input: None
+// Output: int
+//		  0 = Both pulses latched and flagged
+//		  1 = The model missed them
+//
+//---------------------------------------
+static int emulator_pulse_check()
+{
+	_delay_ms(1); // Controller idle, so only the pulse width is wrong
+
+	unsigned long nibbles = host_lcd.nibbles;
+	unsigned long short_pulses = host_lcd.short_pulses;
+
+	disable_bit(PORTB,RS);
+	PORTB = (PORTB & 0xC3) | ((CURSOR_DISABLED >> 2) & 0x3C);
+	enable_bit(PORTB,ENABLE);
+	disable_bit(PORTB,ENABLE);
+	PORTB = (PORTB & 0xC3) | ((CURSOR_DISABLED << 2) & 0x3C);
+	enable_bit(PORTB,ENABLE);
+	disable_bit(PORTB,ENABLE);
+	_delay_ms(1);
+
+	nibbles = host_lcd.nibbles - nibbles;
+	short_pulses = host_lcd.short_pulses - short_pulses;
+	printf("zero-hold Enable pulses: nibbles +%lu, short +%lu\n", nibbles, short_pulses);
+	return (nibbles == 2 && short_pulses == 2) ? 0 : 1;
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	long frames = 200;
+	unsigned seed = 1;
+	int verbose = 0;
+	int bench = 0;
+	int pulse_check = 0;
+	int positional = 0;
+	const char *trace = NULL;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-v") == 0) {
+			verbose = 1;
+		}
+		else if (strcmp(argv[i], "-b") == 0) {
+			bench = 1;
+		}
+		else if (strcmp(argv[i], "-e") == 0) {
+			pulse_check = 1;
+		}
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			trace = argv[++i];
+		}
+		else if (positional++ == 0) {
+			frames = strtol(argv[i], NULL, 0);
+		}
+		else {
+			seed = (unsigned)strtoul(argv[i], NULL, 0);
+		}
+	}
+
+	hd44780_attach();
+	if (trace && vcd_attach(trace) != 0) {
+		perror(trace);
+		return 2;
+	}
+	host_usart_fd = STDOUT_FILENO; // Boot report goes to stdout
+
+	// Same boot sequence as main
+	PROFILE_BEGIN(PROFILE_BOOT);
+	BOOT_START();
+	setup_AVR_ports();
+	BOOT_TIMESTAMP(BOOT_PORTS);
+	setup_ADC();
+	BOOT_TIMESTAMP(BOOT_ADC);
+	LCD_init();
+	BOOT_TIMESTAMP(BOOT_LCD);
+	create_tetris_characters();
+	BOOT_TIMESTAMP(BOOT_GLYPHS);
+	setup_USART();
+	PROFILE_END(PROFILE_BOOT);
+
+	printf("boot: %.3f ms\n", host_time_ns / 1000000.0);
+	fflush(stdout);
+
+	if (pulse_check) {
+		return emulator_pulse_check();
+	}
+
+	if (bench) {
+		bench_run(NULL); // Results line over the USART, as on the board
+		hd44780_render(host_lcds, LCD_PANELS, stdout);
+		return emulator_report() ? 1 : 0;
+	}
+
+	srand(seed);
+	static tetris_game game;
+	struct tetromino_location t_loc;
+	init_random_tetromino(&t_loc);
+	game_reset(&game, &t_loc);
+
+	while ((long)host_lcd.frames < frames) {
+		uint8_t input = random_input();
+
+		for (int panel = 0; panel < LCD_PANELS; panel++) {
+			hd44780_frame_begin(&host_lcds[panel]);
+		}
+		int rc = game_step(&game, input);
+		for (int panel = 0; panel < LCD_PANELS; panel++) {
+			hd44780_frame_end(&host_lcds[panel]);
+		}
+
+		if (host_lcd.frames == 1) {
+			printf("time to first frame: %.3f ms%s\n", host_time_ns / 1000000.0,
+				host_lcd.display_on ? "" : " (display still off)");
+		}
+
+		if (verbose) {
+			printf("frame %lu: %.1f us\n", host_lcd.frames, host_lcd.frame_last_ns / 1000.0);
+			hd44780_render(host_lcds, LCD_PANELS, stdout);
+		}
+
+		if (rc == 0) {
+			_delay_ms(TETRIS_TICK_LENGTH);
+			continue;
+		}
+
+		init_random_tetromino(&t_loc);
+		if (rc == -2) {
+			game_reset(&game, &t_loc); // Game over, Tetris() starts again
+		}
+		else {
+			game_spawn(&game, &t_loc);
+		}
+	}
+
+	hd44780_render(host_lcds, LCD_PANELS, stdout);
+	unsigned long violations = emulator_report();
+
+	if (trace) {
+		unsigned long changes = host_vcd.changes;
+		if (vcd_close() != 0) {
+			perror(trace);
+			return 2;
+		}
+		printf("trace: %lu changes written to %s\n", changes, trace);
+	}
+
+	return violations ? 1 : 0;
+}
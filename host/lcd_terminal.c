@@ -0,0 +1,487 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: play the firmware in a Linux terminal, in real time.
+//
+// Three threads share nothing but atomics:
+//   engine  boots the firmware against the HD44780 model and runs one
+//           tetris_tick per TETRIS_TICK_LENGTH of wall time (the virtual
+//           clock, LCD bus waits included, is paced against the wall
+//           clock), then publishes a copy of the LCD to a triple buffer
+//   input   reads keys from the terminal in place of the ADC. A terminal
+//           sends no key release, so every key pressed since the last tick
+//           counts as held at that tick, as with TETRIS_INPUT_ISR
+//   render  takes the newest frame from the triple buffer about 60 times
+//           a second and draws the 16x2 screen with tick and frame timing
+// The engine never waits for the terminal: publishing a frame is one
+// atomic exchange, and frames the renderer was too slow for are dropped.
+//
+// Keys: arrows or a/d/s/w = left, right, down, rotate; f = fast-forward
+// on/off; q = quit
+//
+// Build: gcc -O2 -pthread -o lcd_terminal host/lcd_terminal.c
+// Usage: lcd_terminal [-s seed] [-x speed] [-n ticks]
+//        -x sets the fast-forward speed (default 8 times real time)
+//        -n stops after that many ticks (default: run till q)
+// ---------------------------------------------------------------------------
+
+#include <time.h>
+#include <pthread.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "avr_host.h"
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "Game.h"
+#include "HD44780.h"
+
+#if LCD_PANELS > 1
+#error "lcd_terminal shows one panel, use host/lcd_emulator.c for LCD_PANELS"
+#endif
+
+
+#define TERMINAL_RENDER_NS 16666667ULL // Render period, 60 frames per second
+#define TERMINAL_SLEEP_NS 20000000ULL // Longest engine sleep between checks for quit
+#define TERMINAL_FRESH 0x04 // triple_buffer.middle: slot holds a frame not taken yet
+
+
+//Frame published by the engine, with the numbers shown under the screen
+typedef struct terminal_frame {
+
+	hd44780 lcd; // Controller state after the tick
+	unsigned long ticks, pieces, games, rows;
+	uint64_t tick_ns; // Wall time spent in the last tetris_tick
+	double ticks_per_second; // Over the last second of wall time
+	int fast; // Fast-forward on
+
+} terminal_frame;
+
+
+//Single producer, single consumer triple buffer. The engine writes slots[back] and swaps it with middle, the renderer
+//swaps front with middle when middle holds a fresh frame. Neither side ever waits for the other
+typedef struct triple_buffer {
+
+	terminal_frame slots[3];
+	uint8_t back; // Engine only
+	uint8_t front; // Renderer only
+	uint8_t middle; // Shared: slot index | TERMINAL_FRESH
+
+} triple_buffer;
+
+
+static triple_buffer terminal_frames = {.back = 0, .middle = 1, .front = 2};
+static uint8_t terminal_input; // Keys pressed since the last tick (Game.h INPUT_*), shared with the input thread
+static int terminal_fast; // Fast-forward on, set by the input thread
+static int terminal_quit;
+static double terminal_speed = 8.0;
+static long terminal_max_ticks = -1;
+static unsigned long terminal_published; // Frames published, read by the renderer for the dropped count
+static struct termios terminal_saved;
+static int terminal_raw;
+
+
+
+
+//---------------------------------------
+// Function: wall_ns
+//
+// Description: Monotonic wall clock time
+//
+// Input: None
+// Output: uint64_t
+//
+//---------------------------------------
+static uint64_t wall_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+
+
+//---------------------------------------
+// Function: sleep_until
+//
+// Description: Sleep till wall_ns() reaches deadline or terminal_quit is set
+//
+// Input: uint64_t deadline
+// Output: None
+//
+//---------------------------------------
+static void sleep_until(uint64_t deadline)
+{
+	for (uint64_t now = wall_ns(); now < deadline && !__atomic_load_n(&terminal_quit, __ATOMIC_RELAXED); now = wall_ns()) {
+		uint64_t ns = deadline - now < TERMINAL_SLEEP_NS ? deadline - now : TERMINAL_SLEEP_NS;
+		struct timespec ts = {(time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL)};
+		nanosleep(&ts, NULL);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: frame_write
+//
+// Description: Slot the engine fills next
+//
+// Input: triple_buffer *b
+// Output: terminal_frame *
+//
+//---------------------------------------
+static inline terminal_frame *frame_write(triple_buffer *b)
+{
+	return &b->slots[b->back];
+}
+
+
+
+
+//---------------------------------------
+// Function: frame_publish
+//
+// Description: Make the slot from frame_write the newest frame. The renderer's unread frame, if any, becomes the next
+//              slot to write
+//
+// Input: triple_buffer *b
+// Output: None
+//
+//---------------------------------------
+static inline void frame_publish(triple_buffer *b)
+{
+	b->back = __atomic_exchange_n(&b->middle, b->back | TERMINAL_FRESH, __ATOMIC_ACQ_REL) & ~TERMINAL_FRESH;
+}
+
+
+
+
+//---------------------------------------
+// Function: frame_take
+//
+// Description: Take the newest frame, if one has been published since the last call
+//
+// Input: triple_buffer *b
+// Output: const terminal_frame *
+//		  NULL = No new frame
+//
+//---------------------------------------
+static inline const terminal_frame *frame_take(triple_buffer *b)
+{
+	if (!(__atomic_load_n(&b->middle, __ATOMIC_RELAXED) & TERMINAL_FRESH)) {
+		return NULL;
+	}
+	b->front = __atomic_exchange_n(&b->middle, b->front, __ATOMIC_ACQ_REL) & ~TERMINAL_FRESH;
+	return &b->slots[b->front];
+}
+
+
+
+
+//---------------------------------------
+// Function: input_press
+//
+// Description: Hold a key till the next tick. Replaces any other key pressed on the same axis since the last tick
+//
+// Input: uint8_t input (one INPUT_* value)
+// Output: None
+//
+//---------------------------------------
+static void input_press(uint8_t input)
+{
+	uint8_t mask = (input & INPUT_X_MASK) ? INPUT_X_MASK : INPUT_Y_MASK;
+	uint8_t old = __atomic_load_n(&terminal_input, __ATOMIC_RELAXED);
+
+	while (!__atomic_compare_exchange_n(&terminal_input, &old, (old & ~mask) | input, 1, __ATOMIC_RELAXED,
+		__ATOMIC_RELAXED));
+}
+
+
+
+
+//---------------------------------------
+// Function: input_thread
+//
+// Description: Read keys from stdin till q or end of input
+//
+// Input: void *arg (unused)
+// Output: void *
+//
+//---------------------------------------
+static void *input_thread(void *arg)
+{
+	unsigned char c;
+	int escape = 0; // Bytes of an arrow key sequence (ESC [ A-D) read so far
+
+	(void)arg;
+	while (read(STDIN_FILENO, &c, 1) == 1) {
+		if (escape == 1) {
+			escape = c == '[' ? 2 : 0;
+			continue;
+		}
+		if (escape == 2) {
+			escape = 0;
+			c = c == 'A' ? 'w' : c == 'B' ? 's' : c == 'C' ? 'd' : c == 'D' ? 'a' : 0;
+		}
+
+		switch (c) {
+		case 0x1B: escape = 1; break;
+		case 'a': input_press(INPUT_LEFT); break;
+		case 'd': input_press(INPUT_RIGHT); break;
+		case 's': input_press(INPUT_DOWN); break;
+		case 'w': input_press(INPUT_ROTATE); break;
+		case 'f': __atomic_xor_fetch(&terminal_fast, 1, __ATOMIC_RELAXED); break;
+		case 'q':
+		case 0x03: // Ctrl-C, raw mode does not raise SIGINT
+			__atomic_store_n(&terminal_quit, 1, __ATOMIC_RELAXED);
+			return NULL;
+		}
+	}
+
+	if (terminal_raw) {
+		__atomic_store_n(&terminal_quit, 1, __ATOMIC_RELAXED); // Terminal closed
+	}
+	return NULL;
+}
+
+
+
+
+//---------------------------------------
+// Function: engine_thread
+//
+// Description: Boot the firmware and run ticks at real time (or terminal_speed times it), publishing a frame after each
+//
+// Input: void *arg (unsigned *, seed)
+// Output: void *
+//
+//---------------------------------------
+static void *engine_thread(void *arg)
+{
+	static tetris_game game;
+	struct tetromino_location t_loc;
+	unsigned long rows = 0;
+
+	// Same boot sequence as main
+	hd44780_attach();
+	setup_AVR_ports();
+	setup_ADC();
+	LCD_init();
+	create_tetris_characters();
+
+	srand(*(unsigned *)arg);
+	init_random_tetromino(&t_loc);
+	game_reset(&game, &t_loc);
+
+	// Virtual time anchor_virtual is due at wall time anchor_wall. Moved on whenever the speed changes
+	int fast = 0;
+	uint64_t anchor_wall = wall_ns(), anchor_virtual = host_time_ns;
+	uint64_t second_wall = anchor_wall;
+	unsigned long second_ticks = 0;
+	double ticks_per_second = 0.0;
+
+	while (!__atomic_load_n(&terminal_quit, __ATOMIC_RELAXED) &&
+		(terminal_max_ticks < 0 || (long)game.ticks < terminal_max_ticks)) {
+
+		uint8_t input = __atomic_exchange_n(&terminal_input, INPUT_NONE, __ATOMIC_RELAXED);
+		uint64_t start = wall_ns();
+
+		hd44780_frame_begin(&host_lcd);
+		int rc = game_step(&game, input);
+		hd44780_frame_end(&host_lcd);
+
+		uint64_t tick_ns = wall_ns() - start;
+
+		if (rc != 0) {
+			rows += tetris_rows_removed;
+			init_random_tetromino(&t_loc);
+			if (rc == -2) {
+				game_reset(&game, &t_loc); // Game over, Tetris() starts again
+			}
+			else {
+				game_spawn(&game, &t_loc);
+			}
+		}
+
+		if (start - second_wall >= 1000000000ULL) {
+			ticks_per_second = (game.ticks - second_ticks) * 1e9 / (start - second_wall);
+			second_wall = start;
+			second_ticks = game.ticks;
+		}
+
+		terminal_frame *f = frame_write(&terminal_frames);
+		f->lcd = host_lcd;
+		f->ticks = game.ticks;
+		f->pieces = game.pieces;
+		f->games = game.games;
+		f->rows = rows;
+		f->tick_ns = tick_ns;
+		f->ticks_per_second = ticks_per_second;
+		f->fast = fast;
+		__atomic_store_n(&terminal_published, terminal_published + 1, __ATOMIC_RELAXED); // Counted first, so never below drawn
+		frame_publish(&terminal_frames);
+
+		_delay_ms(TETRIS_TICK_LENGTH); // As tetris_tick_wait
+
+		int now_fast = __atomic_load_n(&terminal_fast, __ATOMIC_RELAXED);
+		if (now_fast != fast) {
+			anchor_wall = wall_ns();
+			anchor_virtual = host_time_ns - (uint64_t)(TETRIS_TICK_LENGTH * 1000000ULL); // Next tick one period from now
+			fast = now_fast;
+		}
+		sleep_until(anchor_wall + (uint64_t)((host_time_ns - anchor_virtual) / (fast ? terminal_speed : 1.0)));
+	}
+
+	__atomic_store_n(&terminal_quit, 1, __ATOMIC_RELEASE); // After the last frame_publish
+	return NULL;
+}
+
+
+
+
+//---------------------------------------
+// Function: render_frame
+//
+// Description: Draw a frame over the last one
+//
+// Input: const terminal_frame *f,
+//        unsigned long dropped,
+//        double fps
+// Output: None
+//
+//---------------------------------------
+static void render_frame(const terminal_frame *f, unsigned long dropped, double fps)
+{
+	fputs("\x1B[H", stdout); // Cursor home
+	hd44780_render((hd44780 *)&f->lcd, 1, stdout);
+	printf("tick %lu  games %lu  tetrominoes %lu  rows %lu\x1B[K\n", f->ticks, f->games, f->pieces, f->rows);
+	printf("tick %.1f us wall, %.1f us LCD bus, %lu bytes, %.2f ticks/s%s\x1B[K\n", f->tick_ns / 1000.0,
+		f->lcd.frame_last_ns / 1000.0, f->lcd.frame_last_bytes, f->ticks_per_second,
+		f->fast ? "  FAST-FORWARD" : "");
+	printf("render %.1f frames/s, %lu frames dropped\x1B[K\n", fps, dropped);
+	printf("arrows/wasd move, f fast-forward, q quit\x1B[K\n");
+	fflush(stdout);
+}
+
+
+
+
+//---------------------------------------
+// Function: render_thread
+//
+// Description: Draw the newest frame every TERMINAL_RENDER_NS till terminal_quit is set
+//
+// Input: void *arg (unused)
+// Output: void *
+//
+//---------------------------------------
+static void *render_thread(void *arg)
+{
+	unsigned long drawn = 0, second_drawn = 0;
+	uint64_t second_wall = wall_ns();
+	double fps = 0.0;
+
+	(void)arg;
+	fputs("\x1B[2J", stdout); // Clear screen
+
+	for (uint64_t next = wall_ns(); ; next += TERMINAL_RENDER_NS) {
+		int quit = __atomic_load_n(&terminal_quit, __ATOMIC_ACQUIRE);
+		const terminal_frame *f = frame_take(&terminal_frames);
+		uint64_t now = wall_ns();
+
+		if (now - second_wall >= 1000000000ULL) {
+			fps = (drawn - second_drawn) * 1e9 / (now - second_wall);
+			second_wall = now;
+			second_drawn = drawn;
+		}
+
+		if (f) {
+			drawn++;
+			render_frame(f, __atomic_load_n(&terminal_published, __ATOMIC_RELAXED) - drawn, fps);
+		}
+
+		if (quit) {
+			return NULL; // Last frame drawn above
+		}
+		sleep_until(next + TERMINAL_RENDER_NS);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: terminal_restore
+//
+// Description: atexit handler. Put the terminal back in the mode it was in
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void terminal_restore()
+{
+	if (terminal_raw) {
+		tcsetattr(STDIN_FILENO, TCSAFLUSH, &terminal_saved);
+		terminal_raw = 0;
+	}
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	unsigned seed = (unsigned)time(NULL);
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			seed = (unsigned)strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+			terminal_speed = strtod(argv[++i], NULL);
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			terminal_max_ticks = strtol(argv[++i], NULL, 0);
+		}
+		else {
+			fprintf(stderr, "usage: %s [-s seed] [-x speed] [-n ticks]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (terminal_speed <= 0.0) {
+		terminal_speed = 1.0;
+	}
+
+	// Keys one at a time, not echoed (stdin may also be a pipe of keys)
+	if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &terminal_saved) == 0) {
+		struct termios raw = terminal_saved;
+		raw.c_lflag &= ~(ICANON | ECHO | ISIG);
+		raw.c_cc[VMIN] = 1;
+		raw.c_cc[VTIME] = 0;
+		if (tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) == 0) {
+			terminal_raw = 1;
+			atexit(terminal_restore);
+		}
+	}
+
+	pthread_t engine, input, render;
+
+	pthread_create(&render, NULL, render_thread, NULL);
+	pthread_create(&engine, NULL, engine_thread, &seed);
+	pthread_create(&input, NULL, input_thread, NULL); // Left blocked in read at exit
+	pthread_detach(input);
+
+	pthread_join(engine, NULL);
+	pthread_join(render, NULL);
+
+	hd44780_report(&host_lcd, stdout);
+	terminal_restore();
+	return host_lcd.violations ? 1 : 0;
+}
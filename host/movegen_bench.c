@@ -0,0 +1,265 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: benchmark the batch legal-move generator (MoveGen.h)
+//
+// Builds a batch of boards by self-play (random legal moves, new game on
+// top out), checks the AVX2 kernel against the scalar one on every board
+// and both against the firmware engine (drop with update_tetris_state,
+// then remove_complete_rows) on every legal move, and reports boards and
+// legal moves per second for each kernel.
+//
+// Build: gcc -O2 -o movegen_bench host/movegen_bench.c
+// Usage: movegen_bench [-n boards] [-s seed] [-t seconds per kernel]
+// ---------------------------------------------------------------------------
+
+#include <time.h>
+
+#include "avr_host.h"
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "MoveGen.h"
+
+
+
+
+//---------------------------------------
+// Function: wall_seconds
+//
+// Description: Monotonic wall clock time
+//
+// Input: None
+// Output: double
+//
+//---------------------------------------
+static double wall_seconds()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//---------------------------------------
+// Function: self_play
+//
+// Description: Fill boards and pieces by playing random legal moves from an empty board, starting again on top out
+//
+// Input: uint32_t boards[][4],
+//        uint8_t pieces[],
+//        size_t count
+// Output: None
+//
+//---------------------------------------
+static void self_play(uint32_t boards[][4], uint8_t pieces[], size_t count)
+{
+	uint32_t board[4] = {0, 0, 0, 0};
+	movegen_result r;
+
+	for (size_t i = 0; i < count; i++) {
+		memcpy(boards[i], board, sizeof(board));
+		pieces[i] = rand() % MOVEGEN_PIECES;
+		movegen_board_scalar(board, pieces[i], &r);
+
+		int pick = r.legal ? rand() % __builtin_popcount(r.legal) : -1;
+		for (int m = 0; m < MOVEGEN_MOVES && pick >= 0; m++) {
+			if (((r.legal >> m) & 1) && pick-- == 0) {
+				for (int x = 0; x < 4; x++) {
+					board[x] = r.columns[x][m];
+				}
+			}
+		}
+
+		if (!r.legal || ((board[0] | board[1] | board[2] | board[3]) >> 15)) {
+			memset(board, 0, sizeof(board)); // Top out, Tetris() starts again
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: check_firmware
+//
+// Description: Play move m of piece on board with the firmware engine and compare landing row, rows completed and the result below
+//              row 17 - rows completed (remove_complete_rows leaves the rows above as they were).
+//              Skipped (returns 0) when a block ends up at row 15 or higher, which ends the game
+//
+// Input: const uint32_t board[4],
+//        int piece,
+//        int m,
+//        const movegen_result *r
+// Output: int
+//		  -1 = Mismatch
+//         0 = Skipped
+//         1 = Match
+//
+//---------------------------------------
+static int check_firmware(const uint32_t board[4], int piece, int m, const movegen_result *r)
+{
+	uint8_t tetris_state[6][19];
+	struct tetromino_location t_loc;
+
+	memset(tetris_state, 0, sizeof(tetris_state));
+	for (int x = 0; x < 4; x++) {
+		for (int y = 0; y < MOVEGEN_ROWS; y++) {
+			tetris_state[x][y] = ((board[x] >> y) & 1) ? 0x03 : 0x00;
+		}
+	}
+
+	init_tetromino(piece, &t_loc);
+	t_loc.orientation = m / 4;
+	t_loc.center_x = m % 4;
+	t_loc.center_y = MOVEGEN_SPAWN_Y;
+	update_tetromino_location_struct(&t_loc);
+
+	while (update_tetris_state(&t_loc, 19, tetris_state) == 0);
+
+	for (int x = 0; x < 4; x++) {
+		for (int y = 15; y < MOVEGEN_ROWS; y++) {
+			if (tetris_state[x][y]) {
+				return 0;
+			}
+		}
+	}
+
+	int lines = remove_complete_rows(19, tetris_state);
+	if (t_loc.center_y != r->landing_y[m] || lines != r->lines[m]) {
+		return -1;
+	}
+	for (int x = 0; x < 4; x++) {
+		for (int y = 0; y < 17 - lines; y++) {
+			if ((tetris_state[x][y] != 0) != ((r->columns[x][m] >> y) & 1)) {
+				return -1;
+			}
+		}
+	}
+	return 1;
+}
+
+
+
+
+//---------------------------------------
+// Function: bench
+//
+// Description: Run movegen_batch over the whole batch for at least seconds and print boards and legal moves per second
+//
+// Input: const char *name,
+//        const uint32_t boards[][4],
+//        const uint8_t pieces[],
+//        size_t count,
+//        movegen_result results[],
+//        int scalar,
+//        double seconds
+// Output: None
+//
+//---------------------------------------
+static void bench(const char *name, const uint32_t boards[][4], const uint8_t pieces[], size_t count, movegen_result results[],
+	int scalar, double seconds)
+{
+	unsigned long passes = 0;
+	unsigned long legal = 0;
+	double start = wall_seconds();
+	double elapsed;
+
+	do {
+		movegen_batch(boards, pieces, count, results, scalar);
+		passes++;
+		elapsed = wall_seconds() - start;
+	} while (elapsed < seconds);
+
+	for (size_t i = 0; i < count; i++) {
+		legal += __builtin_popcount(results[i].legal);
+	}
+
+	printf("%-6s %8.2f M boards/s, %8.2f M legal moves/s (%lu passes)\n", name, passes * count / elapsed / 1e6,
+		passes * legal / elapsed / 1e6, passes);
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	size_t count = 1 << 16;
+	unsigned seed = 1;
+	double seconds = 1.0;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) {
+			count = strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			seed = (unsigned)strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-t") == 0) {
+			seconds = atof(argv[i + 1]);
+		}
+	}
+
+	uint32_t (*boards)[4] = malloc(count * sizeof(*boards));
+	uint8_t *pieces = malloc(count);
+	movegen_result *scalar = malloc(count * sizeof(*scalar));
+	movegen_result *vector = malloc(count * sizeof(*vector));
+	if (!boards || !pieces || !scalar || !vector) {
+		fprintf(stderr, "out of memory\n");
+		return 2;
+	}
+
+	srand(seed);
+	movegen_init();
+	self_play(boards, pieces, count);
+
+	// Check kernels against each other and the firmware engine
+	movegen_batch(boards, pieces, count, scalar, 1);
+	movegen_batch(boards, pieces, count, vector, 0);
+
+	unsigned long mismatches = 0, agree = 0, checked = 0, skipped = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (memcmp(&scalar[i], &vector[i], sizeof(movegen_result)) == 0) {
+			agree++;
+		}
+		else {
+			if (mismatches++ < 5) {
+				printf("kernel mismatch: board %zu piece %d\n", i, pieces[i]);
+			}
+		}
+		for (int m = 0; m < MOVEGEN_MOVES; m++) {
+			if (!((scalar[i].legal >> m) & 1)) {
+				continue;
+			}
+			int rc = check_firmware(boards[i], pieces[i], m, &scalar[i]);
+			if (rc < 0 && mismatches++ < 5) {
+				printf("firmware mismatch: board %zu piece %d move %d\n", i, pieces[i], m);
+			}
+			checked += rc > 0;
+			skipped += rc == 0;
+		}
+	}
+	printf("%zu boards: kernels agree on %lu, %lu legal moves match the firmware engine (%lu near the top skipped)\n",
+		count, agree, checked, skipped);
+
+	bench("scalar", boards, pieces, count, scalar, 1, seconds);
+#ifdef MOVEGEN_AVX2
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+		bench("avx2", boards, pieces, count, vector, 0, seconds);
+	}
+	else {
+		printf("avx2   not supported by this CPU\n");
+	}
+#endif
+
+	if (mismatches) {
+		printf("%lu mismatches\n", mismatches);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,547 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Placement policy solver for TETRIS_AUTOPLAY
+//
+// The playfield is 4 columns wide, so the surface of a low stack (each
+// column's height above the lowest one, 0 to POLICY_STEPS - 1) takes only
+// POLICY_STEPS^4 values. For every surface and tetromino the solver runs an
+// expectimax search over the next tetrominoes (each of the 7 equally
+// likely, the best placement chosen for each) and keeps the placement with
+// the most expected reward: rows completed, less a cost for each hole left
+// under the surface and for a column pushed past the highest step, plus a
+// bumpiness term at the search horizon. Placements, rows completed and the
+// board after them come from MoveGen.h on the board the surface stands for
+// (no holes), and the surface after a placement is taken over any holes.
+//
+// Values of (surface, plies left) are shared between all root searches in
+// a lock-free transposition table, one 64-bit word per entry, and the roots
+// are split across threads. The hit rate is reported.
+//
+// The policy is written to tetris/PolicyTable.h as one 4-bit move
+// (orientation * 4 + center column) per surface and tetromino, stored in
+// PROGMEM: with -DTETRIS_AUTOPLAY the firmware plays by looking up the
+// surface under each new tetromino (autoplay_choose in Tetris.h). The solver
+// then plays the table on real boards (holes and all, top out at row 15)
+// against the greedy one-ply policy and reports tetrominoes per game and
+// rows per tetromino.
+//
+// Build: gcc -O2 -pthread -o policy_solver host/policy_solver.c
+// Usage: policy_solver [-d plies] [-j threads] [-g games] [-s seed] [-o tetris/PolicyTable.h]
+// ---------------------------------------------------------------------------
+
+#include <time.h>
+#include <pthread.h>
+
+#include "avr_host.h"
+#include "Rand.h"
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "MoveGen.h"
+
+
+#define POLICY_STEPS 5 // Column heights above the lowest column, 0 to POLICY_STEPS - 1
+#define POLICY_SURFACES (POLICY_STEPS * POLICY_STEPS * POLICY_STEPS * POLICY_STEPS)
+#define POLICY_MAX_PLIES 12
+
+#define REWARD_ROW 1.0f // Per row completed
+#define COST_HOLE 3.0f // Per empty cell left under the surface
+#define COST_OVERFLOW 3.0f // Per column pushed past POLICY_STEPS - 1 above the lowest
+#define COST_BUMP 0.15f // Per step between neighbouring columns, at the horizon
+#define COST_NO_MOVE 20.0f // Tetromino with no legal placement
+
+#define TT_BITS 18 // Transposition table entries = 1 << TT_BITS
+#define TT_PROBES 4 // Slots tried from the hashed one
+
+#define EVAL_MAX_PIECES 5000 // Games are cut off after this many tetrominoes
+
+
+//One placement of one tetromino on one surface
+typedef struct policy_move {
+
+	uint16_t surface; // Surface after it
+	float reward;
+
+} policy_move;
+
+
+//Per thread search counters
+typedef struct solver_thread {
+
+	int first, step; // Root surfaces first, first + step, ...
+	int plies;
+	uint8_t *table; // [piece][surface] move, written for this thread's roots
+	unsigned long probes, hits, nodes;
+
+} solver_thread;
+
+
+static policy_move policy_moves[POLICY_SURFACES][MOVEGEN_PIECES][MOVEGEN_MOVES];
+static uint16_t policy_legal[POLICY_SURFACES][MOVEGEN_PIECES];
+static uint8_t policy_normal[POLICY_SURFACES]; // Lowest column at 0 (the only surfaces looked up)
+static float policy_horizon[POLICY_SURFACES];
+static uint64_t tt[1 << TT_BITS]; // Key in the high 32 bits (0 = empty), value (float) in the low 32
+
+
+
+
+//---------------------------------------
+// Function: wall_seconds
+//
+// Description: Monotonic wall clock time
+//
+// Input: None
+// Output: double
+//
+//---------------------------------------
+static double wall_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+
+
+//---------------------------------------
+// Function: surface_of
+//
+// Description: Surface code of a board, POLICY_STEPS - 1 for taller columns. Also returns the number of columns that were
+//              clipped, and the empty cells under the top block of each column
+//
+// Input: const uint32_t board[4],
+//        int *clipped,
+//        int *holes
+// Output: uint16_t
+//
+//---------------------------------------
+static uint16_t surface_of(const uint32_t board[4], int *clipped, int *holes)
+{
+	int height[4], low = MOVEGEN_ROWS;
+	uint16_t code = 0;
+
+	*clipped = 0;
+	*holes = 0;
+	for (int x = 0; x < 4; x++) {
+		height[x] = board[x] ? 32 - __builtin_clz(board[x]) : 0;
+		*holes += height[x] - __builtin_popcount(board[x]);
+		low = height[x] < low ? height[x] : low;
+	}
+	for (int x = 3; x >= 0; x--) {
+		int step = height[x] - low;
+		if (step >= POLICY_STEPS) {
+			step = POLICY_STEPS - 1;
+			(*clipped)++;
+		}
+		code = code * POLICY_STEPS + step;
+	}
+	return code;
+}
+
+
+
+
+//---------------------------------------
+// Function: policy_init
+//
+// Description: Build the move table: the board each surface stands for, every placement on it from MoveGen.h and the
+//              surface and reward after it
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void policy_init()
+{
+	movegen_init();
+
+	for (int s = 0; s < POLICY_SURFACES; s++) {
+		uint32_t board[4];
+		int step[4], low = POLICY_STEPS, bump = 0;
+
+		for (int x = 0, code = s; x < 4; x++, code /= POLICY_STEPS) {
+			step[x] = code % POLICY_STEPS;
+			board[x] = (1u << step[x]) - 1;
+			low = step[x] < low ? step[x] : low;
+		}
+		for (int x = 0; x < 3; x++) {
+			bump += abs(step[x] - step[x + 1]);
+		}
+		policy_normal[s] = low == 0;
+		policy_horizon[s] = -COST_BUMP * bump;
+
+		for (int p = 0; p < MOVEGEN_PIECES; p++) {
+			movegen_result r;
+			movegen_board_scalar(board, p, &r);
+			policy_legal[s][p] = r.legal;
+
+			for (int m = 0; m < MOVEGEN_MOVES; m++) {
+				uint32_t after[4] = {r.columns[0][m], r.columns[1][m], r.columns[2][m], r.columns[3][m]};
+				int clipped, holes;
+
+				policy_moves[s][p][m].surface = surface_of(after, &clipped, &holes);
+				policy_moves[s][p][m].reward = REWARD_ROW * r.lines[m] - COST_HOLE * holes - COST_OVERFLOW * clipped;
+			}
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: tt_probe
+//
+// Description: Look up the value of a surface with plies left in the transposition table
+//
+// Input: uint32_t key,
+//        float *value
+// Output: int
+//
+//---------------------------------------
+static inline int tt_probe(uint32_t key, float *value)
+{
+	uint32_t slot = (key * 2654435761u) >> (32 - TT_BITS);
+
+	for (int i = 0; i < TT_PROBES; i++) {
+		uint64_t entry = __atomic_load_n(&tt[(slot + i) & ((1 << TT_BITS) - 1)], __ATOMIC_RELAXED);
+		if ((uint32_t)(entry >> 32) == key) {
+			uint32_t bits = (uint32_t)entry;
+			memcpy(value, &bits, sizeof(*value));
+			return 1;
+		}
+		if (entry == 0) {
+			return 0;
+		}
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: tt_store
+//
+// Description: Store a value in the first free probe slot, or over the last one. Entries are single words, so a reader
+//              never sees half of one
+//
+// Input: uint32_t key,
+//        float value
+// Output: None
+//
+//---------------------------------------
+static inline void tt_store(uint32_t key, float value)
+{
+	uint32_t slot = (key * 2654435761u) >> (32 - TT_BITS);
+	uint32_t bits;
+	uint64_t *target = NULL;
+
+	memcpy(&bits, &value, sizeof(bits));
+	for (int i = 0; i < TT_PROBES; i++) {
+		target = &tt[(slot + i) & ((1 << TT_BITS) - 1)];
+		uint64_t entry = __atomic_load_n(target, __ATOMIC_RELAXED);
+		if (entry == 0 || (uint32_t)(entry >> 32) == key) {
+			break;
+		}
+	}
+	__atomic_store_n(target, (uint64_t)key << 32 | bits, __ATOMIC_RELAXED);
+}
+
+
+
+
+//---------------------------------------
+// Function: solve_value
+//
+// Description: Expected reward of a surface over the next plies tetrominoes, placing each one to the best
+//
+// Input: uint16_t surface,
+//        int plies,
+//        solver_thread *t
+// Output: float
+//
+//---------------------------------------
+static float solve_value(uint16_t surface, int plies, solver_thread *t)
+{
+	if (plies == 0) {
+		return policy_horizon[surface];
+	}
+
+	uint32_t key = ((uint32_t)surface << 4 | plies) + 1;
+	float value;
+
+	t->probes++;
+	if (tt_probe(key, &value)) {
+		t->hits++;
+		return value;
+	}
+	t->nodes++;
+
+	float total = 0;
+	for (int p = 0; p < MOVEGEN_PIECES; p++) {
+		float best = -COST_NO_MOVE;
+		for (uint16_t legal = policy_legal[surface][p]; legal; legal &= legal - 1) {
+			const policy_move *mv = &policy_moves[surface][p][__builtin_ctz(legal)];
+			float v = mv->reward + solve_value(mv->surface, plies - 1, t);
+			best = v > best ? v : best;
+		}
+		total += best;
+	}
+
+	value = total / MOVEGEN_PIECES;
+	tt_store(key, value);
+	return value;
+}
+
+
+
+
+//---------------------------------------
+// Function: solve_thread
+//
+// Description: Pick the best move for every tetromino on this thread's share of the surfaces
+//
+// Input: void *arg (solver_thread *)
+// Output: void *
+//
+//---------------------------------------
+static void *solve_thread(void *arg)
+{
+	solver_thread *t = arg;
+
+	for (int s = t->first; s < POLICY_SURFACES; s += t->step) {
+		if (!policy_normal[s]) {
+			continue;
+		}
+		for (int p = 0; p < MOVEGEN_PIECES; p++) {
+			float best = 0;
+			int best_move = -1;
+			for (uint16_t legal = policy_legal[s][p]; legal; legal &= legal - 1) {
+				int m = __builtin_ctz(legal);
+				float v = policy_moves[s][p][m].reward + solve_value(policy_moves[s][p][m].surface, t->plies - 1, t);
+				if (best_move < 0 || v > best) {
+					best = v;
+					best_move = m;
+				}
+			}
+			t->table[p * POLICY_SURFACES + s] = best_move < 0 ? 0 : best_move;
+		}
+	}
+	return NULL;
+}
+
+
+
+
+//---------------------------------------
+// Function: solve
+//
+// Description: Fill table ([piece][surface] move) with a search of plies tetrominoes on threads threads
+//
+// Input: uint8_t *table,
+//        int plies,
+//        int threads
+// Output: None
+//
+//---------------------------------------
+static void solve(uint8_t *table, int plies, int threads)
+{
+	solver_thread *t = calloc(threads, sizeof(*t));
+	pthread_t *ids = calloc(threads, sizeof(*ids));
+	double start = wall_seconds();
+
+	memset(tt, 0, sizeof(tt));
+	memset(table, 0, MOVEGEN_PIECES * POLICY_SURFACES);
+	for (int i = 0; i < threads; i++) {
+		t[i] = (solver_thread){i, threads, plies, table, 0, 0, 0};
+		pthread_create(&ids[i], NULL, solve_thread, &t[i]);
+	}
+
+	unsigned long probes = 0, hits = 0, nodes = 0;
+	for (int i = 0; i < threads; i++) {
+		pthread_join(ids[i], NULL);
+		probes += t[i].probes;
+		hits += t[i].hits;
+		nodes += t[i].nodes;
+	}
+
+	printf("%d plies: %lu nodes expanded, %lu cache probes, %.1f%% hits, %d thread(s), %.3f s\n", plies, nodes, probes,
+		probes ? 100.0 * hits / probes : 0.0, threads, wall_seconds() - start);
+	free(t);
+	free(ids);
+}
+
+
+
+
+//---------------------------------------
+// Function: evaluate
+//
+// Description: Play games on full boards with the move the table gives for each board's surface (the first legal move
+//              if that one is not legal there), until a block is in row 15 or EVAL_MAX_PIECES tetrominoes
+//
+// Input: const uint8_t *table,
+//        int games,
+//        uint32_t seed,
+//        double *pieces_per_game,
+//        double *rows_per_piece
+// Output: None
+//
+//---------------------------------------
+static void evaluate(const uint8_t *table, int games, uint32_t seed, double *pieces_per_game, double *rows_per_piece)
+{
+	unsigned long pieces = 0, rows = 0;
+
+	for (int g = 0; g < games; g++) {
+		uint32_t state = seed + g;
+		uint32_t board[4] = {0, 0, 0, 0};
+
+		for (int n = 0; n < EVAL_MAX_PIECES; n++) {
+			int p = host_rand_r(&state) % MOVEGEN_PIECES;
+			int clipped, holes;
+			movegen_result r;
+
+			movegen_board_scalar(board, p, &r);
+			if (!r.legal) {
+				break;
+			}
+
+			int m = table[p * POLICY_SURFACES + surface_of(board, &clipped, &holes)];
+			if (!((r.legal >> m) & 1)) {
+				m = __builtin_ctz(r.legal);
+			}
+
+			for (int x = 0; x < 4; x++) {
+				board[x] = r.columns[x][m];
+			}
+			pieces++;
+			rows += r.lines[m];
+			if ((board[0] | board[1] | board[2] | board[3]) >> 15) {
+				break;
+			}
+		}
+	}
+
+	*pieces_per_game = (double)pieces / games;
+	*rows_per_piece = pieces ? (double)rows / pieces : 0.0;
+}
+
+
+
+
+//---------------------------------------
+// Function: write_table
+//
+// Description: Write tetris/PolicyTable.h: the shape of each tetromino (to tell them apart on the device) and the moves,
+//              two per byte, low nibble first
+//
+// Input: const char *path,
+//        const uint8_t *table,
+//        int plies
+// Output: int
+//		  -1 = Write error
+//         0 = Written
+//
+//---------------------------------------
+static int write_table(const char *path, const uint8_t *table, int plies)
+{
+	FILE *out = fopen(path, "w");
+
+	if (!out) {
+		return -1;
+	}
+
+	fprintf(out, "#ifndef _POLICY_TABLE_H_\r\n#define _POLICY_TABLE_H_\r\n\r\n");
+	fprintf(out, "//Placement policy for -DTETRIS_AUTOPLAY, generated by host/policy_solver.c (%d plies). Do not edit\r\n", plies);
+	fprintf(out, "//\r\n//policy_table[type][surface / 2] holds the move (orientation * 4 + center x) for tetromino type\r\n");
+	fprintf(out, "//(init_tetromino) on a surface, in the low nibble for even surfaces. The surface is the height of\r\n");
+	fprintf(out, "//each column above the lowest one, up to POLICY_STEPS - 1: x0 + x1 * POLICY_STEPS + x2 * POLICY_STEPS^2\r\n");
+	fprintf(out, "//+ x3 * POLICY_STEPS^3. policy_shapes holds block 1-3's offsets from the center block in\r\n");
+	fprintf(out, "//orientation 0, which tell the types apart. Include after <avr/pgmspace.h>.\r\n\r\n\r\n");
+
+	fprintf(out, "#define POLICY_STEPS %d\r\n#define POLICY_SURFACES %d\r\n#define POLICY_TYPES %d\r\n\r\n\r\n",
+		POLICY_STEPS, POLICY_SURFACES, MOVEGEN_PIECES);
+
+	fprintf(out, "static const int8_t policy_shapes[POLICY_TYPES][6] PROGMEM = {\r\n");
+	for (int p = 0; p < MOVEGEN_PIECES; p++) {
+		struct tetromino_location t_loc;
+		init_tetromino(p, &t_loc);
+		fprintf(out, "\t{%d, %d, %d, %d, %d, %d},\r\n", t_loc.c_b1_x[0], t_loc.c_b1_y[0], t_loc.c_b2_x[0], t_loc.c_b2_y[0],
+			t_loc.c_b3_x[0], t_loc.c_b3_y[0]);
+	}
+	fprintf(out, "};\r\n\r\n");
+
+	fprintf(out, "static const uint8_t policy_table[POLICY_TYPES][(POLICY_SURFACES + 1) / 2] PROGMEM = {\r\n");
+	for (int p = 0; p < MOVEGEN_PIECES; p++) {
+		fprintf(out, "\t{");
+		for (int s = 0; s < POLICY_SURFACES; s += 2) {
+			uint8_t low = table[p * POLICY_SURFACES + s];
+			uint8_t high = s + 1 < POLICY_SURFACES ? table[p * POLICY_SURFACES + s + 1] : 0;
+			fprintf(out, "%s0x%02X,", s % 32 == 0 ? "\r\n\t\t" : " ", low | high << 4);
+		}
+		fprintf(out, "\r\n\t},\r\n");
+	}
+	fprintf(out, "};\r\n\r\n\r\n#endif // _POLICY_TABLE_H_\r\n");
+
+	return (ferror(out) | fclose(out)) ? -1 : 0;
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	int plies = 4;
+	int threads = 1;
+	int games = 2000;
+	uint32_t seed = 1;
+	const char *out = NULL;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-d") == 0) {
+			plies = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-j") == 0) {
+			threads = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-g") == 0) {
+			games = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			seed = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-o") == 0) {
+			out = argv[i + 1];
+		}
+	}
+	plies = plies < 1 ? 1 : plies > POLICY_MAX_PLIES ? POLICY_MAX_PLIES : plies;
+	threads = threads < 1 ? 1 : threads;
+	games = games < 1 ? 1 : games;
+
+	static uint8_t greedy[MOVEGEN_PIECES * POLICY_SURFACES], table[MOVEGEN_PIECES * POLICY_SURFACES];
+	double pieces, rows;
+
+	policy_init();
+	solve(greedy, 1, threads);
+	solve(table, plies, threads);
+
+	evaluate(greedy, games, seed, &pieces, &rows);
+	printf("greedy:  %.1f tetrominoes per game, %.3f rows per tetromino (%d games, cut off at %d)\n", pieces, rows, games,
+		EVAL_MAX_PIECES);
+	evaluate(table, games, seed, &pieces, &rows);
+	printf("%d plies: %.1f tetrominoes per game, %.3f rows per tetromino\n", plies, pieces, rows);
+
+	if (out) {
+		if (write_table(out, table, plies) != 0) {
+			perror(out);
+			return 2;
+		}
+		printf("wrote %s: %d bytes of PROGMEM\n", out, MOVEGEN_PIECES * ((POLICY_SURFACES + 1) / 2 + 6));
+	}
+	return 0;
+}
@@ -0,0 +1,326 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: stress test the single producer, single consumer rings
+// (tetris/Ring.h)
+//
+// Pushes a sequence of numbers through rings of capacity 2, 16 and 128 and
+// checks the consumer sees every one exactly once and in order:
+//   threads   producer and consumer on two threads (two cores if there are)
+//   isr-push  producer in a signal handler, the way USART_RX_vect and
+//             ADC_vect push while the game loop pops. Another thread keeps
+//             signalling the consumer's thread (from a spare core if there
+//             is one), so pushes can land in the middle of pops
+//   isr-pop   consumer in a signal handler, the way USART_UDRE_vect and
+//             TIMER0_COMPA_vect pop while the game loop pushes
+// Elements are 32 bits wide, wider than the indices, so a torn element or
+// one read before it was written shows up as a wrong number.
+//
+// Build: gcc -O2 -pthread -o ring_stress host/ring_stress.c
+//        (add -fsanitize=thread and run -m threads to have the memory
+//        ordering checked too; ThreadSanitizer delays signal handlers)
+// Usage: ring_stress [-n numbers per test] [-m mode]
+// ---------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "../tetris/Ring.h"
+
+
+RING_DEFINE(ring2, uint32_t, 2)
+RING_DEFINE(ring16, uint32_t, 16)
+RING_DEFINE(ring128, uint32_t, 128)
+
+
+//Ring under test
+typedef struct stress_ring {
+
+	const char *name;
+	uint8_t capacity;
+	uint8_t (*push)(uint32_t value);
+	uint8_t (*pop)(uint32_t *value);
+	uint8_t (*count)();
+
+} stress_ring;
+
+static const stress_ring stress_rings[] = {
+	{"2", 2, ring2_push, ring2_pop, ring2_count},
+	{"16", 16, ring16_push, ring16_pop, ring16_count},
+	{"128", 128, ring128_push, ring128_pop, ring128_count},
+};
+
+
+static const stress_ring *ring;
+static unsigned long numbers = 1000000;
+
+//Written by one side only
+static volatile uint32_t next_push, next_pop;
+static volatile unsigned long errors;
+static volatile unsigned long full, empty; // Push or pop attempts that found the ring full or empty
+
+static pthread_t main_thread;
+static int signalling; // Set and cleared by run, read by signal_thread
+static volatile unsigned long signals;
+
+
+
+
+//---------------------------------------
+// Function: wall_seconds
+//
+// Description: Monotonic wall clock time
+//
+// Input: None
+// Output: double
+//
+//---------------------------------------
+static double wall_seconds()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+
+
+//---------------------------------------
+// Function: push_one
+//
+// Description: Producer step: push next_push if there is room
+//
+// Input: None
+// Output: int
+//		  1 = Pushed
+//		  0 = Ring full
+//
+//---------------------------------------
+static inline int push_one()
+{
+	if (!ring->push(next_push)) {
+		full++;
+		return 0;
+	}
+	next_push++;
+	return 1;
+}
+
+
+
+
+//---------------------------------------
+// Function: pop_one
+//
+// Description: Consumer step: pop a number if there is one and check it is the next in sequence
+//
+// Input: None
+// Output: int
+//		  1 = Popped
+//		  0 = Ring empty
+//
+//---------------------------------------
+static inline int pop_one()
+{
+	uint32_t value;
+
+	if (!ring->pop(&value)) {
+		empty++;
+		return 0;
+	}
+	if (value != next_pop && errors++ < 5) {
+		printf("  expected %u, popped %u\n", next_pop, value);
+	}
+	next_pop = value + 1;
+
+	uint8_t count = ring->count(); // Can only be low on this side, never above capacity
+	if (count > ring->capacity && errors++ < 5) {
+		printf("  count %u\n", count);
+	}
+	return 1;
+}
+
+
+
+
+//---------------------------------------
+// Function: producer_thread
+//
+// Description: Push numbers numbers, spinning while the ring is full
+//
+// Input: void *arg (unused)
+// Output: void *
+//
+//---------------------------------------
+static void *producer_thread(void *arg)
+{
+	(void)arg;
+	while (next_push < numbers) {
+		if (!push_one()) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+
+
+
+//---------------------------------------
+// Function: signal_thread
+//
+// Description: Keep signalling the main thread until signalling is cleared
+//
+// Input: void *arg (unused)
+// Output: void *
+//
+//---------------------------------------
+static void *signal_thread(void *arg)
+{
+	(void)arg;
+	while (__atomic_load_n(&signalling, __ATOMIC_RELAXED)) {
+		pthread_kill(main_thread, SIGUSR1);
+		signals++;
+		sched_yield(); // Let the main thread take it when there is only one core
+	}
+	return NULL;
+}
+
+
+
+
+//---------------------------------------
+// Function: isr_push
+//
+// Description: SIGUSR1 handler for isr-push: push a few numbers, like an ISR called on every received byte
+//
+// Input: int sig
+// Output: None
+//
+//---------------------------------------
+static void isr_push(int sig)
+{
+	(void)sig;
+	for (int i = 0; i < 4 && next_push < numbers; i++) {
+		push_one();
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: isr_pop
+//
+// Description: SIGUSR1 handler for isr-pop: pop a few numbers, like a transmit ISR
+//
+// Input: int sig
+// Output: None
+//
+//---------------------------------------
+static void isr_pop(int sig)
+{
+	(void)sig;
+	for (int i = 0; i < 4; i++) {
+		pop_one();
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: run
+//
+// Description: Run one mode on the current ring and print the result
+//
+// Input: const char *mode
+// Output: None
+//
+//---------------------------------------
+static void run(const char *mode)
+{
+	uint32_t value;
+	pthread_t tid;
+	unsigned long errors_before = errors;
+
+	while (ring->pop(&value)); // Start empty. Indices keep running from the last test, which also covers wrap around
+	next_push = next_pop = 0;
+	full = empty = signals = 0;
+
+	double start = wall_seconds();
+	if (strcmp(mode, "threads") == 0) {
+		pthread_create(&tid, NULL, producer_thread, NULL);
+		while (next_pop < numbers) {
+			if (!pop_one()) {
+				sched_yield();
+			}
+		}
+		pthread_join(tid, NULL);
+	}
+	else {
+		int isr_is_producer = strcmp(mode, "isr-push") == 0;
+
+		signal(SIGUSR1, isr_is_producer ? isr_push : isr_pop);
+		__atomic_store_n(&signalling, 1, __ATOMIC_RELAXED);
+		pthread_create(&tid, NULL, signal_thread, NULL);
+		while (next_pop < numbers) {
+			int progress = isr_is_producer ? pop_one() : (next_push < numbers && push_one());
+			if (!progress) {
+				sched_yield(); // Let the signalling thread run when there is only one core
+			}
+		}
+		__atomic_store_n(&signalling, 0, __ATOMIC_RELAXED);
+		pthread_join(tid, NULL);
+		signal(SIGUSR1, SIG_IGN);
+	}
+	double elapsed = wall_seconds() - start;
+
+	printf("ring %-3s %-8s %10lu numbers, %5.1f M/s, found full %lu, found empty %lu, signals %lu, %s\n", ring->name, mode,
+		numbers, numbers / elapsed / 1e6, full, empty, signals, errors == errors_before ? "ok" : "ERRORS");
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	static const char *modes[] = {"threads", "isr-push", "isr-pop"};
+	const char *only = NULL;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) {
+			numbers = strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-m") == 0) {
+			only = argv[i + 1];
+		}
+	}
+
+	main_thread = pthread_self();
+	signal(SIGUSR1, SIG_IGN);
+
+	for (size_t r = 0; r < sizeof(stress_rings) / sizeof(stress_rings[0]); r++) {
+		ring = &stress_rings[r];
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+			if (!only || strcmp(only, modes[m]) == 0) {
+				run(modes[m]);
+			}
+		}
+	}
+
+	if (errors) {
+		printf("%lu errors\n", errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,602 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: report where the firmware spends its time from the sample
+// dumps of a -DTETRIS_SAMPLE build (tetris/Sampler.h)
+//
+// Reads the dumps captured from USART0 (a serial terminal log, or the -u
+// file of host/simavr/cycle_suite), adds up every complete dump and maps
+// each sampled address to a function with the ELF symbol table (the
+// function holding it, or the nearest symbol below it). With addr2line the
+// addresses are also mapped to source lines, including the inlined
+// functions the symbol table cannot see: the loops of _delay_us and
+// _delay_ms show up under their own names, the ADC busy-waits as lines of
+// joystick_read. Build the firmware with -g for line numbers.
+//
+// Build: gcc -O2 -o sample_report host/sample_report.c
+// Usage: sample_report firmware.elf dumps.txt [-a addr2line] [-n lines]
+//        -a names the addr2line to run (default avr-addr2line, "" for none)
+//        -n sets the number of rows printed per table (default 20)
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <elf.h>
+
+
+#define REPORT_ADDRESSES_PER_RUN 200 // Addresses given to each addr2line run
+
+
+//Struct to hold a code symbol from the ELF file
+typedef struct report_symbol {
+
+	uint64_t address, size;
+	const char *name;
+
+} report_symbol;
+
+
+//Struct to hold the samples of one address, and what it maps to
+typedef struct report_sample {
+
+	uint64_t address;
+	unsigned long count;
+	const char *function; // Function from the symbol table
+	char *inlined; // Innermost function from addr2line (the inlined one, if any), NULL = no line information
+	char *line; // file:line of the innermost function
+
+} report_sample;
+
+
+//Struct to hold the samples of a table row
+typedef struct report_row {
+
+	const char *name;
+	const char *detail;
+	unsigned long count;
+
+} report_row;
+
+
+
+
+//---------------------------------------
+// Function: load_file
+//
+// Description: Read a whole file into memory
+//
+// Input: const char *path,
+//        size_t *size
+// Output: uint8_t *
+//		  NULL = Read error
+//
+//---------------------------------------
+static uint8_t *load_file(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "rb");
+	uint8_t *data = NULL;
+	long length;
+
+	if (!f) {
+		return NULL;
+	}
+	if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0) {
+		data = malloc(length);
+		if (data && fread(data, 1, length, f) != (size_t)length) {
+			free(data);
+			data = NULL;
+		}
+		*size = length;
+	}
+	fclose(f);
+	return data;
+}
+
+
+
+
+//---------------------------------------
+// Function: symbol_compare
+//
+// Description: qsort comparison of report_symbol by address, functions with a size first
+//
+// Input: const void *a,
+//        const void *b
+// Output: int
+//
+//---------------------------------------
+static int symbol_compare(const void *a, const void *b)
+{
+	const report_symbol *x = a, *y = b;
+
+	if (x->address != y->address) {
+		return x->address < y->address ? -1 : 1;
+	}
+	return (y->size != 0) - (x->size != 0);
+}
+
+
+
+
+//---------------------------------------
+// Function: elf_symbols
+//
+// Description: Code symbols of a 32-bit (AVR) or 64-bit little endian ELF file: functions, and labels in executable
+//              sections. The names point into image
+//
+// Input: const uint8_t *image,
+//        size_t size,
+//        size_t *count
+// Output: report_symbol *
+//		  NULL = Not an ELF file this reads, or no symbol table
+//
+//---------------------------------------
+static report_symbol *elf_symbols(const uint8_t *image, size_t size, size_t *count)
+{
+	if (size < EI_NIDENT || memcmp(image, ELFMAG, SELFMAG) != 0 || image[EI_DATA] != ELFDATA2LSB) {
+		return NULL;
+	}
+
+	int wide = image[EI_CLASS] == ELFCLASS64;
+	uint64_t shoff = wide ? ((const Elf64_Ehdr *)image)->e_shoff : ((const Elf32_Ehdr *)image)->e_shoff;
+	unsigned shnum = wide ? ((const Elf64_Ehdr *)image)->e_shnum : ((const Elf32_Ehdr *)image)->e_shnum;
+	size_t shentsize = wide ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+
+	if (shoff == 0 || shoff + (uint64_t)shnum * shentsize > size) {
+		return NULL;
+	}
+
+	// Section fields needed: type, flags, offset, size, link
+#define SECTION(i, field) (wide ? ((const Elf64_Shdr *)(image + shoff))[i].field : ((const Elf32_Shdr *)(image + shoff))[i].field)
+
+	for (unsigned s = 0; s < shnum; s++) {
+		if (SECTION(s, sh_type) != SHT_SYMTAB || SECTION(s, sh_link) >= shnum) {
+			continue;
+		}
+
+		uint64_t offset = SECTION(s, sh_offset);
+		uint64_t bytes = SECTION(s, sh_size);
+		uint64_t strings = SECTION(SECTION(s, sh_link), sh_offset);
+		uint64_t strings_size = SECTION(SECTION(s, sh_link), sh_size);
+		size_t entsize = wide ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+
+		if (offset + bytes > size || strings + strings_size > size) {
+			return NULL;
+		}
+
+		report_symbol *symbols = malloc((bytes / entsize + 1) * sizeof(report_symbol));
+		size_t n = 0;
+
+		for (uint64_t i = 0; i < bytes / entsize; i++) {
+			const uint8_t *entry = image + offset + i * entsize;
+			uint32_t name = wide ? ((const Elf64_Sym *)entry)->st_name : ((const Elf32_Sym *)entry)->st_name;
+			uint8_t info = wide ? ((const Elf64_Sym *)entry)->st_info : ((const Elf32_Sym *)entry)->st_info;
+			uint16_t shndx = wide ? ((const Elf64_Sym *)entry)->st_shndx : ((const Elf32_Sym *)entry)->st_shndx;
+			int type = wide ? ELF64_ST_TYPE(info) : ELF32_ST_TYPE(info);
+
+			if (name >= strings_size || shndx == SHN_UNDEF || shndx >= shnum) {
+				continue;
+			}
+			if (type != STT_FUNC && !(type == STT_NOTYPE && (SECTION(shndx, sh_flags) & SHF_EXECINSTR))) {
+				continue;
+			}
+
+			const char *text = (const char *)image + strings + name;
+			if (text[0] == '\0' || text[0] == '.' || text[0] == '$') {
+				continue; // Local labels and mapping symbols
+			}
+
+			symbols[n].address = wide ? ((const Elf64_Sym *)entry)->st_value : ((const Elf32_Sym *)entry)->st_value;
+			symbols[n].size = wide ? ((const Elf64_Sym *)entry)->st_size : ((const Elf32_Sym *)entry)->st_size;
+			symbols[n].name = text;
+			n++;
+		}
+
+		qsort(symbols, n, sizeof(report_symbol), symbol_compare);
+		*count = n;
+		return symbols;
+	}
+#undef SECTION
+
+	return NULL;
+}
+
+
+
+
+//---------------------------------------
+// Function: symbol_at
+//
+// Description: Name of the function holding address: the last symbol at or below it whose size covers it, else the
+//              nearest symbol below it
+//
+// Input: const report_symbol *symbols,
+//        size_t count,
+//        uint64_t address
+// Output: const char *
+//
+//---------------------------------------
+static const char *symbol_at(const report_symbol *symbols, size_t count, uint64_t address)
+{
+	size_t low = 0, high = count; // First symbol above address
+
+	while (low < high) {
+		size_t mid = (low + high) / 2;
+		if (symbols[mid].address <= address) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	if (low == 0) {
+		return "?";
+	}
+
+	for (size_t i = low; i-- > 0 && address - symbols[i].address < 0x10000;) {
+		if (symbols[i].size && address < symbols[i].address + symbols[i].size) {
+			return symbols[i].name;
+		}
+	}
+	return symbols[low - 1].name;
+}
+
+
+
+
+//---------------------------------------
+// Function: sample_compare
+//
+// Description: qsort comparison of report_sample by address
+//
+// Input: const void *a,
+//        const void *b
+// Output: int
+//
+//---------------------------------------
+static int sample_compare(const void *a, const void *b)
+{
+	const report_sample *x = a, *y = b;
+
+	return x->address < y->address ? -1 : x->address > y->address;
+}
+
+
+
+
+//---------------------------------------
+// Function: read_dumps
+//
+// Description: Add up the complete dumps in a file ("samples <total> lost <lost>", "sample <address> <count>" lines,
+//              "samples end"), one entry per address. Other lines and a dump cut off at the end are skipped
+//
+// Input: const char *path,
+//        size_t *count,
+//        unsigned long *dumps,
+//        unsigned long *total,
+//        unsigned long *lost
+// Output: report_sample *
+//		  NULL = Read error
+//
+//---------------------------------------
+static report_sample *read_dumps(const char *path, size_t *count, unsigned long *dumps, unsigned long *total,
+	unsigned long *lost)
+{
+	FILE *f = fopen(path, "r");
+	char line[256];
+	report_sample *samples = NULL;
+	size_t n = 0, capacity = 0, committed = 0;
+	unsigned long dump_total = 0, dump_lost = 0;
+	int open = 0;
+
+	if (!f) {
+		return NULL;
+	}
+
+	*dumps = *total = *lost = 0;
+	while (fgets(line, sizeof(line), f)) {
+		unsigned long long address;
+		unsigned long a, b;
+
+		if (strncmp(line, "samples end", 11) == 0) {
+			if (open) {
+				committed = n;
+				*total += dump_total;
+				*lost += dump_lost;
+				(*dumps)++;
+			}
+			open = 0;
+		}
+		else if (sscanf(line, "samples %lu lost %lu", &a, &b) == 2) {
+			n = committed; // Drop a dump that was cut off
+			dump_total = a;
+			dump_lost = b;
+			open = 1;
+		}
+		else if (open && sscanf(line, "sample %llu %lu", &address, &a) == 2) {
+			if (n == capacity) {
+				capacity = capacity ? capacity * 2 : 256;
+				samples = realloc(samples, capacity * sizeof(report_sample));
+			}
+			memset(&samples[n], 0, sizeof(report_sample));
+			samples[n].address = address;
+			samples[n].count = a;
+			n++;
+		}
+	}
+	fclose(f);
+
+	// One entry per address
+	n = committed;
+	if (n) {
+		qsort(samples, n, sizeof(report_sample), sample_compare);
+	}
+	size_t merged = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (merged && samples[merged - 1].address == samples[i].address) {
+			samples[merged - 1].count += samples[i].count;
+		}
+		else {
+			samples[merged++] = samples[i];
+		}
+	}
+
+	*count = merged;
+	return samples ? samples : calloc(1, sizeof(report_sample));
+}
+
+
+
+
+//---------------------------------------
+// Function: read_line
+//
+// Description: Read one line from addr2line without its newline
+//
+// Input: FILE *f,
+//        char *line,
+//        size_t size
+// Output: int
+//		  0 = End of output
+//		  1 = Line read
+//
+//---------------------------------------
+static int read_line(FILE *f, char *line, size_t size)
+{
+	if (!fgets(line, size, f)) {
+		return 0;
+	}
+	line[strcspn(line, "\r\n")] = '\0';
+	return 1;
+}
+
+
+
+
+//---------------------------------------
+// Function: symbolize_lines
+//
+// Description: Run addr2line on the sampled addresses and fill in each one's innermost function and source line.
+//              addr2line -a prints each address, then a function and file:line pair for the innermost inlined
+//              function and one for each function it was inlined into
+//
+// Input: const char *addr2line,
+//        const char *elf,
+//        report_sample *samples,
+//        size_t count
+// Output: int
+//		  -1 = addr2line could not be run or printed nothing
+//         0 = Done
+//
+//---------------------------------------
+static int symbolize_lines(const char *addr2line, const char *elf, report_sample *samples, size_t count)
+{
+	size_t found = 0;
+
+	if (strchr(elf, '\'') || strchr(addr2line, '\'')) {
+		return -1;
+	}
+
+	for (size_t first = 0; first < count; first += REPORT_ADDRESSES_PER_RUN) {
+		size_t last = first + REPORT_ADDRESSES_PER_RUN < count ? first + REPORT_ADDRESSES_PER_RUN : count;
+		size_t length = strlen(addr2line) + strlen(elf) + 64 + (last - first) * 20;
+		char *command = malloc(length);
+		int used = snprintf(command, length, "'%s' -a -f -i -e '%s'", addr2line, elf);
+
+		for (size_t i = first; i < last; i++) {
+			used += snprintf(command + used, length - used, " 0x%llx", (unsigned long long)samples[i].address);
+		}
+		snprintf(command + used, length - used, " 2>/dev/null");
+
+		FILE *p = popen(command, "r");
+		free(command);
+		if (!p) {
+			return -1;
+		}
+
+		char line[1024], function[1024];
+		report_sample *current = NULL;
+		size_t next = first;
+
+		while (read_line(p, line, sizeof(line))) {
+			if (strncmp(line, "0x", 2) == 0) {
+				current = next < last ? &samples[next++] : NULL; // Addresses come back in the order given
+				continue;
+			}
+			strcpy(function, line);
+			if (!read_line(p, line, sizeof(line))) {
+				break;
+			}
+			if (current && !current->inlined) { // First pair: innermost function
+				const char *file = strrchr(line, '/');
+				current->inlined = strdup(function);
+				current->line = strdup(file ? file + 1 : line);
+				found++;
+			}
+		}
+		pclose(p);
+	}
+
+	return found ? 0 : -1;
+}
+
+
+
+
+//---------------------------------------
+// Function: row_add
+//
+// Description: Add count to the row with this name and detail, appending it if there is none
+//
+// Input: report_row *rows,
+//        size_t *count,
+//        const char *name,
+//        const char *detail,
+//        unsigned long samples
+// Output: None
+//
+//---------------------------------------
+static void row_add(report_row *rows, size_t *count, const char *name, const char *detail, unsigned long samples)
+{
+	for (size_t i = 0; i < *count; i++) {
+		if (strcmp(rows[i].name, name) == 0 && strcmp(rows[i].detail, detail) == 0) {
+			rows[i].count += samples;
+			return;
+		}
+	}
+	rows[*count].name = name;
+	rows[*count].detail = detail;
+	rows[*count].count = samples;
+	(*count)++;
+}
+
+
+
+
+//---------------------------------------
+// Function: row_compare
+//
+// Description: qsort comparison of report_row, most samples first
+//
+// Input: const void *a,
+//        const void *b
+// Output: int
+//
+//---------------------------------------
+static int row_compare(const void *a, const void *b)
+{
+	const report_row *x = a, *y = b;
+
+	return x->count < y->count ? 1 : x->count > y->count ? -1 : strcmp(x->name, y->name);
+}
+
+
+
+
+//---------------------------------------
+// Function: print_rows
+//
+// Description: Print the top rows of a table with their share of all samples
+//
+// Input: const char *title,
+//        report_row *rows,
+//        size_t count,
+//        unsigned long total,
+//        size_t top
+// Output: None
+//
+//---------------------------------------
+static void print_rows(const char *title, report_row *rows, size_t count, unsigned long total, size_t top)
+{
+	qsort(rows, count, sizeof(report_row), row_compare);
+
+	printf("\n%s\n", title);
+	for (size_t i = 0; i < count && i < top; i++) {
+		printf("%10lu %6.2f%%  %s%s%s\n", rows[i].count, total ? 100.0 * rows[i].count / total : 0.0, rows[i].name,
+			rows[i].detail[0] ? "  " : "", rows[i].detail);
+	}
+	if (count > top) {
+		printf("%*s(%zu more)\n", 20, "", count - top);
+	}
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	const char *addr2line = "avr-addr2line";
+	size_t top = 20;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s firmware.elf dumps.txt [-a addr2line] [-n lines]\n", argv[0]);
+		return 2;
+	}
+	for (int i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+			addr2line = argv[++i];
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			top = strtoul(argv[++i], NULL, 0);
+		}
+	}
+
+	size_t image_size = 0, symbol_count = 0, count = 0;
+	uint8_t *image = load_file(argv[1], &image_size);
+	report_symbol *symbols = image ? elf_symbols(image, image_size, &symbol_count) : NULL;
+
+	if (!symbols) {
+		fprintf(stderr, "%s: cannot read the ELF symbol table\n", argv[1]);
+		return 2;
+	}
+
+	unsigned long dumps, total, lost, counted = 0;
+	report_sample *samples = read_dumps(argv[2], &count, &dumps, &total, &lost);
+
+	if (!samples) {
+		perror(argv[2]);
+		return 2;
+	}
+	for (size_t i = 0; i < count; i++) {
+		samples[i].function = symbol_at(symbols, symbol_count, samples[i].address);
+		counted += samples[i].count;
+	}
+
+	printf("%lu samples in %lu dumps, %lu addresses, %lu lost (%.2f%%)\n", total, dumps, (unsigned long)count, lost,
+		total ? 100.0 * lost / total : 0.0);
+	if (!counted) {
+		return 1;
+	}
+
+	report_row *rows = malloc(count * sizeof(report_row));
+	size_t n = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		row_add(rows, &n, samples[i].function, "", samples[i].count);
+	}
+	print_rows("by function (symbol table):", rows, n, counted, top);
+
+	if (!addr2line[0] || symbolize_lines(addr2line, argv[1], samples, count) != 0) {
+		printf("\nno line information (%s)\n", addr2line[0] ? "addr2line failed, or built without -g" : "-a \"\"");
+		return 0;
+	}
+
+	// Innermost function: where inlined code such as _delay_ms and _delay_us is counted
+	n = 0;
+	for (size_t i = 0; i < count; i++) {
+		const char *inlined = samples[i].inlined ? samples[i].inlined : "??";
+		row_add(rows, &n, inlined, strcmp(inlined, samples[i].function) ? samples[i].function : "",
+			samples[i].count);
+	}
+	print_rows("by innermost function, inlined code included (function it is inlined into):", rows, n, counted, top);
+
+	n = 0;
+	for (size_t i = 0; i < count; i++) {
+		row_add(rows, &n, samples[i].line ? samples[i].line : "??", samples[i].function, samples[i].count);
+	}
+	print_rows("by source line (function):", rows, n, counted, top);
+
+	return 0;
+}
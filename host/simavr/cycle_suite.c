@@ -0,0 +1,426 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Cycle-count regression suite
+//
+// Runs the firmware built with -DTETRIS_PROFILE in simavr, feeds the
+// joystick ADC channels from a seeded script and times each phase from the
+// GPIOR0 markers in Profile.h, and reads the stack headroom the firmware
+// reports in GPIOR2:GPIOR1 (Stack.h). Results are compared against a baseline
+// file and the run fails when any cycle count grows, or the headroom shrinks,
+// past the allowed tolerance. -u writes what the firmware sends on USART0 to
+// a file, e.g. the sample dumps of a -DTETRIS_SAMPLE build for
+// host/sample_report.c.
+//
+// Usage: cycle_suite firmware.elf baselines.txt [-n ticks] [-s seed] [-t tolerance%] [-u usart.txt] [--update]
+// ---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_adc.h>
+#include <simavr/avr_uart.h>
+
+#include "../../tetris/Profile.h"
+#include "../../tetris/Stack.h"
+
+
+#define F_CPU 16000000UL
+#define GPIOR0_ADDRESS 0x3E // Data space address of GPIOR0
+#define AVCC_MV 5000
+#define TICK_TIMEOUT_CYCLES (10 * F_CPU) // No tick for 10 s of CPU time: the firmware hung (e.g. in stack_overflow)
+
+
+//Struct to hold cycle statistics for one profiling phase
+typedef struct phase_stats {
+	const char *name;
+	uint64_t begin;
+	unsigned long count;
+	uint64_t total, min, max;
+} phase_stats;
+
+
+static phase_stats phases[] = {
+	{0},
+	{"boot"},
+	{"tick"},
+	{"render"},
+	{"line_clear"},
+};
+
+#define PHASE_COUNT (sizeof(phases) / sizeof(phases[0]))
+
+
+static avr_t *avr;
+static avr_irq_t *adc_x, *adc_y;
+static uint32_t script_state;
+static long long stack_headroom = -1; // Last headroom reported by stack_report, -1 = none
+static unsigned long stack_reports;
+static FILE *usart_out; // -u file, NULL = USART0 output not kept
+
+
+
+
+//---------------------------------------
+// Function: script_joystick
+//
+// Description: Set ADC inputs for the next tick from the seeded input script
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void script_joystick()
+{
+	static const uint32_t positions_mv[] = {0, AVCC_MV / 2, AVCC_MV / 2, AVCC_MV / 2, AVCC_MV};
+
+	script_state = script_state * 1103515245u + 12345u;
+	avr_raise_irq(adc_x, positions_mv[(script_state >> 16) % 5]);
+	script_state = script_state * 1103515245u + 12345u;
+	avr_raise_irq(adc_y, positions_mv[(script_state >> 16) % 5]);
+}
+
+
+
+
+//---------------------------------------
+// Function: marker_write
+//
+// Description: GPIOR0 write callback. Start or stop the timer of the phase written by PROFILE_BEGIN/PROFILE_END
+//
+// Input: struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param
+// Output: None
+//
+//---------------------------------------
+static void marker_write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+	uint8_t id = v & ~PROFILE_EXIT;
+
+	avr->data[addr] = v;
+
+	if (id == 0 || id >= PHASE_COUNT) {
+		return;
+	}
+
+	phase_stats *p = &phases[id];
+
+	if (!(v & PROFILE_EXIT)) {
+		p->begin = avr->cycle;
+		if (id == PROFILE_TICK) {
+			script_joystick();
+		}
+		return;
+	}
+
+	// Boot starts at reset, not at the first instruction of main
+	uint64_t cycles = avr->cycle - (id == PROFILE_BOOT ? 0 : p->begin);
+
+	if (p->count == 0 || cycles < p->min) {
+		p->min = cycles;
+	}
+	if (cycles > p->max) {
+		p->max = cycles;
+	}
+	p->total += cycles;
+	p->count++;
+}
+
+
+
+
+//---------------------------------------
+// Function: stack_write
+//
+// Description: GPIOR2 write callback. stack_report writes GPIOR1 then GPIOR2, so the headroom is complete
+//
+// Input: struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param
+// Output: None
+//
+//---------------------------------------
+static void stack_write(struct avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+	avr->data[addr] = v;
+	stack_headroom = avr->data[STACK_GPIOR1_ADDRESS] | (v << 8);
+	stack_reports++;
+}
+
+
+
+
+//---------------------------------------
+// Function: usart_output
+//
+// Description: USART0 output IRQ callback. Write the byte sent to the -u file
+//
+// Input: struct avr_irq_t *irq, uint32_t value, void *param
+// Output: None
+//
+//---------------------------------------
+static void usart_output(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	fputc((int)(value & 0xFF), usart_out);
+}
+
+
+
+
+//---------------------------------------
+// Function: metric_value
+//
+// Description: Look up a baseline metric (<phase>_max, <phase>_avg, boot or stack_headroom) in the measured results
+//
+// Input: const char *metric
+// Output: long long
+//		  -1 = Unknown metric
+//		  Otherwise measured cycle count (bytes for stack_headroom)
+//
+//---------------------------------------
+static long long metric_value(const char *metric)
+{
+	if (strcmp(metric, "stack_headroom") == 0) {
+		return stack_headroom;
+	}
+	for (unsigned i = 1; i < PHASE_COUNT; i++) {
+		size_t len = strlen(phases[i].name);
+
+		if (strncmp(metric, phases[i].name, len) != 0) {
+			continue;
+		}
+		if (metric[len] == '\0') {
+			return phases[i].max;
+		}
+		if (strcmp(metric + len, "_max") == 0) {
+			return phases[i].max;
+		}
+		if (strcmp(metric + len, "_avg") == 0) {
+			return phases[i].count ? (long long)(phases[i].total / phases[i].count) : 0;
+		}
+	}
+	return -1;
+}
+
+
+
+
+//---------------------------------------
+// Function: write_baselines
+//
+// Description: Save measured results as the new baseline file
+//
+// Input: const char *path
+// Output: int
+//		  -1 = File could not be written
+//         0 = Baselines written
+//
+//---------------------------------------
+static int write_baselines(const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		perror(path);
+		return -1;
+	}
+
+	fprintf(f, "# Cycle baselines for host/simavr/run_cycle_suite.sh (ATmega328P @ 16 MHz)\n");
+	fprintf(f, "# Regenerate with: host/simavr/run_cycle_suite.sh --update\n");
+	fprintf(f, "boot %llu\n", (unsigned long long)phases[PROFILE_BOOT].max);
+	for (unsigned i = PROFILE_TICK; i < PHASE_COUNT; i++) {
+		char metric[64];
+
+		snprintf(metric, sizeof(metric), "%s_avg", phases[i].name);
+		fprintf(f, "%s %lld\n", metric, metric_value(metric));
+		snprintf(metric, sizeof(metric), "%s_max", phases[i].name);
+		fprintf(f, "%s %lld\n", metric, metric_value(metric));
+	}
+	if (stack_headroom >= 0) {
+		fprintf(f, "stack_headroom %lld\n", stack_headroom);
+	}
+
+	fclose(f);
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: check_baselines
+//
+// Description: Compare measured results against baseline file
+//
+// Input: const char *path,
+//        double tolerance (fraction)
+// Output: int
+//		  Number of metrics that regressed, -1 if baseline file is missing
+//
+//---------------------------------------
+static int check_baselines(const char *path, double tolerance)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "%s: no baselines, run with --update to record them\n", path);
+		return -1;
+	}
+
+	char line[128];
+	int regressions = 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		char metric[64];
+		long long baseline;
+
+		if (line[0] == '#' || sscanf(line, "%63s %lld", metric, &baseline) != 2) {
+			continue;
+		}
+
+		long long measured = metric_value(metric);
+		if (measured < 0) {
+			fprintf(stderr, "%s: unknown metric %s\n", path, metric);
+			continue;
+		}
+
+		int regressed = strcmp(metric, "stack_headroom") == 0 ? measured < baseline * (1.0 - tolerance) :
+			measured > baseline * (1.0 + tolerance);
+		regressions += regressed;
+
+		printf("%-16s %12lld %12lld %+7.2f%% %s\n", metric, baseline, measured,
+			baseline ? 100.0 * (measured - baseline) / baseline : 0.0, regressed ? "REGRESSED" : "ok");
+	}
+
+	fclose(f);
+	return regressions;
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s firmware.elf baselines.txt [-n ticks] [-s seed] [-t tolerance%%] [-u usart.txt] [--update]\n",
+			argv[0]);
+		return 2;
+	}
+
+	const char *firmware_path = argv[1];
+	const char *baseline_path = argv[2];
+	unsigned long max_ticks = 300;
+	double tolerance = 0.01;
+	int update = 0;
+	const char *usart_path = NULL;
+	script_state = 1;
+
+	for (int i = 3; i < argc; i++) {
+		if (strcmp(argv[i], "--update") == 0) {
+			update = 1;
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			max_ticks = strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			script_state = strtoul(argv[++i], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+			tolerance = strtod(argv[++i], NULL) / 100.0;
+		}
+		else if (strcmp(argv[i], "-u") == 0 && i + 1 < argc) {
+			usart_path = argv[++i];
+		}
+	}
+
+	elf_firmware_t firmware;
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(firmware_path, &firmware) != 0) {
+		fprintf(stderr, "%s: cannot load firmware\n", firmware_path);
+		return 2;
+	}
+
+	avr = avr_make_mcu_by_name(firmware.mmcu[0] ? firmware.mmcu : "atmega328p");
+	if (!avr) {
+		fprintf(stderr, "simavr: unknown MCU\n");
+		return 2;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &firmware);
+	avr->frequency = F_CPU;
+	avr->avcc = AVCC_MV;
+	avr->aref = AVCC_MV;
+
+	adc_x = avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC1);
+	adc_y = avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, ADC_IRQ_ADC0);
+	avr_raise_irq(adc_x, AVCC_MV / 2);
+	avr_raise_irq(adc_y, AVCC_MV / 2);
+
+	avr_register_io_write(avr, GPIOR0_ADDRESS, marker_write, NULL);
+	avr_register_io_write(avr, STACK_GPIOR2_ADDRESS, stack_write, NULL);
+
+	if (usart_path) {
+		usart_out = fopen(usart_path, "w");
+		if (!usart_out) {
+			perror(usart_path);
+			return 2;
+		}
+		uint32_t flags = 0;
+		avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+		flags &= ~AVR_UART_FLAG_STDIO; // Bytes go to the file only, not to simavr's log
+		avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+		avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), usart_output, NULL);
+	}
+
+	unsigned long last_ticks = 0;
+	uint64_t last_tick_cycle = 0;
+
+	while (phases[PROFILE_TICK].count < max_ticks) {
+		int state = avr_run(avr);
+		if (state == cpu_Done || state == cpu_Crashed) {
+			fprintf(stderr, "simavr: firmware stopped after %llu cycles\n", (unsigned long long)avr->cycle);
+			return 2;
+		}
+		if (phases[PROFILE_TICK].count != last_ticks) {
+			last_ticks = phases[PROFILE_TICK].count;
+			last_tick_cycle = avr->cycle;
+		}
+		else if (avr->cycle - last_tick_cycle > TICK_TIMEOUT_CYCLES) {
+			fprintf(stderr, "simavr: no tick for %llu cycles after tick %lu (cycle %llu), firmware hung\n",
+				(unsigned long long)(avr->cycle - last_tick_cycle), last_ticks, (unsigned long long)avr->cycle);
+			return 2;
+		}
+	}
+
+	for (unsigned i = 1; i < PHASE_COUNT; i++) {
+		phase_stats *p = &phases[i];
+		printf("%-12s n=%-6lu min %10llu  avg %10llu  max %10llu cycles\n", p->name, p->count,
+			(unsigned long long)p->min, (unsigned long long)(p->count ? p->total / p->count : 0), (unsigned long long)p->max);
+	}
+	printf("worst-case tick: %.1f us\n", phases[PROFILE_TICK].max * 1e6 / F_CPU);
+	if (usart_out) {
+		fclose(usart_out);
+		printf("USART0 output written to %s\n", usart_path);
+	}
+	if (stack_reports) {
+		printf("stack headroom: %lld bytes above the guard zone (%lu reports)\n\n", stack_headroom, stack_reports);
+	}
+	else {
+		printf("stack headroom: not reported (build with -DTETRIS_STACK_CHECK)\n\n");
+	}
+
+	if (update) {
+		return write_baselines(baseline_path) == 0 ? 0 : 2;
+	}
+
+	int regressions = check_baselines(baseline_path, tolerance);
+	if (regressions < 0) {
+		return 2;
+	}
+	if (regressions > 0) {
+		fprintf(stderr, "%d metric(s) regressed past %.1f%% tolerance\n", regressions, tolerance * 100.0);
+		return 1;
+	}
+
+	return 0;
+}
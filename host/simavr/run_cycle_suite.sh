@@ -0,0 +1,31 @@
+#!/bin/sh
+#-----------------------------------------------------------------------------
+# tetris-on-lcd1602-via-atmega328p
+#
+# Cycle-count regression suite: build main.c with avr-gcc and the profiling
+# markers and stack check enabled, run it in simavr with scripted joystick
+# input and compare boot, tick, render and line clear cycle counts and the
+# stack headroom against cycle_baselines.txt. The firmware must build
+# without warnings.
+#
+# Requires avr-gcc, avr-libc and simavr (libsimavr + headers, libelf).
+#
+# Usage: host/simavr/run_cycle_suite.sh [--update] [-n ticks] [-s seed] [-t tolerance%]
+#        --update records the current results as the new baselines
+#-----------------------------------------------------------------------------
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/../.." && pwd)
+BUILD=${BUILD:-"$ROOT/host/simavr/build"}
+BASELINES="$ROOT/host/simavr/cycle_baselines.txt"
+
+mkdir -p "$BUILD"
+
+avr-gcc -mmcu=atmega328p -Os -std=gnu99 -Wall -Werror -DTETRIS_PROFILE -DTETRIS_STACK_CHECK \
+	-o "$BUILD/tetris_profile.elf" "$ROOT/tetris/main.c"
+
+${CC:-cc} -O2 -o "$BUILD/cycle_suite" "$ROOT/host/simavr/cycle_suite.c" \
+	$(pkg-config --cflags --libs simavr 2>/dev/null || echo "-lsimavr -lelf")
+
+exec "$BUILD/cycle_suite" "$BUILD/tetris_profile.elf" "$BASELINES" "$@"
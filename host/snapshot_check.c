@@ -0,0 +1,452 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Snapshot round trip and power cut check
+//
+// Checks Snapshot.h against the host EEPROM in avr_host.h: snapshots of
+// random boards survive take, save, load and restore unchanged, a flipped
+// bit or a write cut short by a power failure falls back to the other
+// slot, erase and the reset causes in MCUSR decide whether snapshot_boot
+// resumes, and a game cut off at any point and resumed from its snapshot
+// ends exactly like the same game played without a cut. Games follow
+// Tetris() in main.c tick by tick (Game.h) with joystick input chosen by
+// tetromino number and tick, so a resumed game gets the same input again.
+//
+// Build: gcc -O2 -o snapshot_check host/snapshot_check.c
+// Usage: snapshot_check [-n games] [-s seed]
+// ---------------------------------------------------------------------------
+
+#define TETRIS_SNAPSHOT
+
+#include <stddef.h>
+
+#include "avr_host.h"
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+#include "../tetris/Snapshot.h"
+
+#include "Game.h"
+
+
+#define CHECK_MAX_PIECES 2000 // Longest game played
+
+
+//Struct to hold one game of Tetris() as main.c plays it
+typedef struct check_game {
+
+	tetris_game game;
+	uint8_t type; // Tetromino in game.t_loc
+	uint16_t score, pieces;
+
+} check_game;
+
+
+static unsigned long failures;
+
+
+
+
+//---------------------------------------
+// Function: check
+//
+// Description: Count and print a failed check
+//
+// Input: int ok,
+//        const char *what,
+//        unsigned long n
+// Output: None
+//
+//---------------------------------------
+static void check(int ok, const char *what, unsigned long n)
+{
+	if (!ok) {
+		printf("FAIL %s (%lu)\n", what, n);
+		failures++;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: eeprom_reset
+//
+// Description: Erase the host EEPROM and forget the last snapshot, as on a new board
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void eeprom_reset()
+{
+	memset(host_eeprom, 0xFF, sizeof(host_eeprom));
+	memset(&snapshot_saved, 0, sizeof(snapshot_saved));
+	host_eeprom_budget = -1;
+	snapshot_resume = 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: next_random
+//
+// Description: xorshift32 generator for the checks (independent of tetris_rand_state)
+//
+// Input: uint32_t *state
+// Output: uint32_t
+//
+//---------------------------------------
+static inline uint32_t next_random(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+
+
+
+//---------------------------------------
+// Function: game_input_for
+//
+// Description: Joystick input for a tick of a tetromino, the same every time the game is played
+//
+// Input: uint32_t seed,
+//        uint16_t piece,
+//        int tick
+// Output: uint8_t
+//
+//---------------------------------------
+static uint8_t game_input_for(uint32_t seed, uint16_t piece, int tick)
+{
+	static const uint8_t x_inputs[] = {INPUT_LEFT, INPUT_NONE, INPUT_NONE, INPUT_RIGHT};
+	static const uint8_t y_inputs[] = {INPUT_DOWN, INPUT_NONE, INPUT_NONE, INPUT_ROTATE};
+	uint32_t r = seed ^ (piece * 0x9E3779B9u) ^ (tick * 0x85EBCA6Bu);
+
+	next_random(&r);
+	next_random(&r);
+	return x_inputs[r & 3] | y_inputs[(r >> 8) & 3];
+}
+
+
+
+
+//---------------------------------------
+// Function: play
+//
+// Description: Play Tetris() from boot: resume snapshot_saved if snapshot_resume is set, otherwise start a new game
+//              from seed. Stops at game over, or when the power is cut: after cut_piece tetrominoes, or once
+//              host_eeprom_budget runs out during a save
+//
+// Input: check_game *g,
+//        uint32_t seed,
+//        long cut_piece (-1 = never)
+// Output: int
+//		  -1 = Power cut
+//         0 = Game over
+//
+//---------------------------------------
+static int play(check_game *g, uint32_t seed, long cut_piece)
+{
+	memset(g, 0, sizeof(*g));
+	if (snapshot_resume && snapshot_restore(&snapshot_saved, g->game.tetris_state, &g->game.t_loc) == 0) {
+		g->score = snapshot_saved.score;
+		g->pieces = snapshot_saved.pieces;
+		g->type = snapshot_saved.piece & 0x07;
+		game_spawn(&g->game, &g->game.t_loc);
+	}
+	else {
+		tetris_rand_state = seed;
+		g->type = TETRIS_RAND() % TETROMINO_TYPES;
+		init_tetromino(g->type, &g->game.t_loc);
+		game_reset(&g->game, &g->game.t_loc);
+	}
+	snapshot_resume = 0;
+
+	while (g->pieces < CHECK_MAX_PIECES) {
+		if (g->pieces == cut_piece) {
+			return -1;
+		}
+		if (g->pieces % SNAPSHOT_EVERY == 0) {
+			snapshot_take(&snapshot_saved, g->game.tetris_state, &g->game.t_loc, g->type, g->score, g->pieces);
+			snapshot_save(&snapshot_saved);
+			if (host_eeprom_budget == 0) {
+				return -1;
+			}
+		}
+
+		int rc, tick = 0;
+		while ((rc = game_step(&g->game, game_input_for(seed, g->pieces, tick++))) == 0);
+
+		g->score += tetris_rows_removed;
+		g->pieces++;
+		g->type = TETRIS_RAND() % TETROMINO_TYPES;
+		init_tetromino(g->type, &g->game.t_loc);
+		if (rc == -2) {
+			snapshot_erase();
+			return 0;
+		}
+		game_spawn(&g->game, &g->game.t_loc);
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: same_game
+//
+// Description: Compare the end of two games
+//
+// Input: const check_game *a,
+//        const check_game *b
+// Output: int
+//
+//---------------------------------------
+static int same_game(const check_game *a, const check_game *b)
+{
+	return a->score == b->score && a->pieces == b->pieces && a->type == b->type &&
+		memcmp(a->game.tetris_state, b->game.tetris_state, 4 * sizeof(a->game.tetris_state[0])) == 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: check_round_trip
+//
+// Description: Take, save, load and restore random boards and tetrominoes
+//
+// Input: uint32_t *r,
+//        unsigned long n
+// Output: None
+//
+//---------------------------------------
+static void check_round_trip(uint32_t *r, unsigned long n)
+{
+	uint8_t board[6][TETRIS_ROWS], restored[6][TETRIS_ROWS];
+	struct tetromino_location t_loc, t_restored;
+	snapshot s, loaded;
+
+	eeprom_reset();
+	for (unsigned long i = 0; i < n; i++) {
+		memset(board, 0, sizeof(board));
+		for (int x = 0; x < 4; x++) {
+			for (int y = 0; y < TETRIS_ROWS; y++) {
+				board[x][y] = next_random(r) & 1 ? 0x03 : 0x00;
+			}
+		}
+		uint8_t type = next_random(r) % TETROMINO_TYPES;
+		init_tetromino(type, &t_loc);
+		tetris_rand_state = next_random(r);
+		uint16_t score = next_random(r), pieces = next_random(r);
+
+		snapshot_take(&s, board, &t_loc, type, score, pieces);
+		snapshot_save(&s);
+		check(snapshot_load(&loaded) == 0 && memcmp(&loaded, &s, sizeof(s)) == 0, "save and load", i);
+
+		uint32_t rng = tetris_rand_state;
+		tetris_rand_state = ~rng;
+		memset(restored, 0xAA, sizeof(restored));
+		check(snapshot_restore(&loaded, restored, &t_restored) == 0, "restore", i);
+		check(memcmp(restored, board, 4 * sizeof(board[0])) == 0, "board", i);
+		check(memcmp(&t_restored, &t_loc, sizeof(t_loc)) == 0, "tetromino", i);
+		check(tetris_rand_state == rng && loaded.score == score && loaded.pieces == pieces, "generator and score", i);
+		check(loaded.sequence == (uint8_t)(i + 1) &&
+			memcmp(host_eeprom + (uintptr_t)snapshot_slot((i + 1) & 1), &loaded, sizeof(loaded)) == 0, "slots alternate", i);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: check_damage
+//
+// Description: Flip bits in the newest slot and cut saves short after every byte: snapshot_load must return the
+//              older snapshot, never a damaged one
+//
+// Input: uint32_t *r
+// Output: None
+//
+//---------------------------------------
+static void check_damage(uint32_t *r)
+{
+	uint8_t board[6][TETRIS_ROWS] = {{0}};
+	struct tetromino_location t_loc;
+	snapshot older, newer, loaded;
+
+	for (unsigned long bit = 0; bit < 8 * sizeof(snapshot); bit++) {
+		eeprom_reset();
+		init_tetromino(2, &t_loc);
+		snapshot_take(&older, board, &t_loc, 2, 10, 40);
+		snapshot_save(&older);
+		board[bit % 4][bit % TETRIS_ROWS] = 0x03;
+		snapshot_take(&newer, board, &t_loc, 2, 11, 44);
+		snapshot_save(&newer);
+
+		host_eeprom[(uintptr_t)snapshot_slot(newer.sequence & 1) + bit / 8] ^= 1 << (bit % 8);
+		check(snapshot_load(&loaded) == 0 && memcmp(&loaded, &older, sizeof(older)) == 0, "bit flip", bit);
+		host_eeprom[(uintptr_t)snapshot_slot(older.sequence & 1) + bit / 8] ^= 1 << (bit % 8);
+		check(snapshot_load(&loaded) == -1, "bit flip in both slots", bit);
+	}
+
+	for (long budget = 0; budget <= (long)sizeof(snapshot); budget++) {
+		eeprom_reset();
+		for (int i = 0; i < 3; i++) {
+			memset(board, 0, sizeof(board));
+			board[next_random(r) % 4][next_random(r) % TETRIS_ROWS] = 0x03;
+			init_tetromino(i, &t_loc);
+			tetris_rand_state = next_random(r);
+			snapshot_take(&older, board, &t_loc, i, i, 4 * i);
+			snapshot_save(&older);
+		}
+
+		memset(board, 0x03, 4 * sizeof(board[0]));
+		tetris_rand_state = next_random(r);
+		snapshot_take(&newer, board, &t_loc, 5, 0xFFFF, 0xFFFF);
+		host_eeprom_budget = budget;
+		snapshot_save(&newer);
+
+		uint8_t *slot = host_eeprom + (uintptr_t)snapshot_slot(newer.sequence & 1);
+		int complete = memcmp(slot, &newer, sizeof(newer)) == 0;
+		check(snapshot_load(&loaded) == 0, "power cut while saving", budget);
+		check(memcmp(&loaded, complete ? &newer : &older, sizeof(loaded)) == 0, "power cut keeps newest complete", budget);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: check_boot
+//
+// Description: snapshot_boot resumes after power on, brown-out and watchdog resets but not after the reset button,
+//              and nothing is resumed after snapshot_erase
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void check_boot()
+{
+	static const struct { uint8_t mcusr; uint8_t resume; } causes[] = {
+		{1 << PORF, 1}, {1 << BORF, 1}, {1 << WDRF, 1}, {(1 << PORF) | (1 << EXTRF), 1},
+		{(1 << BORF) | (1 << EXTRF), 1}, {1 << EXTRF, 0}, {0, 1}};
+	uint8_t board[6][TETRIS_ROWS] = {{0}};
+	struct tetromino_location t_loc;
+
+	for (unsigned long i = 0; i < sizeof(causes) / sizeof(causes[0]); i++) {
+		eeprom_reset();
+		init_tetromino(3, &t_loc);
+		snapshot_take(&snapshot_saved, board, &t_loc, 3, 0, 0);
+		snapshot_save(&snapshot_saved);
+
+		MCUSR = causes[i].mcusr;
+		snapshot_boot();
+		check(snapshot_resume == causes[i].resume && MCUSR == 0, "reset cause", i);
+
+		snapshot_resume = 0;
+		MCUSR = 1 << PORF;
+		snapshot_boot();
+		check(snapshot_resume == causes[i].resume, "resume again after power on", i);
+	}
+
+	snapshot_erase();
+	MCUSR = 1 << PORF;
+	snapshot_boot();
+	check(snapshot_resume == 0, "erase", 0);
+}
+
+
+
+
+//---------------------------------------
+// Function: check_resume
+//
+// Description: Play a game to the end, then play it again cut off by power failures at each tetromino and during
+//              saves, resuming at every power on, and compare the ends
+//
+// Input: uint32_t seed,
+//        unsigned long *resumes
+// Output: None
+//
+//---------------------------------------
+static void check_resume(uint32_t seed, unsigned long *resumes)
+{
+	static check_game reference, g;
+
+	eeprom_reset();
+	play(&reference, seed, -1);
+	check(host_eeprom[(uintptr_t)snapshot_slot(0) + offsetof(snapshot, piece)] == SNAPSHOT_ERASED &&
+		host_eeprom[(uintptr_t)snapshot_slot(1) + offsetof(snapshot, piece)] == SNAPSHOT_ERASED, "erased at game over", seed);
+
+	for (long cut = 1; cut <= reference.pieces; cut++) {
+		eeprom_reset();
+		long budget = cut % 3 == 0 ? (long)(cut % 7) : -1; // Some cuts land in the middle of a save
+		host_eeprom_budget = budget;
+		int rc = play(&g, seed, cut);
+
+		for (int boots = 0; rc != 0 && boots < CHECK_MAX_PIECES; boots++) {
+			host_eeprom_budget = -1;
+			MCUSR = 1 << BORF;
+			snapshot_boot();
+			(*resumes) += snapshot_resume;
+			rc = play(&g, seed, -1);
+		}
+		check(same_game(&g, &reference), "resumed game ends the same", seed * 10000UL + cut);
+	}
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	unsigned long games = 50;
+	uint32_t seed = 1;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) {
+			games = strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			seed = strtoul(argv[i + 1], NULL, 0);
+		}
+	}
+
+	uint32_t r = seed | 1;
+	unsigned long resumes = 0;
+
+	check_round_trip(&r, 10000);
+	check_damage(&r);
+	check_boot();
+
+	unsigned long start = host_eeprom_writes, pieces = 0;
+	for (unsigned long i = 0; i < games; i++) {
+		static check_game g;
+
+		eeprom_reset();
+		play(&g, seed + i, -1);
+		pieces += g.pieces;
+	}
+	unsigned long written = host_eeprom_writes - start; // Saves and erases of these games
+
+	for (unsigned long i = 0; i < games; i++) {
+		check_resume(seed + i, &resumes);
+	}
+
+	printf("snapshot: %zu bytes, %lu games (%lu tetrominoes), %lu resumes, %.2f EEPROM bytes programmed per tetromino\n",
+		sizeof(snapshot), games, pieces, resumes, pieces ? (double)written / pieces : 0.0);
+	if (failures) {
+		printf("%lu failures\n", failures);
+		return 1;
+	}
+	return 0;
+}
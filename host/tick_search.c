@@ -0,0 +1,628 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Worst-case tick search
+//
+// Looks for the game, a host_rand() seed plus one joystick input per tick,
+// whose most expensive single tetris_tick costs the most: a multi-row clear
+// on the tick a rotation is refused, on top of a full redraw, and the like.
+// The cost of a tick is the number of basic blocks the engine executes in
+// it, counted with GCC's -fsanitize-coverage=trace-pc (the same for every
+// run of the same game, unlike a timer). The boards searched are the ones
+// the inputs build, so every case found can happen on the device.
+//
+// The search keeps a pool of games. Each round mutates one of them (inputs
+// changed, mostly in the ticks leading up to its worst tick, a new seed, or
+// inputs spliced from another game), plays the child and keeps it if its
+// worst tick costs more than its parent's (hill climbing) or if it reaches
+// code edges no game in the pool has reached (coverage).
+//
+// Worst cases are kept in a replay corpus (Replay.h), each game cut off
+// after its worst tick. The corpus seeds the pool of the next search, and
+// the best game found is appended to it when it beats every game already
+// there. With -l the run fails if any tick, in the corpus or found by the
+// search, costs more than the given number of blocks. corpus verify checks
+// the corpus like any other.
+//
+// Build: gcc -O2 -fsanitize-coverage=trace-pc -o tick_search host/tick_search.c
+// Usage: tick_search [-n rounds] [-s seed] [-t ticks per game] [-c corpus.trpc] [-l limit]
+// ---------------------------------------------------------------------------
+
+#include "avr_host.h"
+#include "Rand.h"
+
+static void search_marker(uint8_t marker);
+#define PROFILE_HOOK(marker) search_marker(marker)
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "Game.h"
+#include "Replay.h"
+
+
+#define SEARCH_MAX_TICKS 4000 // Longest game searched
+#define SEARCH_POOL 64 // Games kept by the search
+#define SEARCH_MAP_SIZE (1 << 16) // Edge coverage map
+#define SEARCH_FOCUS 60 // Ticks before the worst tick most mutations land in
+
+#define SEARCH_NO_COVERAGE __attribute__((no_sanitize_coverage, noinline))
+
+
+//Struct to hold one game and what playing it cost
+typedef struct search_case {
+
+	uint32_t seed;
+	uint32_t ticks; // Inputs
+	uint8_t inputs[SEARCH_MAX_TICKS];
+
+	uint32_t played; // Ticks played (game may top out before ticks)
+	uint32_t worst_tick;
+	unsigned long worst_blocks;
+	unsigned long worst_phases[PROFILE_PHASES]; // Blocks per phase in the worst tick
+	uint8_t worst_rows; // Rows removed by the worst tick
+	uint8_t worst_state[4][TETRIS_ROWS]; // Board after the worst tick
+
+} search_case;
+
+
+static search_case pool[SEARCH_POOL];
+static int pool_size;
+static int pool_best;
+
+static volatile unsigned long search_blocks; // Basic blocks executed while search_counting
+static volatile int search_counting;
+static volatile uintptr_t search_previous; // Last block, for edges
+static uint8_t search_map[SEARCH_MAP_SIZE]; // Edges hit by the game being played
+static uint8_t search_seen[SEARCH_MAP_SIZE]; // Edges hit by any game kept
+static unsigned long phase_blocks[PROFILE_PHASES], phase_start[PROFILE_PHASES];
+static uint32_t search_random_state;
+
+
+
+
+//---------------------------------------
+// Function: __sanitizer_cov_trace_pc
+//
+// Description: Called by GCC at the start of every basic block of code built with -fsanitize-coverage=trace-pc.
+//              Count the block and mark the edge from the previous one
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+SEARCH_NO_COVERAGE void __sanitizer_cov_trace_pc(void)
+{
+	if (!search_counting) {
+		return;
+	}
+
+	uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+
+	search_blocks++;
+	search_map[(pc ^ search_previous) & (SEARCH_MAP_SIZE - 1)] = 1;
+	search_previous = pc >> 1;
+}
+
+
+
+
+//---------------------------------------
+// Function: search_marker
+//
+// Description: PROFILE_HOOK. Add the blocks between a phase's begin and end markers to phase_blocks
+//
+// Input: uint8_t marker
+// Output: None
+//
+//---------------------------------------
+SEARCH_NO_COVERAGE static void search_marker(uint8_t marker)
+{
+	uint8_t phase = marker & ~PROFILE_EXIT;
+
+	if (phase >= PROFILE_PHASES) {
+		return;
+	}
+	if (marker & PROFILE_EXIT) {
+		phase_blocks[phase] += search_blocks - phase_start[phase];
+	}
+	else {
+		phase_start[phase] = search_blocks;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: search_random
+//
+// Description: xorshift32 generator for the search (independent of host_rand(), which picks tetrominoes)
+//
+// Input: None
+// Output: uint32_t
+//
+//---------------------------------------
+static inline uint32_t search_random()
+{
+	uint32_t x = search_random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return search_random_state = x;
+}
+
+
+
+
+//---------------------------------------
+// Function: random_input
+//
+// Description: Pick a random joystick input, biased towards rest
+//
+// Input: None
+// Output: uint8_t
+//
+//---------------------------------------
+static uint8_t random_input()
+{
+	static const uint8_t x_inputs[] = {INPUT_LEFT, INPUT_NONE, INPUT_NONE, INPUT_RIGHT};
+	static const uint8_t y_inputs[] = {INPUT_DOWN, INPUT_NONE, INPUT_ROTATE, INPUT_ROTATE};
+	uint32_t r = search_random();
+
+	return x_inputs[r & 3] | y_inputs[(r >> 2) & 3];
+}
+
+
+
+
+//---------------------------------------
+// Function: measure_tick
+//
+// Description: Run one tick with counting on
+//
+// Input: tetris_game *game,
+//        uint8_t input,
+//        int *rc
+// Output: unsigned long
+//		  Basic blocks executed
+//
+//---------------------------------------
+SEARCH_NO_COVERAGE static unsigned long measure_tick(tetris_game *game, uint8_t input, int *rc)
+{
+	memset(phase_blocks, 0, sizeof(phase_blocks));
+	search_blocks = 0;
+	search_previous = 0;
+	__asm__ __volatile__("" ::: "memory");
+	search_counting = 1;
+	*rc = game_step(game, input);
+	search_counting = 0;
+	__asm__ __volatile__("" ::: "memory");
+	return search_blocks;
+}
+
+
+
+
+//---------------------------------------
+// Function: search_play
+//
+// Description: Play a case from its seed and fill in its results. The edges hit are left in search_map
+//
+// Input: search_case *c
+// Output: None
+//
+//---------------------------------------
+static void search_play(search_case *c)
+{
+	static tetris_game game;
+	struct tetromino_location t_loc;
+	uint32_t state = c->seed;
+
+	memset(search_map, 0, sizeof(search_map));
+	c->worst_blocks = 0;
+	c->worst_tick = 0;
+
+	host_rand_state = &state;
+	replay_next_tetromino(&t_loc);
+	game_reset(&game, &t_loc);
+
+	for (c->played = 0; c->played < c->ticks; ) {
+		int rc;
+		unsigned long blocks = measure_tick(&game, c->inputs[c->played], &rc);
+
+		if (blocks > c->worst_blocks) {
+			c->worst_blocks = blocks;
+			c->worst_tick = c->played;
+			c->worst_rows = tetris_rows_removed;
+			memcpy(c->worst_phases, phase_blocks, sizeof(phase_blocks));
+			memcpy(c->worst_state, game.tetris_state, sizeof(c->worst_state));
+		}
+		c->played++;
+
+		if (rc == -2) {
+			break;
+		}
+		if (rc != 0) {
+			replay_next_tetromino(&t_loc);
+			game_spawn(&game, &t_loc);
+		}
+	}
+
+	host_rand_state = &host_rand_default;
+}
+
+
+
+
+//---------------------------------------
+// Function: search_new_edges
+//
+// Description: Count edges in search_map that no kept game has hit
+//
+// Input: None
+// Output: unsigned long
+//
+//---------------------------------------
+static unsigned long search_new_edges()
+{
+	unsigned long edges = 0;
+
+	for (int i = 0; i < SEARCH_MAP_SIZE; i++) {
+		edges += search_map[i] & ~search_seen[i];
+	}
+	return edges;
+}
+
+
+
+
+//---------------------------------------
+// Function: search_keep
+//
+// Description: Add the edges in search_map to search_seen
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void search_keep()
+{
+	for (int i = 0; i < SEARCH_MAP_SIZE; i++) {
+		search_seen[i] |= search_map[i];
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: search_mutate
+//
+// Description: Make child from parent: change a few inputs (mostly just before the parent's worst tick), take a new seed,
+//              or splice in the inputs of another game from some tick on
+//
+// Input: search_case *child,
+//        const search_case *parent
+// Output: None
+//
+//---------------------------------------
+static void search_mutate(search_case *child, const search_case *parent)
+{
+	uint32_t r = search_random();
+
+	child->seed = parent->seed;
+	child->ticks = parent->ticks;
+	memcpy(child->inputs, parent->inputs, parent->ticks);
+
+	if (r % 16 == 0) {
+		child->seed = search_random();
+		return;
+	}
+	if (r % 16 == 1 && pool_size > 1) {
+		const search_case *other = &pool[search_random() % pool_size];
+		uint32_t from = search_random() % (child->ticks + 1);
+		memcpy(child->inputs + from, other->inputs + from, other->ticks > from ? other->ticks - from : 0);
+		return;
+	}
+
+	int changes = 1 + search_random() % 4;
+	for (int i = 0; i < changes; i++) {
+		uint32_t at;
+		if (search_random() % 4 != 0) {
+			uint32_t first = parent->worst_tick > SEARCH_FOCUS ? parent->worst_tick - SEARCH_FOCUS : 0;
+			at = first + search_random() % (parent->worst_tick - first + 1);
+		}
+		else {
+			at = search_random() % child->ticks;
+		}
+		child->inputs[at] = random_input();
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: search_add
+//
+// Description: Put a played case in the pool, replacing a random game other than the best once it is full
+//
+// Input: const search_case *c
+// Output: int
+//		  Index in the pool
+//
+//---------------------------------------
+static int search_add(const search_case *c)
+{
+	int at = pool_size;
+
+	if (pool_size < SEARCH_POOL) {
+		pool_size++;
+	}
+	else {
+		do {
+			at = search_random() % SEARCH_POOL;
+		} while (at == pool_best);
+	}
+
+	pool[at] = *c;
+	search_keep();
+	if (c->worst_blocks > pool[pool_best].worst_blocks) {
+		pool_best = at;
+	}
+	return at;
+}
+
+
+
+
+//---------------------------------------
+// Function: search_record
+//
+// Description: Fill a corpus entry and record for a case cut off after its worst tick, the way corpus record does
+//
+// Input: const search_case *c,
+//        replay_entry *entry,
+//        uint8_t *record,
+//        uint16_t *outcomes
+// Output: None
+//
+//---------------------------------------
+static void search_record(const search_case *c, replay_entry *entry, uint8_t *record, uint16_t *outcomes)
+{
+	static tetris_game game;
+	struct tetromino_location t_loc;
+	uint32_t state = c->seed;
+	int piece_ticks = 0;
+
+	memset(entry, 0, sizeof(*entry));
+	entry->seed = c->seed;
+	memset(record, 0, replay_record_bytes(c->worst_tick + 1, 0));
+
+	host_rand_state = &state;
+	int type = replay_next_tetromino(&t_loc);
+	game_reset(&game, &t_loc);
+
+	while (entry->ticks <= c->worst_tick) {
+		uint8_t input = c->inputs[entry->ticks];
+		record[entry->ticks / 2] |= input << (4 * (entry->ticks % 2));
+		entry->ticks++;
+		piece_ticks++;
+
+		int rc = game_step(&game, input);
+		if (rc == 0) {
+			continue;
+		}
+
+		uint8_t height = replay_stack_height(&game);
+		outcomes[entry->pieces++] = REPLAY_OUTCOME(type, piece_ticks, tetris_rows_removed, height);
+		entry->rows += tetris_rows_removed;
+		if (height > entry->max_height) {
+			entry->max_height = height;
+		}
+		piece_ticks = 0;
+
+		if (rc == -2) {
+			entry->flags |= REPLAY_TOPPED_OUT;
+			break;
+		}
+		type = replay_next_tetromino(&t_loc);
+		game_spawn(&game, &t_loc);
+	}
+
+	host_rand_state = &host_rand_default;
+
+	size_t bytes = replay_record_bytes(entry->ticks, entry->pieces);
+	memcpy(record + bytes - 2 * (size_t)entry->pieces, outcomes, 2 * (size_t)entry->pieces);
+}
+
+
+
+
+//---------------------------------------
+// Function: search_report
+//
+// Description: Print a case's worst tick: cost by phase, input, rows removed and the board after it, as the LCD shows it
+//
+// Input: const char *label,
+//        const search_case *c
+// Output: None
+//
+//---------------------------------------
+static void search_report(const char *label, const search_case *c)
+{
+	uint8_t input = c->inputs[c->worst_tick];
+
+	printf("%s: %lu blocks at tick %u of seed 0x%08X (input %s%s%s%s, %u rows removed)\n", label, c->worst_blocks,
+		c->worst_tick, c->seed, input & INPUT_LEFT ? "L" : "", input & INPUT_RIGHT ? "R" : "",
+		input & INPUT_DOWN ? "D" : "", input & INPUT_ROTATE ? "U" : "", c->worst_rows);
+	printf("  input %lu, render %lu, line clear %lu, other %lu\n", c->worst_phases[PROFILE_INPUT],
+		c->worst_phases[PROFILE_RENDER], c->worst_phases[PROFILE_LINE_CLEAR], c->worst_blocks -
+		c->worst_phases[PROFILE_INPUT] - c->worst_phases[PROFILE_RENDER] - c->worst_phases[PROFILE_LINE_CLEAR]);
+
+	for (int x = 0; x < 4; x++) {
+		printf("  |");
+		for (int y = 0; y <= TETRIS_ENTRY_ROW; y++) {
+			putchar(c->worst_state[x][y] ? '#' : '.');
+		}
+		printf("|\n");
+	}
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	unsigned long rounds = 20000;
+	uint32_t seed = 1;
+	uint32_t ticks = 600;
+	const char *corpus_path = NULL;
+	unsigned long limit = 0;
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) {
+			rounds = strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			seed = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-t") == 0) {
+			ticks = (uint32_t)strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-c") == 0) {
+			corpus_path = argv[i + 1];
+		}
+		else if (strcmp(argv[i], "-l") == 0) {
+			limit = strtoul(argv[i + 1], NULL, 0);
+		}
+	}
+	if (ticks < 1 || ticks > SEARCH_MAX_TICKS) {
+		ticks = SEARCH_MAX_TICKS;
+	}
+	search_random_state = seed | 1;
+
+	static search_case child;
+	unsigned long corpus_worst = 0;
+	int failed = 0;
+
+	// Regression corpus: every game must stay within the limit, and seeds the pool
+	if (corpus_path && access(corpus_path, F_OK) == 0) {
+		replay_corpus corpus;
+		static tetris_game game;
+
+		if (replay_open(&corpus, corpus_path) < 0) {
+			return 2;
+		}
+		for (size_t g = 0; g < corpus.count; g++) {
+			const replay_entry *e = corpus.games[g].entry;
+
+			child.seed = e->seed;
+			child.ticks = e->ticks < SEARCH_MAX_TICKS ? e->ticks : SEARCH_MAX_TICKS;
+			for (uint32_t t = 0; t < child.ticks; t++) {
+				child.inputs[t] = replay_input(&corpus.games[g], t);
+			}
+			if (replay_run(&corpus.games[g], &game) != 0) {
+				printf("corpus game %zu: does not replay as recorded, the engine has changed\n", g);
+			}
+			search_play(&child);
+			if (limit && child.worst_blocks > limit) {
+				printf("corpus game %zu: %lu blocks, over the limit of %lu\n", g, child.worst_blocks, limit);
+				failed = 1;
+			}
+			if (child.worst_blocks > corpus_worst) {
+				corpus_worst = child.worst_blocks;
+			}
+
+			// Continue the game past its worst tick with random input, so it can be climbed from
+			for (uint32_t t = child.ticks; t < ticks; t++) {
+				child.inputs[t] = random_input();
+			}
+			child.ticks = child.ticks > ticks ? child.ticks : ticks;
+			search_play(&child);
+			search_add(&child);
+		}
+		printf("corpus: %zu games, worst tick %lu blocks\n", corpus.count, corpus_worst);
+		if (corpus.count) {
+			search_report("corpus worst", &pool[pool_best]);
+		}
+		replay_close(&corpus);
+	}
+
+	// Random games fill the rest of a quarter of the pool
+	while (pool_size < SEARCH_POOL / 4) {
+		child.seed = search_random();
+		child.ticks = ticks;
+		for (uint32_t t = 0; t < ticks; t++) {
+			child.inputs[t] = random_input();
+		}
+		search_play(&child);
+		search_add(&child);
+	}
+	if (pool[pool_best].worst_blocks == 0) {
+		fprintf(stderr, "no blocks counted: build with -fsanitize-coverage=trace-pc\n");
+		return 2;
+	}
+
+	unsigned long start_worst = pool[pool_best].worst_blocks;
+	unsigned long climbs = 0, kept = 0;
+
+	for (unsigned long round = 0; round < rounds; round++) {
+		int parent = search_random() % 2 ? pool_best : (int)(search_random() % pool_size);
+
+		search_mutate(&child, &pool[parent]);
+		search_play(&child);
+
+		if (child.worst_blocks > pool[parent].worst_blocks) {
+			pool[parent] = child; // Climb
+			search_keep();
+			climbs++;
+			if (child.worst_blocks > pool[pool_best].worst_blocks) {
+				pool_best = parent;
+			}
+		}
+		else if (search_new_edges()) {
+			search_add(&child);
+			kept++;
+		}
+	}
+
+	const search_case *best = &pool[pool_best];
+	unsigned long edges = 0;
+	for (int i = 0; i < SEARCH_MAP_SIZE; i++) {
+		edges += search_seen[i];
+	}
+	printf("search: %lu rounds, %lu climbs, %lu kept for coverage, %lu edges, worst tick %lu -> %lu blocks\n",
+		rounds, climbs, kept, edges, start_worst, best->worst_blocks);
+	search_report("worst", best);
+
+	if (limit && best->worst_blocks > limit) {
+		printf("worst tick is over the limit of %lu blocks\n", limit);
+		failed = 1;
+	}
+
+	// A new worst case joins the regression corpus
+	if (corpus_path && best->worst_blocks > corpus_worst) {
+		replay_writer *w = malloc(sizeof(*w));
+		uint8_t *record = malloc(replay_record_bytes(best->worst_tick + 1, best->worst_tick + 1));
+		uint16_t *outcomes = malloc(2 * ((size_t)best->worst_tick + 1));
+		replay_entry entry;
+
+		if (!w || !record || !outcomes || replay_writer_open(w, corpus_path) < 0) {
+			return 2;
+		}
+		search_record(best, &entry, record, outcomes);
+		if (replay_writer_add(w, &entry, record) < 0 || replay_writer_close(w) < 0) {
+			fprintf(stderr, "%s: write failed\n", corpus_path);
+			return 2;
+		}
+		printf("saved to %s (%u ticks)\n", corpus_path, entry.ticks);
+		free(w);
+		free(record);
+		free(outcomes);
+	}
+
+	return failed ? 1 : 0;
+}
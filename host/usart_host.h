@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host replacement for tetris/USART.h
+//
+// Same functions, backed by a file descriptor (one end of a socketpair or
+// a pty) instead of USART0. Include instead of USART.h.
+// ---------------------------------------------------------------------------
+
+#ifndef _USART_H_
+#define _USART_H_
+
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+
+#define USART_BAUD 250000UL // Used for wire time estimates only
+
+
+static int host_usart_fd = -1;
+static unsigned long host_usart_tx_bytes, host_usart_rx_bytes;
+static unsigned long host_usart_error_rate; // Flip a bit in 1 of every host_usart_error_rate bytes sent (0 = never)
+static unsigned long host_usart_errors;
+static unsigned host_usart_error_seed = 1; // Own generator so errors do not change the game's rand() sequence
+static void (*host_usart_hangup)(void); // Called when the other end of host_usart_fd is closed
+
+
+
+
+//---------------------------------------
+// Function: setup_USART
+//
+// Description: Nothing to set up, host_usart_fd is opened by the host program
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void setup_USART()
+{
+}
+
+
+
+
+//---------------------------------------
+// Function: USART_send_byte
+//
+// Description: Write byte to host_usart_fd, with a bit flipped now and then if host_usart_error_rate is set
+//
+// Input: uint8_t
+// Output: None
+//
+//---------------------------------------
+static void USART_send_byte(uint8_t data)
+{
+	if (host_usart_error_rate && rand_r(&host_usart_error_seed) % host_usart_error_rate == 0) {
+		data ^= 1 << (rand_r(&host_usart_error_seed) % 8);
+		host_usart_errors++;
+	}
+	if (write(host_usart_fd, &data, 1) == 1) {
+		host_usart_tx_bytes++;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: USART_receive_byte
+//
+// Description: Read byte from host_usart_fd without waiting. Yields the CPU when nothing is there so the other side can run,
+//              calls host_usart_hangup once the other side has closed it
+//
+// Input: None
+// Output: int
+//		  -1 = No byte received
+//		  Otherwise received byte (0-255)
+//
+//---------------------------------------
+static inline int USART_receive_byte()
+{
+	uint8_t data;
+
+	ssize_t n = recv(host_usart_fd, &data, 1, MSG_DONTWAIT);
+
+	if (n == 0 && host_usart_hangup) {
+		host_usart_hangup();
+	}
+	if (n != 1) {
+		sched_yield();
+		return -1;
+	}
+	host_usart_rx_bytes++;
+	return data;
+}
+
+
+
+
+//---------------------------------------
+// Function: USART_send_string
+//
+// Description: Send null terminated string
+//
+// Input: const char *
+// Output: None
+//
+//---------------------------------------
+static inline void USART_send_string(const char *str)
+{
+	while (*str) {
+		USART_send_byte(*str++);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: USART_send_number
+//
+// Description: Send unsigned number as decimal text
+//
+// Input: uint32_t
+// Output: None
+//
+//---------------------------------------
+static inline void USART_send_number(uint32_t number)
+{
+	char digits[10];
+	uint8_t count = 0;
+
+	do {
+		digits[count++] = '0' + number % 10;
+		number /= 10;
+	} while (number);
+
+	while (count) {
+		USART_send_byte(digits[--count]);
+	}
+}
+
+
+#endif // _USART_H_
@@ -0,0 +1,287 @@
+//-----------------------------------------------------------------------------
+// tetris-on-lcd1602-via-atmega328p
+//
+// Host program: run two copies of Versus() (tetris/Versus.h) in two
+// processes joined by a socketpair in place of the USART0 link, each with
+// random joystick input, and report link round trip time, bytes and frames
+// per tick, lockstep stalls, RESEND recoveries and time spent in the link
+// per tick. Each board stops after its own tick count; the other stops when
+// it sees the link close. A protocol bug shows up as a run that never ends,
+// or as CRC errors without -e (exit status 1).
+//
+// Build: gcc -O2 -o versus_link host/versus_link.c
+// Usage: versus_link [-n ticks] [-s seed] [-p pings] [-e rate]
+//        -e flips a bit in 1 of every rate bytes sent, to test recovery
+// ---------------------------------------------------------------------------
+
+#define _GNU_SOURCE
+
+#include "avr_host.h"
+
+#include <time.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+static void link_profile(uint8_t marker);
+static void link_exit();
+#define PROFILE_HOOK(marker) link_profile(marker)
+
+#include "../tetris/Profile.h"
+#include "../tetris/LCD1602.h"
+#include "../tetris/Tetris.h"
+
+#include "usart_host.h"
+#include "../tetris/Versus.h"
+
+
+static const char *link_name = "board A";
+static long link_max_ticks = 20000;
+static long link_ticks, link_games;
+static pid_t link_board_b;
+static uint64_t link_begin_ns, link_total_ns, link_max_ns;
+
+
+
+
+//---------------------------------------
+// Function: wall_ns
+//
+// Description: Monotonic wall clock time
+//
+// Input: None
+// Output: uint64_t
+//
+//---------------------------------------
+static uint64_t wall_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+
+
+
+//---------------------------------------
+// Function: link_profile
+//
+// Description: PROFILE_HOOK. Time versus_sync_tick in wall clock time and count ticks
+//
+// Input: uint8_t marker
+// Output: None
+//
+//---------------------------------------
+static void link_profile(uint8_t marker)
+{
+	if (marker == PROFILE_LINK) {
+		link_begin_ns = wall_ns();
+	}
+	else if (marker == (PROFILE_LINK | PROFILE_EXIT)) {
+		uint64_t ns = wall_ns() - link_begin_ns;
+		link_total_ns += ns;
+		if (ns > link_max_ns) {
+			link_max_ns = ns;
+		}
+		if (++link_ticks >= link_max_ticks) {
+			link_exit();
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: link_report
+//
+// Description: Print link statistics of this board
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void link_report()
+{
+	double ticks = link_ticks ? link_ticks : 1;
+	double bytes_per_tick = host_usart_tx_bytes / ticks;
+
+	printf("%s: %ld ticks, %ld games\n", link_name, link_ticks, link_games);
+	printf("  sent     %lu bytes, %u frames (%.2f bytes, %.2f frames per tick)\n", host_usart_tx_bytes,
+		versus.frames_sent, bytes_per_tick, versus.frames_sent / ticks);
+	printf("  received %lu bytes, %u frames\n", host_usart_rx_bytes, versus.frames_received);
+	printf("  wire time %.1f us per tick at %lu baud (%.3f%% of a %d ms tick)\n",
+		bytes_per_tick * 10e6 / USART_BAUD, USART_BAUD, bytes_per_tick * 10 * 100.0 / USART_BAUD / (TETRIS_TICK_LENGTH / 1000.0),
+		TETRIS_TICK_LENGTH);
+	printf("  stalls %u, resends %u, crc errors %u, bit errors injected %lu\n", versus.stalls, versus.resends,
+		versus.crc_errors, host_usart_errors);
+	printf("  versus_sync_tick: avg %.1f us, max %.1f us (host, includes waiting for %s)\n",
+		link_total_ns / ticks / 1000.0, link_max_ns / 1000.0, strcmp(link_name, "board A") ? "board A" : "board B");
+	fflush(stdout);
+}
+
+
+
+
+//---------------------------------------
+// Function: link_exit
+//
+// Description: Report, close the link and exit. Board A waits for board B to report too
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static void link_exit()
+{
+	int status = 0;
+
+	link_report();
+	close(host_usart_fd);
+	if (link_board_b > 0) {
+		waitpid(link_board_b, &status, 0);
+	}
+	exit((versus.crc_errors && !host_usart_error_rate) || WEXITSTATUS(status) ? 1 : 0);
+}
+
+
+
+
+//---------------------------------------
+// Function: link_delay_hook
+//
+// Description: host_delay_hook. Each tick delay in Versus() sets a random joystick input for the next tick, and the result delay counts a game
+//
+// Input: uint64_t start_ns,
+//        uint64_t end_ns
+// Output: None
+//
+//---------------------------------------
+static void link_delay_hook(uint64_t start_ns, uint64_t end_ns)
+{
+	static const uint16_t joystick_values[] = {0, 512, 512, 512, 1023}; // Biased towards rest, as in lcd_emulator
+	uint64_t ns = end_ns - start_ns;
+
+	if (ns == 2000 * 1000000ULL) {
+		link_games++; // versus_show_result
+		return;
+	}
+	if (ns != TETRIS_TICK_LENGTH * 1000000ULL) {
+		return;
+	}
+
+	uint16_t x_val = joystick_values[rand() % 5];
+	host_joystick(x_val, joystick_values[rand() % 5]);
+}
+
+
+
+
+//---------------------------------------
+// Function: measure_round_trip
+//
+// Description: PING board B (waiting in versus_start) count times and print round trip time of a PONG
+//
+// Input: int count
+// Output: None
+//
+//---------------------------------------
+static void measure_round_trip(int count)
+{
+	uint64_t total = 0, worst = 0;
+	int answered = 0;
+
+	for (int i = 0; i < count; i++) {
+		uint64_t start = wall_ns();
+
+		versus.pong_received = 0;
+		versus_send_frame(VERSUS_PING, (uint8_t)i, 0);
+		while (!(versus.pong_received && versus.pong_sequence == (uint8_t)i)) {
+			versus_receive();
+			if (wall_ns() - start > 100000000ULL) {
+				break; // PING or PONG lost
+			}
+		}
+		if (!versus.pong_received) {
+			continue;
+		}
+
+		uint64_t ns = wall_ns() - start;
+		total += ns;
+		worst = ns > worst ? ns : worst;
+		answered++;
+	}
+
+	printf("round trip: %d/%d PINGs answered, avg %.1f us, max %.1f us (host); %.1f us on the wire at %lu baud\n",
+		answered, count, answered ? total / 1000.0 / answered : 0.0, worst / 1000.0, 2 * 5 * 10e6 / USART_BAUD,
+		USART_BAUD);
+	fflush(stdout);
+}
+
+
+
+
+int main(int argc, char **argv)
+{
+	unsigned seed = 1;
+	int pings = 1000;
+	int sv[2];
+
+	for (int i = 1; i + 1 < argc; i += 2) {
+		if (strcmp(argv[i], "-n") == 0) {
+			link_max_ticks = strtol(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			seed = (unsigned)strtoul(argv[i + 1], NULL, 0);
+		}
+		else if (strcmp(argv[i], "-p") == 0) {
+			pings = atoi(argv[i + 1]);
+		}
+		else if (strcmp(argv[i], "-e") == 0) {
+			host_usart_error_rate = strtoul(argv[i + 1], NULL, 0);
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN); // Writes after the other board has gone fail, its hangup is seen on the next read
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+		perror("socketpair");
+		return 2;
+	}
+
+	link_board_b = fork();
+	if (link_board_b < 0) {
+		perror("fork");
+		return 2;
+	}
+
+	if (link_board_b == 0) {
+		link_name = "board B";
+		close(sv[0]);
+		host_usart_fd = sv[1];
+		host_usart_error_seed = seed * 2 + 1;
+		srand(seed * 2 + 1);
+	}
+	else {
+		close(sv[1]);
+		host_usart_fd = sv[0];
+		host_usart_error_seed = seed * 2;
+		srand(seed * 2);
+	}
+	host_delay_hook = link_delay_hook;
+	host_usart_hangup = link_exit;
+
+	setup_AVR_ports();
+	setup_ADC();
+	LCD_init();
+	create_tetris_characters();
+	setup_USART();
+
+	if (link_board_b != 0 && pings > 0) {
+		measure_round_trip(pings);
+	}
+
+	while (1) {
+		Versus();
+	}
+}
@@ -0,0 +1,396 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+//On-device benchmarks
+//
+//Build with -DTETRIS_BENCH and hold the joystick in any direction at power on. Instead of starting
+//a game, main runs bench_run once the stick is let go:
+//  LCD     bytes per second through LCD_data (BENCH_LCD_BYTES bytes, queue drained with LCD_ASYNC)
+//  CGRAM   time to upload the custom characters (create_tetris_characters)
+//  ADC     time of one joystick_read, the two conversions joystick_update waits for
+//  TICK    tetris_tick per second and time per tick, over BENCH_TICKS ticks of a fixed replay: tetrominoes
+//          from BENCH_SEED and a scripted joystick (bench_replaying in Tetris.h), drawn on the LCD
+//Times are taken with Timer1 at F_CPU/64 (4 us per count), each step well inside its 262 ms wrap.
+//The results are shown on the LCD, two pages in turn, and sent over USART0 (not with TETRIS_VERSUS,
+//which keeps USART0 for the link), e.g.
+//  bench lcd_bytes_per_s 21276 cgram_us 2496 adc_us 224 ticks_per_s 239 tick_us 4180
+//The game starts after BENCH_SHOW_ROUNDS rounds of the pages, or as soon as the stick is pushed.
+//host/lcd_emulator.c -b runs the same code against the HD44780 model, for comparison.
+//Include after Tetris.h.
+
+
+#define BENCH_LCD_BYTES 64
+#define BENCH_ADC_READS 16
+#define BENCH_TICKS 200
+#define BENCH_TICKS_PER_TETROMINO TETRIS_TICKS_PER_TETROMINO // As load_tetromino
+#define BENCH_SEED 1
+#define BENCH_SHOW_MS 2000 // Per page
+#define BENCH_SHOW_ROUNDS 3
+#define BENCH_US_PER_COUNT 4
+
+
+//Struct to hold benchmark results
+typedef struct bench_results {
+
+	uint32_t lcd_bytes_per_s;
+	uint32_t cgram_us;
+	uint32_t adc_us; // Per joystick_read
+	uint32_t ticks_per_s;
+	uint32_t tick_us; // Per tetris_tick
+
+} bench_results;
+
+
+
+
+//---------------------------------------
+// Function: bench_joystick_held
+//
+// Description: Check if the joystick is pushed in any direction
+//
+// Input: None
+// Output: int
+//		  1 = Pushed
+//		  0 = At rest
+//
+//---------------------------------------
+int bench_joystick_held()
+{
+	int X_Val, Y_Val;
+
+	_delay_us(250); // With TETRIS_INPUT_ISR, lets ADC_vect convert both axes
+	joystick_read(&X_Val, &Y_Val);
+	return X_Val < 250 || X_Val > 750 || Y_Val < 250 || Y_Val > 750;
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_drain
+//
+// Description: Wait till every LCD byte queued has been sent (LCD_ASYNC only)
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static inline void bench_drain()
+{
+#ifdef LCD_ASYNC
+	while (lcd_async_count());
+	_delay_us(52); // Last byte's LCD_ASYNC_PERIOD
+#endif
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_text
+//
+// Description: Write text at the cursor
+//
+// Input: const char *text
+// Output: None
+//
+//---------------------------------------
+static void bench_text(const char *text)
+{
+	while (*text) {
+		LCD_data(*text++);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_number
+//
+// Description: Write an unsigned number as decimal text at the cursor
+//
+// Input: uint32_t number
+// Output: None
+//
+//---------------------------------------
+static void bench_number(uint32_t number)
+{
+	char digits[10];
+	uint8_t count = 0;
+
+	do {
+		digits[count++] = '0' + number % 10;
+		number /= 10;
+	} while (number);
+
+	while (count) {
+		LCD_data(digits[--count]);
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_lcd
+//
+// Description: Time BENCH_LCD_BYTES calls of LCD_data
+//
+// Input: None
+// Output: uint32_t
+//		  Bytes per second
+//
+//---------------------------------------
+uint32_t bench_lcd()
+{
+	LCD_set_cursor(0, 0);
+	bench_drain();
+
+	uint16_t start = TCNT1;
+	for (uint8_t i = 0; i < BENCH_LCD_BYTES; i++) {
+		LCD_data('0' + i % 10);
+	}
+	bench_drain();
+	uint16_t counts = TCNT1 - start;
+
+	return counts ? (uint32_t)BENCH_LCD_BYTES * 1000000UL / ((uint32_t)counts * BENCH_US_PER_COUNT) : 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_cgram
+//
+// Description: Time the custom character upload
+//
+// Input: None
+// Output: uint32_t
+//		  Microseconds
+//
+//---------------------------------------
+uint32_t bench_cgram()
+{
+	bench_drain();
+
+	uint16_t start = TCNT1;
+	create_tetris_characters();
+	bench_drain();
+
+	return (uint32_t)(uint16_t)(TCNT1 - start) * BENCH_US_PER_COUNT;
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_adc
+//
+// Description: Time BENCH_ADC_READS calls of joystick_read
+//
+// Input: None
+// Output: uint32_t
+//		  Microseconds per call
+//
+//---------------------------------------
+uint32_t bench_adc()
+{
+	int X_Val, Y_Val;
+	uint16_t start = TCNT1;
+
+	for (uint8_t i = 0; i < BENCH_ADC_READS; i++) {
+		joystick_read(&X_Val, &Y_Val);
+	}
+	return (uint32_t)(uint16_t)(TCNT1 - start) * BENCH_US_PER_COUNT / BENCH_ADC_READS;
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_ticks
+//
+// Description: Play BENCH_TICKS ticks of the fixed replay on an empty board, without waiting between ticks, and time
+//              each tetris_tick
+//
+// Input: None
+// Output: uint32_t
+//		  Microseconds in tetris_tick
+//
+//---------------------------------------
+uint32_t bench_ticks()
+{
+	uint8_t tetris_state[6][TETRIS_ROWS] = {{0}};
+	struct tetromino_location t_loc;
+	uint8_t ticks_left = 0;
+	uint32_t counts = 0;
+
+#ifdef TETRIS_SNAPSHOT
+	tetris_rand_state = BENCH_SEED;
+#else
+	srand(BENCH_SEED);
+#endif
+	bench_replay_state = BENCH_SEED;
+	bench_replaying = 1;
+
+	for (uint16_t tick = 0; tick < BENCH_TICKS; tick++) {
+		if (ticks_left == 0) {
+			init_random_tetromino(&t_loc);
+			update_tetromino_location_struct(&t_loc);
+			ticks_left = BENCH_TICKS_PER_TETROMINO;
+		}
+
+		uint16_t start = TCNT1;
+		int rc = tetris_tick(TETRIS_ROWS, tetris_state, &t_loc);
+		counts += (uint16_t)(TCNT1 - start);
+
+		if (rc != 0 || --ticks_left == 0) {
+			ticks_left = 0;
+			if ((tetris_state[0][TETRIS_TOP_ROW] != 0x00) | (tetris_state[1][TETRIS_TOP_ROW] != 0x00) |
+				(tetris_state[2][TETRIS_TOP_ROW] != 0x00) | (tetris_state[3][TETRIS_TOP_ROW] != 0x00)) {
+				for (uint8_t x = 0; x < 6; x++) { // Game over, start again
+					for (uint8_t y = 0; y < TETRIS_ROWS; y++) {
+						tetris_state[x][y] = 0x00;
+					}
+				}
+			}
+		}
+	}
+
+	bench_replaying = 0;
+	return counts * BENCH_US_PER_COUNT;
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_show
+//
+// Description: Show one page of results on the LCD
+//
+// Input: const bench_results *r,
+//        uint8_t page (0 or 1)
+// Output: None
+//
+//---------------------------------------
+void bench_show(const bench_results *r, uint8_t page)
+{
+	LCD_clear();
+	LCD_set_cursor(0, 0);
+	if (page == 0) {
+		bench_text("LCD ");
+		bench_number(r->lcd_bytes_per_s);
+		bench_text(" B/s");
+		LCD_set_cursor(0, 1);
+		bench_text("CGRAM ");
+		bench_number(r->cgram_us);
+		bench_text(" us");
+	}
+	else {
+		bench_text("ADC ");
+		bench_number(r->adc_us);
+		bench_text(" us");
+		LCD_set_cursor(0, 1);
+		bench_text("TICKS ");
+		bench_number(r->ticks_per_s);
+		bench_text("/s");
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_report
+//
+// Description: Send the results over USART0 as one line
+//
+// Input: const bench_results *r
+// Output: None
+//
+//---------------------------------------
+void bench_report(const bench_results *r)
+{
+#ifndef TETRIS_VERSUS
+	USART_send_string("bench lcd_bytes_per_s ");
+	USART_send_number(r->lcd_bytes_per_s);
+	USART_send_string(" cgram_us ");
+	USART_send_number(r->cgram_us);
+	USART_send_string(" adc_us ");
+	USART_send_number(r->adc_us);
+	USART_send_string(" ticks_per_s ");
+	USART_send_number(r->ticks_per_s);
+	USART_send_string(" tick_us ");
+	USART_send_number(r->tick_us);
+	USART_send_string("\r\n");
+#else
+	(void)r;
+#endif
+}
+
+
+
+
+//---------------------------------------
+// Function: bench_run
+//
+// Description: Wait for the joystick to be let go, run the benchmarks, report them and show them till the joystick is
+//              pushed or BENCH_SHOW_ROUNDS rounds have gone by. Leaves the LCD cleared for the game
+//
+// Input: bench_results *r (results, may be NULL)
+// Output: None
+//
+//---------------------------------------
+void bench_run(bench_results *r)
+{
+	bench_results results;
+
+	if (!r) {
+		r = &results;
+	}
+
+	LCD_clear();
+	LCD_set_cursor(0, 0);
+	bench_text("BENCHMARK");
+	LCD_set_cursor(0, 1);
+	bench_text("LET GO OF STICK");
+	while (bench_joystick_held()) {
+		_delay_ms(10);
+	}
+
+	TCCR1A = 0x00; // Normal mode, prescaler = 64, as BOOT_START
+	TCCR1B = (1 << CS11) | (1 << CS10);
+
+	r->lcd_bytes_per_s = bench_lcd();
+	r->cgram_us = bench_cgram();
+	r->adc_us = bench_adc();
+	uint32_t tick_total_us = bench_ticks();
+	r->tick_us = tick_total_us / BENCH_TICKS;
+	r->ticks_per_s = tick_total_us ? (uint32_t)BENCH_TICKS * 1000000UL / tick_total_us : 0;
+
+	bench_report(r);
+
+	for (uint8_t round = 0; round < 2 * BENCH_SHOW_ROUNDS; round++) {
+		bench_show(r, round & 1);
+		for (uint16_t ms = 0; ms < BENCH_SHOW_MS; ms += 10) {
+			_delay_ms(10);
+			if (bench_joystick_held()) {
+				round = 2 * BENCH_SHOW_ROUNDS;
+				break;
+			}
+		}
+	}
+
+	while (bench_joystick_held()) {
+		_delay_ms(10);
+	}
+#ifdef TETRIS_ANALOG
+	joystick_calibrate(); // Calibrated at power on with the stick held
+#endif
+	LCD_clear();
+}
+
+
+#endif // _BENCH_H_
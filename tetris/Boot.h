@@ -0,0 +1,75 @@
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+//Boot timestamps
+//
+//Build with -DTETRIS_BOOT_REPORT to time each boot phase with Timer1 and send the times over
+//USART0 once the first frame has been drawn, e.g.
+//  boot us: ports 0 adc 0 lcd 46800 glyphs 50100 first_frame 54100
+//Timer1 is started at the top of main at F_CPU/64 (4 us per count) and never reset, so every
+//time is since main started (reset start-up time set by the fuses is not included) and boot
+//must finish within 262 ms, when TCNT1 wraps.
+//Without TETRIS_BOOT_REPORT the macros compile to nothing. Not with TETRIS_VERSUS, whose link
+//has USART0 to itself.
+
+
+//Boot phases, in order
+#define BOOT_PORTS 0 // setup_AVR_ports
+#define BOOT_ADC 1 // setup_ADC
+#define BOOT_LCD 2 // LCD_init
+#define BOOT_GLYPHS 3 // create_tetris_characters
+#define BOOT_FIRST_FRAME 4 // First print_tetris_state_to_lcd
+#define BOOT_PHASES 5
+
+#define BOOT_US_PER_COUNT 4
+
+
+
+#ifdef TETRIS_BOOT_REPORT
+
+static const char *boot_phase_names[BOOT_PHASES] = {"ports", "adc", "lcd", "glyphs", "first_frame"};
+static uint16_t boot_times[BOOT_PHASES]; // TCNT1 at end of each phase
+static uint8_t boot_reported = 0;
+
+#define BOOT_START() TCCR1A = 0x00, TCCR1B = (1 << CS11) | (1 << CS10) // Normal mode, prescaler = 64
+#define BOOT_TIMESTAMP(phase) boot_times[phase] = TCNT1
+
+
+
+
+//---------------------------------------
+// Function: boot_frame_drawn
+//
+// Description: Called after every frame. Timestamp the first one and send all boot times over USART0
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void boot_frame_drawn()
+{
+	if (boot_reported) {
+		return;
+	}
+	BOOT_TIMESTAMP(BOOT_FIRST_FRAME);
+	boot_reported = 1;
+
+	USART_send_string("boot us:");
+	for (uint8_t i = 0; i < BOOT_PHASES; i++) {
+		USART_send_byte(' ');
+		USART_send_string(boot_phase_names[i]);
+		USART_send_byte(' ');
+		USART_send_number((uint32_t)boot_times[i] * BOOT_US_PER_COUNT);
+	}
+	USART_send_string("\r\n");
+}
+
+#else
+
+#define BOOT_START()
+#define BOOT_TIMESTAMP(phase)
+
+#endif // TETRIS_BOOT_REPORT
+
+
+#endif // _BOOT_H_
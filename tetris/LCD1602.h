@@ -8,6 +8,7 @@
 #define D5 3 // Data Pin 5 for LCD
 #define D6 4 // Data Pin 6 for LCD
 #define D7 5 // Data Pin 7 for LCD
+#define LCD_PANEL_ENABLE_FIRST 2 // Enable Pin for panel 1 on Port C, panel n on C(n + 1) (Multiple panels)
 
 
 //LCD Commands
@@ -15,9 +16,74 @@
 #define SHIFT_RIGHT 0x06
 #define CONTROLLER_INIT 0x33
 #define CLEAR_DISPLAY 0x01
-#define FOUR_BIT_INPUT 0x32
 #define CURSOR_SET 0x80
 #define FIVExEIGHT_CHAR_SIZE 0x28
+#define RETURN_HOME 0x02
+#define FOUR_BIT_NIBBLE 0x20 // Function set 4-bit, sent as a single nibble while still in 8-bit mode
+
+
+//LCD timing (HD44780U datasheet). R/W is tied low, so the busy flag cannot be read and
+//each wait is the datasheet minimum
+#define LCD_POWER_ON_DELAY 40 // ms after VCC rises to 2.7 V before the first instruction
+#define LCD_INIT_DELAY_1 4100 // us after the first function set when initializing by instruction
+#define LCD_INIT_DELAY_2 100 // us after the second function set
+#define LCD_CLEAR_DELAY 2 // ms, Clear Display and Return Home take 1.52 ms
+
+
+#define LCD_COLUMNS 16 // Characters visible per line, each DDRAM line holds 40
+
+
+//Multiple panels (build with -DLCD_PANELS=N, N = 1-4)
+//N LCD1602 modules share RS and D7-D4 on Port B and each have their own Enable pin: panel 0 on B1 (ENABLE),
+//panels 1-3 on C2-C4. They sit end to end as one 16N x 2 display. LCD_command and LCD_data pulse every
+//Enable pin at once, so LCD_init, the custom characters and text go to all panels. The game is drawn with
+//LCD_panel_flush instead: it sends only the characters that changed since the last flush and takes the
+//panels in turn, one byte each with 1 us Enable pulses, so each panel executes its instruction while the
+//others are sent theirs. A flush takes one LCD_PANEL_ROUND_SLOTS round per byte of the busiest panel,
+//however many panels there are. Without LCD_PANELS there is one panel, drawn as before
+#define LCD_PANELS_MAX 4
+#define LCD_PANEL_SLOT_US 2 // Bus time per panel in a round, two 1 us Enable pulses
+#define LCD_PANEL_ROUND_SLOTS 25 // 50 us between two bytes to the same panel, as pulse_enable_pin
+#define LCD_PANEL_UNKNOWN 0xFF // lcd_panel_shown entry after output outside LCD_panel_flush
+#define LCD_PANEL_ALL 0xFF // lcd_panel_select: pulse every Enable pin
+
+#ifdef LCD_PANELS
+#define LCD_PANEL_RENDER
+#if LCD_PANELS < 1 || LCD_PANELS > LCD_PANELS_MAX
+#error "LCD_PANELS must be 1 to LCD_PANELS_MAX"
+#endif
+#ifdef LCD_ASYNC
+#error "LCD_PANELS draws with LCD_panel_flush and cannot be combined with LCD_ASYNC"
+#endif
+#else
+#define LCD_PANELS 1
+#endif
+
+#define LCD_PANEL_ENABLE_PINS (((1 << LCD_PANELS) - 2) << (LCD_PANEL_ENABLE_FIRST - 1)) // Port C pins of panels 1 and up
+
+#ifdef LCD_PANEL_RENDER
+static uint8_t lcd_panel_select = LCD_PANEL_ALL; // Panel the Enable pulses go to
+static uint8_t lcd_panel_stale = 1; // Set by output outside LCD_panel_flush, lcd_panel_shown no longer holds
+static uint8_t lcd_panel_frame[LCD_PANELS][2 * LCD_COLUMNS]; // Next frame, line 1 from LCD_COLUMNS on
+static uint8_t lcd_panel_shown[LCD_PANELS][2 * LCD_COLUMNS]; // What each panel shows
+#endif
+
+
+//Asynchronous output (build with -DLCD_ASYNC)
+//Once LCD_async_start has been called, LCD_command and LCD_data push into lcd_async instead of
+//driving the pins, and TIMER0_COMPA_vect sends one byte every LCD_ASYNC_PERIOD, so a frame costs
+//the game loop 34 pushes instead of 34 x 100 us of Enable pulses. The ISR waits out Clear Display
+//and Return Home itself. Every LCD call after LCD_async_start must go through the ring
+#define LCD_ASYNC_BUFFER_SIZE 64 // Power of two, up to 128. Entries are byte | LCD_ASYNC_DATA
+#define LCD_ASYNC_DATA 0x100 // RS high
+#define LCD_ASYNC_PERIOD 13 // Timer0 counts at F_CPU/64 (4 us), 52 us covers the 37 us instruction time
+#define LCD_ASYNC_CLEAR_PERIODS 30 // 1.52 ms for Clear Display and Return Home
+
+#ifdef LCD_ASYNC
+RING_DEFINE(lcd_async, uint16_t, LCD_ASYNC_BUFFER_SIZE)
+static uint8_t lcd_async_on = 0; // Set by LCD_async_start
+static uint8_t lcd_async_wait = 0; // TIMER0_COMPA_vect only: periods left before the next byte
+#endif
 
 
 
@@ -43,6 +109,12 @@ void setup_AVR_ports()
 	DDRC = 0x00; // Configure Ports C0 and C1 as input ports
 	 
 	DDRB = 0x3F; // Configure Ports B5 - B0 as output ports
+#ifdef LCD_PANEL_RENDER
+	DDRC |= LCD_PANEL_ENABLE_PINS; // Enable pins of panels 1 and up
+#endif
+#ifdef TETRIS_TRACE
+	DDRD |= PROFILE_TRACE_PINS; // Trace marker outputs (Profile.h), PD2 (boot) is already high
+#endif
 
  
  
@@ -69,12 +141,55 @@ void setup_ADC()
 	ADCSRA |=(1<ADPS2)|(1<ADPS1) |(1<<ADPS0) | (1<<ADEN); //Enable ADC and use prescaler = 128
 	ADMUX |=(1<<REFS0);//Using AVcc as Reference Voltage
 	
+#ifdef TETRIS_INPUT_ISR
+	ADMUX |= 0x01; // Start with X on Port C1
+	ADCSRA |= (1<<ADIE) | (1<<ADSC); // Convert in the background, ADC_vect (Tetris.h) starts each next conversion
+	sei();
+#endif
 }
 
 
 
 
 
+#ifdef LCD_PANEL_RENDER
+//---------------------------------------
+// Function: LCD_panel_enable
+//
+// Description: Drive the Enable pin of the panel in lcd_panel_select, or of every panel
+//
+// Input: uint8_t high
+// Output: None
+//
+//---------------------------------------
+void LCD_panel_enable(uint8_t high)
+{
+	uint8_t pin_b = 1 << ENABLE;
+	uint8_t pins_c = LCD_PANEL_ENABLE_PINS;
+	
+	if (lcd_panel_select == 0) {
+		pins_c = 0;
+	}
+	else if (lcd_panel_select != LCD_PANEL_ALL) {
+		pin_b = 0;
+		pins_c = 1 << (LCD_PANEL_ENABLE_FIRST + lcd_panel_select - 1);
+	}
+	
+	if (high) {
+		PORTB |= pin_b;
+		PORTC |= pins_c;
+	}
+	else {
+		PORTB &= ~pin_b;
+		PORTC &= ~pins_c;
+	}
+}
+#endif // LCD_PANEL_RENDER
+
+
+
+
+
 //---------------------------------------
 // Function: pulse_enable_pin
 // 
@@ -86,11 +201,19 @@ void setup_ADC()
 //---------------------------------------
 void pulse_enable_pin()
 {
+#ifdef LCD_PANEL_RENDER
+	LCD_panel_enable(1);
+	
+	_delay_us(50);
+	
+	LCD_panel_enable(0);
+#else
 	enable_bit(PORTB,ENABLE); 
 	 
 	_delay_us(50); 
 	 
 	disable_bit(PORTB,ENABLE); 
+#endif
 }
 
 
@@ -152,6 +275,52 @@ void send_full_byte (uint8_t input_byte)
 
 
 
+#ifdef LCD_ASYNC
+//---------------------------------------
+// Function: LCD_async_push
+//
+// Description: Queue a command or data (LCD_ASYNC_DATA set) byte for TIMER0_COMPA_vect, waiting only while lcd_async is
+//              full, and make sure the interrupt is on. The read-modify-write of TIMSK0 can race with the ISR turning
+//              OCIE0A off, which at worst costs one extra interrupt that finds lcd_async empty
+//
+// Input: uint16_t entry
+// Output: None
+//
+//---------------------------------------
+void LCD_async_push(uint16_t entry)
+{
+	while (!lcd_async_push(entry)); // Spin while lcd_async is full, TIMER0_COMPA_vect is emptying it
+	TIMSK0 |= (1 << OCIE0A);
+}
+#endif // LCD_ASYNC
+
+
+
+
+
+//---------------------------------------
+// Function: LCD_clear_wait
+//
+// Description: Wait out Clear Display or Return Home, unless TIMER0_COMPA_vect is sending the bytes and waits itself
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void LCD_clear_wait()
+{
+#ifdef LCD_ASYNC
+	if (lcd_async_on) {
+		return;
+	}
+#endif
+	_delay_ms(LCD_CLEAR_DELAY);
+}
+
+
+
+
+
 //---------------------------------------
 // Function: LCD_command
 // 
@@ -163,6 +332,15 @@ void send_full_byte (uint8_t input_byte)
 //---------------------------------------
 void LCD_command (uint8_t cmd)
 {
+#ifdef LCD_ASYNC
+	if (lcd_async_on) {
+		LCD_async_push(cmd);
+		return;
+	}
+#endif
+#ifdef LCD_PANEL_RENDER
+	lcd_panel_stale = 1;
+#endif
 	disable_bit(PORTB,RS); // Set Command Mode
 	send_full_byte(cmd); // Send Command to LCD
 }
@@ -185,6 +363,15 @@ void LCD_command (uint8_t cmd)
 //---------------------------------------
 void LCD_data (uint8_t input_byte)
 {
+#ifdef LCD_ASYNC
+	if (lcd_async_on) {
+		LCD_async_push(input_byte | LCD_ASYNC_DATA);
+		return;
+	}
+#endif
+#ifdef LCD_PANEL_RENDER
+	lcd_panel_stale = 1;
+#endif
 	enable_bit(PORTB,RS); // Set Data Mode
 	send_full_byte(input_byte); // Send Data to LCD
 }
@@ -198,7 +385,9 @@ void LCD_data (uint8_t input_byte)
 //---------------------------------------
 // Function: LCD_init
 // 
-// Description: Initialize LCD Controller
+// Description: Initialize LCD Controller by instruction (datasheet figure 24) with the minimum waits. Works from power on
+//              and after an MCU reset that left the controller in 4-bit mode. Each 50 us Enable pulse covers the 37 us
+//              execution time of the instruction before it
 //
 // Input: None
 // Output: None
@@ -206,17 +395,22 @@ void LCD_data (uint8_t input_byte)
 //---------------------------------------
 void LCD_init()
 {
+	_delay_ms(LCD_POWER_ON_DELAY);
+	
+	disable_bit(PORTB,RS); // Set Command Mode
+	send_half_byte(CONTROLLER_INIT); // Function set 8-bit, three times
+	_delay_us(LCD_INIT_DELAY_1);
+	send_half_byte(CONTROLLER_INIT);
+	_delay_us(LCD_INIT_DELAY_2);
+	send_half_byte(CONTROLLER_INIT);
+	send_half_byte(FOUR_BIT_NIBBLE); // Input Mode = 4-bit
 	
-	LCD_command(CONTROLLER_INIT); // Controller Init
-	LCD_command(CURSOR_DISABLED); // Cursor Disabled
-	LCD_command(SHIFT_RIGHT); // Shift Right
-	LCD_command(FOUR_BIT_INPUT); // Input Mode = 4-bit
 	LCD_command(FIVExEIGHT_CHAR_SIZE); // 5x8 character size, 2 line display
+	LCD_command(CURSOR_DISABLED); // Display on, Cursor Disabled
+	LCD_command(SHIFT_RIGHT); // Shift Right
 	LCD_command(CLEAR_DISPLAY); // Clear Display
 	 
-	_delay_ms(5);
- 
-
+	_delay_ms(LCD_CLEAR_DELAY);
 }
 
 
@@ -236,7 +430,7 @@ void LCD_clear()
 {
 	LCD_command(CLEAR_DISPLAY); //LCD Clear Command
 	 
-	_delay_ms(5);
+	LCD_clear_wait();
 }
 
 
@@ -270,28 +464,208 @@ void LCD_set_cursor(uint8_t x, uint8_t y)
 
 
 //---------------------------------------
-// Function: LCD_save_custom_character
+// Function: LCD_save_custom_characters
 //
-// Description: Save 8 bytes from custchar array at cgramaddress location to be used as custom character for LCD display
+// Description: Save count custom characters from character code first_char on in one burst: a single Set CGRAM Address
+//              command, then 8 bytes per character as the address counter steps through CGRAM
 //
-// Input: uint8_t cgramaddress, 
-//        uint8_t custchar[]
+// Input: uint8_t first_char, 
+//        uint8_t *custchars[],
+//        uint8_t count
 // Output: None
 //
 //---------------------------------------
-void LCD_save_custom_character(uint8_t cgramaddress, uint8_t custchar[]) {
-	cgramaddress &= 0x7F;
-	cgramaddress |= 0x40;
-	LCD_command(cgramaddress);
-	_delay_ms(60);
-	for(int i = 0; i < 8; i++) {
-		
-		LCD_data(custchar[i]);
+void LCD_save_custom_characters(uint8_t first_char, uint8_t *custchars[], uint8_t count) {
+	LCD_command(0x40 | ((first_char << 3) & 0x3F));
+	for(uint8_t c = 0; c < count; c++) {
 		
+		for(uint8_t i = 0; i < 8; i++) {
+			
+			LCD_data(custchars[c][i]);
+			
+		}
+	}
+}
+
+
+
+#ifdef LCD_PANEL_RENDER
+//---------------------------------------
+// Function: LCD_panel_send
+//
+// Description: Send a command or data byte to one panel with 1 us Enable pulses, without waiting for it to be executed
+//
+// Input: uint8_t panel,
+//        uint8_t data (1 = RS high),
+//        uint8_t input_byte
+// Output: None
+//
+//---------------------------------------
+void LCD_panel_send(uint8_t panel, uint8_t data, uint8_t input_byte)
+{
+	if (data) {
+		enable_bit(PORTB,RS);
+	}
+	else {
+		disable_bit(PORTB,RS);
 	}
 	
+	lcd_panel_select = panel;
+	PORTB = (PORTB & 0xC3) | ((input_byte >> 2) & 0x3C); // High half byte on B5 - B2
+	LCD_panel_enable(1);
+	_delay_us(1);
+	LCD_panel_enable(0);
+	PORTB = (PORTB & 0xC3) | ((input_byte << 2) & 0x3C); // Low half byte
+	LCD_panel_enable(1);
+	_delay_us(1);
+	LCD_panel_enable(0);
+	lcd_panel_select = LCD_PANEL_ALL;
 }
 
 
 
+
+
+//---------------------------------------
+// Function: LCD_panel_flush
+//
+// Description: Bring every panel up to lcd_panel_frame. Each round gives every panel one slot in turn: the panel sends
+//              its next changed character, or first a Set DDRAM Address command if its address counter is not on it.
+//              A panel with nothing left to send still waits out its slot, so every panel gets its bytes exactly
+//              LCD_PANEL_ROUND_SLOTS slots apart and the instruction before has always been executed
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void LCD_panel_flush()
+{
+	uint8_t cell[LCD_PANELS]; // Next cell to compare, line * LCD_COLUMNS + column
+	uint8_t address[LCD_PANELS]; // DDRAM address counter of each panel, LCD_PANEL_UNKNOWN till set
+	uint8_t sent;
+	
+	if (lcd_panel_stale) {
+		_delay_us(LCD_PANEL_ROUND_SLOTS * LCD_PANEL_SLOT_US); // Last byte of LCD_command or LCD_data is still executing
+	}
+	for (uint8_t panel = 0; panel < LCD_PANELS; panel++) {
+		if (lcd_panel_stale) {
+			for (uint8_t i = 0; i < 2 * LCD_COLUMNS; i++) {
+				lcd_panel_shown[panel][i] = LCD_PANEL_UNKNOWN;
+			}
+		}
+		cell[panel] = 0;
+		address[panel] = LCD_PANEL_UNKNOWN;
+	}
+	lcd_panel_stale = 0;
+	
+	do {
+		sent = 0;
+		for (uint8_t panel = 0; panel < LCD_PANELS; panel++) {
+			uint8_t *frame = lcd_panel_frame[panel];
+			uint8_t *shown = lcd_panel_shown[panel];
+			uint8_t i = cell[panel];
+			
+			while (i < 2 * LCD_COLUMNS && frame[i] == shown[i]) {
+				i++;
+			}
+			cell[panel] = i;
+			
+			if (i == 2 * LCD_COLUMNS) {
+				_delay_us(LCD_PANEL_SLOT_US); // Keep the other panels' slots in place
+				continue;
+			}
+			
+			uint8_t cell_address = (i < LCD_COLUMNS) ? i : 0x40 + i - LCD_COLUMNS; // Line 1 --> 0x40 offset
+			if (address[panel] != cell_address) {
+				LCD_panel_send(panel, 0, CURSOR_SET | cell_address);
+				address[panel] = cell_address;
+			}
+			else {
+				LCD_panel_send(panel, 1, frame[i]);
+				shown[i] = frame[i];
+				address[panel]++;
+				cell[panel]++;
+			}
+			sent++;
+		}
+		
+		if (sent) {
+			_delay_us((LCD_PANEL_ROUND_SLOTS - LCD_PANELS) * LCD_PANEL_SLOT_US); // Rest of the round
+		}
+	} while (sent);
+}
+#endif // LCD_PANEL_RENDER
+
+
+
+#ifdef LCD_ASYNC
+//---------------------------------------
+// Function: TIMER0_COMPA_vect
+//
+// Description: Every LCD_ASYNC_PERIOD, send the next byte from lcd_async with a 1 us Enable pulse per half byte. Turns
+//              itself off when lcd_async is empty; the compare flag it leaves set makes it run as soon as LCD_async_push
+//              turns it back on, which is at least a period after the last byte
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+ISR(TIMER0_COMPA_vect)
+{
+	uint16_t entry;
+
+	if (lcd_async_wait) {
+		lcd_async_wait--;
+		return;
+	}
+	if (!lcd_async_pop(&entry)) {
+		TIMSK0 &= ~(1 << OCIE0A);
+		return;
+	}
+
+	if (entry & LCD_ASYNC_DATA) {
+		enable_bit(PORTB,RS);
+	}
+	else {
+		disable_bit(PORTB,RS);
+		if (entry == CLEAR_DISPLAY || entry == RETURN_HOME) {
+			lcd_async_wait = LCD_ASYNC_CLEAR_PERIODS;
+		}
+	}
+
+	PORTB = (PORTB & 0xC3) | ((entry >> 2) & 0x3C); // High half byte on B5 - B2
+	enable_bit(PORTB,ENABLE);
+	_delay_us(1);
+	disable_bit(PORTB,ENABLE);
+	PORTB = (PORTB & 0xC3) | ((entry << 2) & 0x3C); // Low half byte
+	enable_bit(PORTB,ENABLE);
+	_delay_us(1);
+	disable_bit(PORTB,ENABLE);
+}
+
+
+
+
+
+//---------------------------------------
+// Function: LCD_async_start
+//
+// Description: Start Timer0 in CTC mode at LCD_ASYNC_PERIOD and send all further LCD output through lcd_async.
+//              Call after LCD_init and the custom characters
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void LCD_async_start()
+{
+	TCCR0A = (1 << WGM01); // CTC, TOP = OCR0A
+	OCR0A = LCD_ASYNC_PERIOD - 1;
+	TCCR0B = (1 << CS01) | (1 << CS00); // Prescaler = 64
+	lcd_async_on = 1;
+	sei();
+}
+#endif // LCD_ASYNC
+
+
 #endif // _LCD1602_H_
\ No newline at end of file
@@ -0,0 +1,186 @@
+#ifndef _POLICY_TABLE_H_
+#define _POLICY_TABLE_H_
+
+//Placement policy for -DTETRIS_AUTOPLAY, generated by host/policy_solver.c (4 plies). Do not edit
+//
+//policy_table[type][surface / 2] holds the move (orientation * 4 + center x) for tetromino type
+//(init_tetromino) on a surface, in the low nibble for even surfaces. The surface is the height of
+//each column above the lowest one, up to POLICY_STEPS - 1: x0 + x1 * POLICY_STEPS + x2 * POLICY_STEPS^2
+//+ x3 * POLICY_STEPS^3. policy_shapes holds block 1-3's offsets from the center block in
+//orientation 0, which tell the types apart. Include after <avr/pgmspace.h>.
+
+
+#define POLICY_STEPS 5
+#define POLICY_SURFACES 625
+#define POLICY_TYPES 7
+
+
+static const int8_t policy_shapes[POLICY_TYPES][6] PROGMEM = {
+	{0, 1, 0, -1, 0, -2},
+	{1, 0, 0, -1, 1, -1},
+	{-1, 0, 1, 0, 0, -1},
+	{1, 1, 0, 1, -1, 0},
+	{-1, 1, 0, 1, 1, 0},
+	{0, 1, 1, 1, 0, -1},
+	{0, 1, -1, 1, 0, -1},
+};
+
+static const uint8_t policy_table[POLICY_TYPES][(POLICY_SURFACES + 1) / 2] PROGMEM = {
+	{
+		0x55, 0x55, 0x05, 0x55, 0x55, 0x50, 0x55, 0x05, 0x55, 0x55, 0x00, 0x55, 0x35, 0x33, 0x33, 0x55,
+		0x33, 0x03, 0x55, 0x55, 0x50, 0x55, 0x05, 0x50, 0x55, 0x33, 0x33, 0x33, 0x33, 0x33, 0x30, 0x33,
+		0x03, 0x33, 0x33, 0x00, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x03,
+		0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x30, 0x33, 0x53, 0x55,
+		0x55, 0x50, 0x55, 0x05, 0x55, 0x55, 0x50, 0x55, 0x05, 0x50, 0x55, 0x55, 0x55, 0x51, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x15, 0x11, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x55, 0x11, 0x51, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x30, 0x33, 0x11, 0x03, 0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55, 0x55, 0x05,
+		0x55, 0x55, 0x20, 0x55, 0x05, 0x22, 0x22, 0x00, 0x22, 0x52, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55, 0x15, 0x51, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x50, 0x15, 0x11, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55,
+		0x11, 0x51, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x55, 0x55, 0x50, 0x55,
+		0x05, 0x22, 0x22, 0x20, 0x22, 0x02, 0x22, 0x22, 0x55, 0x55, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x50, 0x55, 0x11, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x55, 0x11, 0x51, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x15, 0x11,
+		0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55, 0x55, 0x05, 0x52, 0x55, 0x20,
+		0x22, 0x02, 0x22, 0x22, 0x20, 0x22, 0x52, 0x55, 0x55, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x55, 0x15, 0x51, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50,
+		0x15, 0x11, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55, 0x11, 0x51, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	},
+	{
+		0x22, 0x12, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x02, 0x20, 0x22, 0x00,
+		0x20, 0x21, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x00, 0x20, 0x02, 0x00, 0x22, 0x00, 0x20,
+		0x22, 0x22, 0x22, 0x22, 0x22, 0x02, 0x00, 0x20, 0x00, 0x20, 0x02, 0x00, 0x22, 0x20, 0x02, 0x02,
+		0x22, 0x22, 0x00, 0x20, 0x02, 0x00, 0x20, 0x00, 0x20, 0x22, 0x22, 0x22, 0x11, 0x22, 0x02, 0x11,
+		0x11, 0x02, 0x20, 0x21, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x20, 0x22, 0x22, 0x00, 0x00,
+		0x02, 0x00, 0x20, 0x00, 0x00, 0x02, 0x00, 0x00, 0x22, 0x22, 0x02, 0x00, 0x20, 0x00, 0x00, 0x02,
+		0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x10, 0x11, 0x01,
+		0x10, 0x11, 0x02, 0x20, 0x22, 0x22, 0x22, 0x22, 0x22, 0x02, 0x12, 0x11, 0x02, 0x00, 0x20, 0x00,
+		0x00, 0x02, 0x00, 0x20, 0x00, 0x00, 0x20, 0x22, 0x22, 0x00, 0x00, 0x02, 0x00, 0x20, 0x00, 0x00,
+		0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x11, 0x11, 0x00, 0x11,
+		0x01, 0x00, 0x11, 0x22, 0x22, 0x02, 0x22, 0x22, 0x00, 0x11, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x11, 0x01, 0x10, 0x11, 0x00,
+		0x10, 0x01, 0x21, 0x11, 0x00, 0x22, 0x00, 0x11, 0x11, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x10, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	},
+	{
+		0xAA, 0x22, 0x42, 0x2F, 0x22, 0x44, 0xFF, 0x6F, 0x66, 0xFF, 0x66, 0x66, 0xF6, 0xFF, 0xFF, 0xF4,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xDF, 0xFF, 0x4F, 0xDF, 0x5F, 0x44, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xDF, 0xDD, 0xAD, 0xF4, 0xFD, 0x4F, 0xF4, 0xFF, 0xF4, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xDD, 0xDD, 0x4F, 0xDD, 0xFD, 0x44, 0xFF, 0x4F, 0xFF, 0xFF, 0xF4, 0xFF, 0x9F, 0x26,
+		0x22, 0x24, 0x22, 0x62, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x14, 0x55, 0x45, 0x00, 0x00,
+		0x04, 0x00, 0x40, 0x00, 0x00, 0x06, 0x00, 0xF0, 0xFD, 0xFF, 0x04, 0x00, 0xF0, 0x00, 0x00, 0x0F,
+		0x00, 0xF0, 0x00, 0x00, 0xDD, 0xDD, 0x4A, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00,
+		0xD0, 0xDD, 0xDD, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x11, 0x5E, 0x45,
+		0xEE, 0xEE, 0x44, 0x22, 0x62, 0x66, 0x66, 0x66, 0x66, 0x16, 0x51, 0x55, 0x04, 0x00, 0x60, 0x00,
+		0x00, 0x06, 0x00, 0x60, 0x00, 0x00, 0xD4, 0xA1, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00,
+		0x04, 0x00, 0xD0, 0xDD, 0xAF, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0xDD,
+		0xDD, 0x4D, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x10, 0xE1, 0x5E, 0xE4, 0xEE,
+		0x4E, 0x94, 0xEE, 0x66, 0x24, 0x62, 0x66, 0x66, 0x11, 0x55, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40,
+		0x00, 0x00, 0x06, 0x00, 0x40, 0x1D, 0x55, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00,
+		0x00, 0xD4, 0x1D, 0x4A, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0xD0, 0xDD, 0xDD,
+		0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x11, 0xEE, 0x45, 0xEE, 0xEE, 0x44,
+		0xEE, 0x9E, 0x99, 0xE9, 0x64, 0x66, 0x12, 0x51, 0x55, 0x04, 0x00, 0xE0, 0x00, 0x00, 0x04, 0x00,
+		0x40, 0x00, 0x00, 0xD4, 0x51, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40,
+		0xDD, 0x51, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0xDD, 0xDD, 0x41, 0x00,
+		0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x00,
+	},
+	{
+		0x55, 0x22, 0x76, 0x55, 0x66, 0x77, 0x57, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x55, 0x77, 0x77,
+		0x75, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x55, 0x75, 0x77, 0x55, 0x77, 0x77, 0x77,
+		0x77, 0x77, 0x77, 0x77, 0x77, 0x57, 0x55, 0x75, 0x57, 0x75, 0x77, 0x77, 0x75, 0x77, 0x77, 0x77,
+		0x77, 0x77, 0x55, 0x55, 0x57, 0x55, 0x75, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x77, 0x27, 0x22,
+		0x22, 0x66, 0x66, 0x76, 0x57, 0x65, 0x77, 0x77, 0x75, 0x77, 0x77, 0x51, 0x25, 0x72, 0x00, 0x00,
+		0x07, 0x00, 0x70, 0x00, 0x00, 0x07, 0x00, 0x70, 0x75, 0x75, 0x07, 0x00, 0x70, 0x00, 0x00, 0x07,
+		0x00, 0x70, 0x00, 0x00, 0x55, 0x55, 0x77, 0x00, 0x00, 0x07, 0x00, 0x70, 0x00, 0x00, 0x07, 0x00,
+		0x50, 0x55, 0x55, 0x05, 0x00, 0x70, 0x00, 0x00, 0x07, 0x00, 0x70, 0x00, 0x00, 0x51, 0x62, 0x26,
+		0x66, 0x66, 0x66, 0x66, 0x76, 0x77, 0x57, 0x77, 0x77, 0x17, 0x25, 0x22, 0x02, 0x00, 0x60, 0x00,
+		0x00, 0x07, 0x00, 0x70, 0x00, 0x00, 0x55, 0x55, 0x12, 0x00, 0x00, 0x02, 0x00, 0x70, 0x00, 0x00,
+		0x07, 0x00, 0x70, 0x55, 0x55, 0x07, 0x00, 0x70, 0x00, 0x00, 0x07, 0x00, 0x70, 0x00, 0x00, 0x55,
+		0x55, 0x55, 0x00, 0x00, 0x05, 0x00, 0x70, 0x00, 0x00, 0x07, 0x00, 0x10, 0x65, 0x66, 0x66, 0x66,
+		0x26, 0x62, 0x66, 0x66, 0x66, 0x66, 0x77, 0x57, 0x51, 0x25, 0x16, 0x00, 0x00, 0x02, 0x00, 0x60,
+		0x00, 0x00, 0x06, 0x00, 0x50, 0x55, 0x22, 0x01, 0x00, 0x20, 0x00, 0x00, 0x06, 0x00, 0x60, 0x00,
+		0x00, 0x55, 0x55, 0x55, 0x00, 0x00, 0x01, 0x00, 0x50, 0x00, 0x00, 0x06, 0x00, 0x50, 0x55, 0x55,
+		0x07, 0x00, 0x70, 0x00, 0x00, 0x07, 0x00, 0x70, 0x00, 0x00, 0x55, 0x66, 0x66, 0x66, 0x66, 0x66,
+		0x66, 0x66, 0x22, 0x66, 0x66, 0x66, 0x16, 0x55, 0x66, 0x01, 0x00, 0x60, 0x00, 0x00, 0x06, 0x00,
+		0x60, 0x00, 0x00, 0x55, 0x55, 0x12, 0x00, 0x00, 0x01, 0x00, 0x60, 0x00, 0x00, 0x06, 0x00, 0x50,
+		0x55, 0x25, 0x05, 0x00, 0x10, 0x00, 0x00, 0x05, 0x00, 0x60, 0x00, 0x00, 0x55, 0x55, 0x55, 0x00,
+		0x00, 0x05, 0x00, 0x10, 0x00, 0x00, 0x05, 0x00, 0x00,
+	},
+	{
+		0x16, 0x22, 0x46, 0x22, 0x22, 0x46, 0x66, 0x66, 0x46, 0x66, 0x66, 0x66, 0x46, 0x15, 0x55, 0x44,
+		0x21, 0x42, 0x24, 0x22, 0x44, 0x64, 0x66, 0x66, 0x64, 0x44, 0x15, 0x45, 0x54, 0x51, 0x44, 0x11,
+		0x42, 0x44, 0x22, 0x44, 0x46, 0x46, 0x44, 0x55, 0x44, 0x54, 0x45, 0x44, 0x55, 0x44, 0x64, 0x46,
+		0x44, 0x24, 0x44, 0x54, 0x45, 0x44, 0x55, 0x44, 0x54, 0x45, 0x44, 0x55, 0x44, 0x44, 0x66, 0x61,
+		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x56, 0x55, 0x45, 0x00, 0x00,
+		0x06, 0x00, 0x60, 0x00, 0x00, 0x06, 0x00, 0x40, 0x54, 0x51, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04,
+		0x00, 0x40, 0x00, 0x00, 0x44, 0x54, 0x41, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00,
+		0x40, 0x44, 0x54, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x11, 0x51, 0x65,
+		0x16, 0x66, 0x46, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x55, 0x55, 0x06, 0x00, 0x60, 0x00,
+		0x00, 0x06, 0x00, 0x60, 0x00, 0x00, 0x64, 0x55, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00,
+		0x04, 0x00, 0x40, 0x44, 0x15, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x44,
+		0x44, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x10, 0x51, 0x55, 0x14, 0x11,
+		0x45, 0x66, 0x61, 0x66, 0x66, 0x66, 0x66, 0x66, 0x55, 0x55, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40,
+		0x00, 0x00, 0x06, 0x00, 0x60, 0x56, 0x55, 0x04, 0x00, 0x40, 0x00, 0x00, 0x06, 0x00, 0x40, 0x00,
+		0x00, 0x44, 0x54, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x44, 0x54,
+		0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x15, 0x55, 0x45, 0x11, 0x55, 0x44,
+		0x11, 0x41, 0x64, 0x16, 0x64, 0x66, 0x56, 0x55, 0x55, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00,
+		0x40, 0x00, 0x00, 0x54, 0x55, 0x45, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40,
+		0x66, 0x55, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x44, 0x64, 0x45, 0x00,
+		0x00, 0x04, 0x00, 0x40, 0x00, 0x00, 0x04, 0x00, 0x00,
+	},
+	{
+		0xBB, 0x6E, 0xB6, 0xBB, 0xEE, 0xB0, 0xBB, 0x06, 0xB0, 0xBB, 0xB0, 0x2B, 0x92, 0xEE, 0xEE, 0xEE,
+		0xEE, 0x0E, 0xB0, 0x66, 0x00, 0xBB, 0x06, 0x00, 0xBB, 0x19, 0xE1, 0x0E, 0xE9, 0xEE, 0x00, 0xEE,
+		0x0E, 0xB0, 0x69, 0x00, 0xB0, 0x9B, 0x19, 0xE1, 0x90, 0x11, 0x0E, 0x90, 0xEE, 0x00, 0xEE, 0x0E,
+		0x00, 0xBB, 0x99, 0x99, 0x01, 0x99, 0x19, 0x00, 0x99, 0x01, 0x90, 0xE9, 0x00, 0xE0, 0x5E, 0xAA,
+		0xEE, 0xDB, 0xE6, 0x06, 0xB2, 0xBB, 0x00, 0x22, 0x22, 0x22, 0x22, 0xBB, 0xEB, 0xBE, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x90, 0x11, 0x1E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x99, 0x11, 0x0E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x90, 0x99, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x55, 0xAA, 0xDE,
+		0x2D, 0xE2, 0x22, 0x22, 0x02, 0x22, 0x22, 0x22, 0x22, 0x92, 0xA5, 0xE1, 0x05, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x19, 0x11, 0xB1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x90, 0x19, 0xE1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x99,
+		0x19, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD0, 0xAD, 0x1A, 0xDD, 0xA5,
+		0xDA, 0xDD, 0x22, 0x02, 0x22, 0x22, 0x22, 0x22, 0x5D, 0x15, 0xD1, 0x00, 0x00, 0x00, 0x00, 0x20,
+		0x00, 0x00, 0x02, 0x00, 0x90, 0x11, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0xB0, 0x11, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x90, 0x99, 0x11,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xDD, 0x55, 0xD1, 0x5D, 0xA5, 0xDD,
+		0x5D, 0x0A, 0x50, 0x2D, 0x20, 0x22, 0xD2, 0x5D, 0x15, 0x0D, 0x00, 0xD0, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0xDD, 0x11, 0xD1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x19, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x19, 0x01, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	},
+	{
+		0xE8, 0x6E, 0xA6, 0xA8, 0x66, 0xAA, 0xAA, 0xA6, 0xAA, 0x33, 0xAA, 0xAA, 0x8A, 0x68, 0x66, 0x85,
+		0x6E, 0x36, 0x83, 0x63, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x61, 0x36, 0x33, 0x63, 0x33, 0x33,
+		0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x31, 0x33, 0x13, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33,
+		0x33, 0x33, 0x13, 0x11, 0x33, 0x33, 0x31, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x83, 0xE9,
+		0x66, 0x85, 0xEE, 0x26, 0x22, 0x62, 0xAA, 0x8A, 0xAA, 0xAA, 0x3A, 0x68, 0x66, 0x56, 0x00, 0x00,
+		0x0A, 0x00, 0xA0, 0x00, 0x00, 0x0A, 0x00, 0x80, 0x11, 0x66, 0x03, 0x00, 0x30, 0x00, 0x00, 0x03,
+		0x00, 0x30, 0x00, 0x00, 0x33, 0x31, 0x33, 0x00, 0x00, 0x03, 0x00, 0x30, 0x00, 0x00, 0x03, 0x00,
+		0x80, 0x11, 0x11, 0x03, 0x00, 0x30, 0x00, 0x00, 0x03, 0x00, 0x30, 0x00, 0x00, 0x95, 0x99, 0x5E,
+		0x98, 0xEE, 0x22, 0x22, 0x22, 0x22, 0x22, 0xAA, 0xAA, 0x8A, 0x1D, 0xEE, 0x05, 0x00, 0x50, 0x00,
+		0x00, 0x02, 0x00, 0xA0, 0x00, 0x00, 0x88, 0x61, 0x86, 0x00, 0x00, 0x05, 0x00, 0xA0, 0x00, 0x00,
+		0x0A, 0x00, 0x80, 0x11, 0xE1, 0x08, 0x00, 0x80, 0x00, 0x00, 0x05, 0x00, 0xA0, 0x00, 0x00, 0x18,
+		0x11, 0x31, 0x00, 0x00, 0x03, 0x00, 0x30, 0x00, 0x00, 0x03, 0x00, 0xD0, 0x95, 0xE2, 0x55, 0x22,
+		0x5E, 0x25, 0x22, 0x22, 0x22, 0xA2, 0x22, 0x22, 0x55, 0x91, 0x5E, 0x00, 0x00, 0x05, 0x00, 0x20,
+		0x00, 0x00, 0x0A, 0x00, 0x80, 0x18, 0xE1, 0x0D, 0x00, 0x50, 0x00, 0x00, 0x05, 0x00, 0xA0, 0x00,
+		0x00, 0x18, 0x11, 0x86, 0x00, 0x00, 0x0A, 0x00, 0x50, 0x00, 0x00, 0x0A, 0x00, 0x10, 0x11, 0x11,
+		0x08, 0x00, 0x80, 0x00, 0x00, 0x08, 0x00, 0x50, 0x00, 0x00, 0x5D, 0x25, 0x52, 0x55, 0x22, 0x25,
+		0x22, 0x52, 0x55, 0x22, 0x22, 0x22, 0x52, 0x5D, 0x99, 0x05, 0x00, 0x50, 0x00, 0x00, 0x05, 0x00,
+		0x20, 0x00, 0x00, 0x8D, 0x11, 0xD9, 0x00, 0x00, 0x05, 0x00, 0x50, 0x00, 0x00, 0x02, 0x00, 0x80,
+		0x11, 0x11, 0x0D, 0x00, 0xD0, 0x00, 0x00, 0x05, 0x00, 0x50, 0x00, 0x00, 0x11, 0x11, 0x81, 0x00,
+		0x00, 0x08, 0x00, 0x80, 0x00, 0x00, 0x05, 0x00, 0x00,
+	},
+};
+
+
+#endif // _POLICY_TABLE_H_
@@ -0,0 +1,60 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+//Profiling markers
+//
+//Build with -DTETRIS_PROFILE to write a marker to GPIOR0 on entry and exit of each phase.
+//A write to GPIOR0 is a single OUT instruction, so markers cost 1 cycle each and do not
+//touch any port pin. The simavr cycle suite (host/simavr) watches GPIOR0 to time each phase.
+//Build with -DTETRIS_TRACE to also drive one PORTD pin per phase, high from entry to exit, so a logic
+//analyser shows the phases next to the LCD bus on PORTB: PD2 boot, PD3 tick, PD4 render, PD5 line
+//clear, PD6 link, PD7 input (PD0 and PD1 are USART0). Each marker is a single SBI or CBI instruction.
+//Without TETRIS_PROFILE or TETRIS_TRACE the markers compile to nothing.
+//Host programs can define PROFILE_HOOK(marker) before including this file to get a call instead
+//(host/lcd_emulator.c writes them to a VCD file with the LCD pins).
+
+
+//Phase IDs, bit 7 set on exit
+#define PROFILE_BOOT 0x01 // Reset till Tetris() is first called
+#define PROFILE_TICK 0x02 // tetris_tick
+#define PROFILE_RENDER 0x03 // print_tetris_state_to_lcd
+#define PROFILE_LINE_CLEAR 0x04 // remove_complete_rows
+#define PROFILE_LINK 0x05 // versus_sync_tick (Versus.h), includes waiting for the other board
+#define PROFILE_INPUT 0x06 // joystick_update, and joystick samples between ticks with TETRIS_ANALOG
+#define PROFILE_PHASES 7 // Phase IDs are below this
+
+#define PROFILE_EXIT 0x80
+
+#define PROFILE_TRACE_PINS 0xFC // PORTD pins driven by TETRIS_TRACE, phase + 1 is the pin number
+
+
+
+#if defined(PROFILE_HOOK)
+
+#define PROFILE_BEGIN(phase) PROFILE_HOOK(phase)
+#define PROFILE_END(phase) PROFILE_HOOK((phase) | PROFILE_EXIT)
+
+#elif defined(TETRIS_PROFILE) && defined(TETRIS_TRACE)
+
+#define PROFILE_BEGIN(phase) do { GPIOR0 = (phase); PORTD |= 1 << ((phase) + 1); } while (0)
+#define PROFILE_END(phase) do { GPIOR0 = (phase) | PROFILE_EXIT; PORTD &= ~(1 << ((phase) + 1)); } while (0)
+
+#elif defined(TETRIS_PROFILE)
+
+#define PROFILE_BEGIN(phase) GPIOR0 = (phase)
+#define PROFILE_END(phase) GPIOR0 = (phase) | PROFILE_EXIT
+
+#elif defined(TETRIS_TRACE)
+
+#define PROFILE_BEGIN(phase) PORTD |= 1 << ((phase) + 1)
+#define PROFILE_END(phase) PORTD &= ~(1 << ((phase) + 1))
+
+#else
+
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+
+#endif // PROFILE_HOOK
+
+
+#endif // _PROFILE_H_
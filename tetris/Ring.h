@@ -0,0 +1,118 @@
+#ifndef _RING_H_
+#define _RING_H_
+
+//Single producer, single consumer rings
+//
+//RING_DEFINE(name, type, capacity) declares a ring holding up to capacity (power of two, 2-128)
+//elements of type, and name_push, name_pop and name_count. One side only pushes and the other
+//only pops (an ISR and the game loop, in either direction), so neither has to disable interrupts:
+//head is written only by the producer and tail only by the consumer, each is one byte (a single
+//load or store on AVR), the element is written before head is advanced and read before tail is.
+//The indices run freely and wrap at 256, head - tail is the number of elements held.
+//
+//On AVR the barriers only stop the compiler from moving memory accesses across them: there is
+//one core and an ISR sees memory as the interrupted code left it. On the host they are
+//acquire/release atomics so host/ring_stress.c can run the two sides on different threads.
+
+
+
+
+//---------------------------------------
+// Function: ring_load_acquire
+//
+// Description: Read the other side's index, no later memory access is moved before it
+//
+// Input: const volatile uint8_t *index
+// Output: uint8_t
+//
+//---------------------------------------
+static inline uint8_t ring_load_acquire(const volatile uint8_t *index)
+{
+#ifdef __AVR__
+	uint8_t value = *index;
+	__asm__ __volatile__("" ::: "memory");
+	return value;
+#else
+	return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+#endif
+}
+
+
+
+
+//---------------------------------------
+// Function: ring_store_release
+//
+// Description: Publish own index, no earlier memory access is moved after it
+//
+// Input: volatile uint8_t *index,
+//        uint8_t value
+// Output: None
+//
+//---------------------------------------
+static inline void ring_store_release(volatile uint8_t *index, uint8_t value)
+{
+#ifdef __AVR__
+	__asm__ __volatile__("" ::: "memory");
+	*index = value;
+#else
+	__atomic_store_n(index, value, __ATOMIC_RELEASE);
+#endif
+}
+
+
+
+
+//---------------------------------------
+// Macro: RING_DEFINE
+//
+// Description: Declare ring name and its functions
+//              uint8_t name_push(type value)  Producer. 1 = pushed, 0 = ring full (value not stored)
+//              uint8_t name_pop(type *value)  Consumer. 1 = popped into value, 0 = ring empty
+//              uint8_t name_count()           Either side. Elements held (a lower bound for the consumer,
+//                                             an upper bound for the producer)
+//
+// Input: name,
+//        type,
+//        capacity
+//
+//---------------------------------------
+#define RING_DEFINE(name, type, capacity) \
+	_Static_assert((capacity) >= 2 && (capacity) <= 128 && ((capacity) & ((capacity) - 1)) == 0, \
+		#name " capacity must be a power of two from 2 to 128"); \
+	\
+	static struct { \
+		volatile uint8_t head; /* Next slot written, producer only */ \
+		volatile uint8_t tail; /* Next slot read, consumer only */ \
+		type buffer[capacity]; \
+	} name; \
+	\
+	static inline uint8_t name##_count() \
+	{ \
+		return (uint8_t)(ring_load_acquire(&name.head) - ring_load_acquire(&name.tail)); \
+	} \
+	\
+	static inline uint8_t name##_push(type value) \
+	{ \
+		uint8_t head = name.head; \
+		if ((uint8_t)(head - ring_load_acquire(&name.tail)) == (capacity)) { \
+			return 0; \
+		} \
+		name.buffer[head & ((capacity) - 1)] = value; \
+		ring_store_release(&name.head, head + 1); \
+		return 1; \
+	} \
+	\
+	static inline uint8_t name##_pop(type *value) \
+	{ \
+		uint8_t tail = name.tail; \
+		if (ring_load_acquire(&name.head) == tail) { \
+			return 0; \
+		} \
+		*value = name.buffer[tail & ((capacity) - 1)]; \
+		ring_store_release(&name.tail, tail + 1); \
+		return 1; \
+	}
+
+
+#endif // _RING_H_
@@ -0,0 +1,189 @@
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+//Statistical profiler
+//
+//Build with -DTETRIS_SAMPLE (ATmega328P only). Timer2 interrupts SAMPLE_HZ times a second and
+//counts the program counter it interrupted in sample_table, so time is measured wherever it is
+//spent, including the busy-waits of _delay_us, _delay_ms and the ADC that the Profile.h markers
+//cannot see. The interrupted PC is the return address the interrupt pushed: TIMER2_COMPA_vect reads
+//it from the stack and jumps to sample_record, which counts it in an open-addressed table of
+//SAMPLE_SLOTS addresses. An address that finds no free slot within SAMPLE_PROBES counts as lost.
+//
+//After every tetromino, sample_dump stops Timer2, sends the table over USART0 and empties it:
+//  samples 7412 lost 0
+//  sample 1690 3050      (byte address in flash, samples)
+//  ...
+//  samples end
+//host/sample_report.c adds up the dumps and maps the addresses to functions and source lines with
+//the firmware's ELF file. Code running with interrupts off (other interrupts, cli sections) is
+//counted at the instruction after it. Sampling costs about 3% of the CPU.
+//Include after USART.h.
+
+
+#define SAMPLE_HZ 5000
+#define SAMPLE_OCR (F_CPU / 64 / SAMPLE_HZ - 1) // Timer2 compare value at prescaler 64
+#define SAMPLE_SLOTS 128 // Power of two
+#define SAMPLE_PROBES 4
+
+
+#if SAMPLE_OCR > 255
+#error "SAMPLE_HZ is too low for Timer2 at prescaler 64"
+#endif
+
+
+//Struct to hold one sampled address
+typedef struct sample_slot {
+
+	uint16_t pc; // Word address
+	uint16_t count; // Samples, 0 = free slot (stops at 0xFFFF)
+
+} sample_slot;
+
+
+static sample_slot sample_table[SAMPLE_SLOTS];
+static uint16_t sample_total = 0; // Samples since the last dump (stops at 0xFFFF)
+static uint16_t sample_lost = 0; // Samples that found no slot
+volatile uint16_t sample_pc; // Written by TIMER2_COMPA_vect for sample_record
+
+
+
+
+//---------------------------------------
+// Function: TIMER2_COMPA_vect
+//
+// Description: Copy the return address the interrupt pushed into sample_pc and jump to sample_record. Naked, so the
+//              stack holds exactly the 4 registers pushed here above the return address (high byte first)
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+ISR(TIMER2_COMPA_vect, ISR_NAKED)
+{
+	__asm__ __volatile__(
+		"	push r24\n"
+		"	push r25\n"
+		"	push r30\n"
+		"	push r31\n"
+		"	in r30, __SP_L__\n"
+		"	in r31, __SP_H__\n"
+		"	ldd r25, Z+5\n" // Return address high byte
+		"	ldd r24, Z+6\n"
+		"	sts sample_pc + 1, r25\n"
+		"	sts sample_pc, r24\n"
+		"	pop r31\n"
+		"	pop r30\n"
+		"	pop r25\n"
+		"	pop r24\n"
+		"	jmp __vector_sample_record\n");
+}
+
+
+
+
+//---------------------------------------
+// Function: sample_record
+//
+// Description: Count sample_pc in sample_table. Only entered by a jump from TIMER2_COMPA_vect: the signal attribute
+//              saves what it uses and returns with reti. Named __vector_sample_record in assembly, as avr-gcc expects
+//              of a signal handler
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void sample_record(void) __asm__("__vector_sample_record") __attribute__((signal, used));
+void sample_record(void)
+{
+	uint16_t pc = sample_pc;
+	uint8_t slot = (pc ^ (pc >> 7)) & (SAMPLE_SLOTS - 1);
+
+	if (sample_total != 0xFFFF) {
+		sample_total++;
+	}
+
+	for (uint8_t i = 0; i < SAMPLE_PROBES; i++) {
+		sample_slot *s = &sample_table[(slot + i) & (SAMPLE_SLOTS - 1)];
+
+		if (s->count == 0) {
+			s->pc = pc;
+		}
+		if (s->pc == pc) {
+			if (s->count != 0xFFFF) {
+				s->count++;
+			}
+			return;
+		}
+	}
+
+	if (sample_lost != 0xFFFF) {
+		sample_lost++;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: sample_start
+//
+// Description: Start Timer2 in CTC mode at SAMPLE_HZ with its compare interrupt on
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void sample_start()
+{
+	TCCR2A = (1 << WGM21); // CTC, TOP = OCR2A
+	OCR2A = SAMPLE_OCR;
+	TCNT2 = 0;
+	TIMSK2 = (1 << OCIE2A);
+	TCCR2B = (1 << CS22); // Prescaler = 64
+	sei();
+}
+
+
+
+
+//---------------------------------------
+// Function: sample_dump
+//
+// Description: Stop sampling, send sample_table over USART0 and empty it, then start sampling again once the bytes
+//              have gone, so the dump itself is not sampled
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void sample_dump()
+{
+	TCCR2B = 0; // Stop Timer2
+
+	USART_send_string("samples ");
+	USART_send_number(sample_total);
+	USART_send_string(" lost ");
+	USART_send_number(sample_lost);
+	USART_send_byte('\n');
+
+	for (uint8_t i = 0; i < SAMPLE_SLOTS; i++) {
+		if (sample_table[i].count) {
+			USART_send_string("sample ");
+			USART_send_number((uint32_t)sample_table[i].pc * 2);
+			USART_send_byte(' ');
+			USART_send_number(sample_table[i].count);
+			USART_send_byte('\n');
+			sample_table[i].count = 0;
+		}
+	}
+	USART_send_string("samples end\n");
+
+	sample_total = 0;
+	sample_lost = 0;
+	while (usart_tx_count()); // USART_UDRE_vect sends the rest
+	sample_start();
+}
+
+
+#endif // _SAMPLER_H_
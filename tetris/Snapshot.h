@@ -0,0 +1,281 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+//Game snapshot in EEPROM
+//
+//Build with -DTETRIS_SNAPSHOT to resume a game after a power cut. Every SNAPSHOT_EVERY tetrominoes,
+//just after the next one has been drawn and before it is loaded, Tetris() packs the board (4 bits
+//per row), that tetromino, the generator state (tetris_rand_state) and the score into 22 bytes (8 more
+//for each panel after the first, LCD_PANELS) and writes them to EEPROM. Writes alternate between two
+//slots with a sequence number and a CRC, so a power cut while writing leaves the previous snapshot to
+//resume from, and eeprom_update_block only programs the bytes that changed (3.4 ms each).
+//
+//The ATmega328P has no brown-out interrupt (the BOD only holds the part in reset), so there is no
+//warning to save on: snapshot_boot reads MCUSR instead. After power on, brown-out or watchdog reset
+//the newest valid snapshot is resumed. After a reset by the RESET pin alone it is erased, so the
+//reset button still starts a new game. Tetris() erases it at game over as well.
+//
+//Include after Tetris.h.
+
+
+#define SNAPSHOT_EVERY 4 // Tetrominoes between snapshots
+#define SNAPSHOT_ADDRESS 0x000 // EEPROM address of slot 0, slot 1 follows
+#define SNAPSHOT_ROWS TETRIS_ROWS
+#define SNAPSHOT_ROW_BYTES ((SNAPSHOT_ROWS + 1) / 2)
+#define SNAPSHOT_ERASED 0xFF // piece value of an erased slot
+
+
+//Struct to hold one snapshot, as stored in EEPROM
+typedef struct snapshot {
+
+	uint32_t rng; // tetris_rand_state after drawing piece
+	uint16_t score; // Rows removed this game
+	uint16_t pieces; // Tetrominoes played this game
+	uint8_t rows[SNAPSHOT_ROW_BYTES]; // Row y in bits 4 * (y & 1) to 4 * (y & 1) + 3 of rows[y / 2], bit x = column x
+	uint8_t piece; // Tetromino about to be loaded: type in bits 0-2, orientation in bits 3-4
+	uint8_t sequence; // Newer snapshot = higher (modulo 256)
+	uint16_t crc; // CRC-16/CCITT of the bytes above
+
+} __attribute__((packed)) snapshot; // Packed so host builds store the same bytes
+
+
+static snapshot snapshot_saved; // Last snapshot written or loaded
+static uint8_t snapshot_resume = 0; // Set by snapshot_boot when snapshot_saved holds a game to resume
+
+
+
+
+//---------------------------------------
+// Function: snapshot_crc16
+//
+// Description: CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+//
+// Input: const uint8_t *data,
+//        uint8_t length
+// Output: uint16_t
+//
+//---------------------------------------
+uint16_t snapshot_crc16(const uint8_t *data, uint8_t length)
+{
+	uint16_t crc = 0xFFFF;
+
+	while (length--) {
+		crc ^= (uint16_t)*data++ << 8;
+		for (uint8_t i = 0; i < 8; i++) {
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+		}
+	}
+	return crc;
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_take
+//
+// Description: Pack the board and the tetromino about to be loaded (not drawn on the board yet) into s, with the
+//              generator state and score. The sequence number is left to snapshot_save
+//
+// Input: snapshot *s,
+//        uint8_t tetris_state[][TETRIS_ROWS],
+//        const struct tetromino_location *t_loc_p,
+//        uint8_t type,
+//        uint16_t score,
+//        uint16_t pieces
+// Output: None
+//
+//---------------------------------------
+void snapshot_take(snapshot *s, uint8_t tetris_state[][TETRIS_ROWS], const struct tetromino_location *t_loc_p, uint8_t type,
+	uint16_t score, uint16_t pieces)
+{
+	for (uint8_t i = 0; i < SNAPSHOT_ROW_BYTES; i++) {
+		s->rows[i] = 0;
+	}
+	for (uint8_t y = 0; y < SNAPSHOT_ROWS; y++) {
+		uint8_t row = 0;
+		for (uint8_t x = 0; x < 4; x++) {
+			if (tetris_state[x][y] != 0x00) {
+				row |= 1 << x;
+			}
+		}
+		s->rows[y / 2] |= row << (4 * (y & 1));
+	}
+
+	s->rng = tetris_rand_state;
+	s->score = score;
+	s->pieces = pieces;
+	s->piece = type | (t_loc_p->orientation << 3);
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_valid
+//
+// Description: Check the CRC and the tetromino of a snapshot
+//
+// Input: const snapshot *s
+// Output: int
+//
+//---------------------------------------
+static inline int snapshot_valid(const snapshot *s)
+{
+	return (s->piece & 0x07) < TETROMINO_TYPES && s->piece >> 5 == 0 &&
+		snapshot_crc16((const uint8_t *)s, offsetof(snapshot, crc)) == s->crc;
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_restore
+//
+// Description: Unpack a snapshot: the board into tetris_state (x = 0-3, x = 4-5 are redrawn by the first tick), the
+//              tetromino into t_loc_p ready for load_tetromino, and the generator state
+//
+// Input: const snapshot *s,
+//        uint8_t tetris_state[][TETRIS_ROWS],
+//        struct tetromino_location *t_loc_p
+// Output: int
+//		  -1 = Snapshot is not valid, nothing changed
+//         0 = Restored
+//
+//---------------------------------------
+int snapshot_restore(const snapshot *s, uint8_t tetris_state[][TETRIS_ROWS], struct tetromino_location *t_loc_p)
+{
+	if (!snapshot_valid(s)) {
+		return -1;
+	}
+
+	for (uint8_t y = 0; y < SNAPSHOT_ROWS; y++) {
+		uint8_t row = s->rows[y / 2] >> (4 * (y & 1));
+		for (uint8_t x = 0; x < 4; x++) {
+			tetris_state[x][y] = (row >> x) & 1 ? 0x03 : 0x00;
+		}
+	}
+
+	init_tetromino(s->piece & 0x07, t_loc_p); // Draws an orientation, so the generator is restored after
+	t_loc_p->orientation = (s->piece >> 3) & 0x03;
+	tetris_rand_state = s->rng;
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_slot
+//
+// Description: EEPROM address of a slot
+//
+// Input: uint8_t slot (0 or 1)
+// Output: void *
+//
+//---------------------------------------
+static inline void *snapshot_slot(uint8_t slot)
+{
+	return (void *)(uintptr_t)(SNAPSHOT_ADDRESS + slot * sizeof(snapshot));
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_save
+//
+// Description: Give s the next sequence number after snapshot_saved, seal it with its CRC and write it over the older
+//              slot. s becomes snapshot_saved
+//
+// Input: snapshot *s
+// Output: None
+//
+//---------------------------------------
+void snapshot_save(snapshot *s)
+{
+	s->sequence = snapshot_saved.sequence + 1;
+	s->crc = snapshot_crc16((const uint8_t *)s, offsetof(snapshot, crc));
+	eeprom_update_block(s, snapshot_slot(s->sequence & 1), sizeof(snapshot));
+	if (s != &snapshot_saved) {
+		snapshot_saved = *s;
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_load
+//
+// Description: Read both slots into s and keep the newest valid one
+//
+// Input: snapshot *s
+// Output: int
+//		  -1 = Neither slot holds a valid snapshot
+//         0 = s holds the newest snapshot
+//
+//---------------------------------------
+int snapshot_load(snapshot *s)
+{
+	snapshot other;
+
+	eeprom_read_block(s, snapshot_slot(0), sizeof(snapshot));
+	eeprom_read_block(&other, snapshot_slot(1), sizeof(snapshot));
+
+	int valid = snapshot_valid(s);
+
+	if (snapshot_valid(&other) && (!valid || (int8_t)(other.sequence - s->sequence) > 0)) {
+		*s = other;
+		valid = 1;
+	}
+	return valid ? 0 : -1;
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_erase
+//
+// Description: Mark both slots as holding no game (one byte each). The sequence carries on from snapshot_saved
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void snapshot_erase()
+{
+	for (uint8_t slot = 0; slot < 2; slot++) {
+		eeprom_update_byte((uint8_t *)snapshot_slot(slot) + offsetof(snapshot, piece), SNAPSHOT_ERASED);
+	}
+	snapshot_resume = 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: snapshot_boot
+//
+// Description: Call once at boot. Load the snapshot to resume into snapshot_saved, or erase it after a reset by the
+//              RESET pin, and clear MCUSR
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void snapshot_boot()
+{
+	uint8_t reset = MCUSR;
+
+	MCUSR = 0;
+	if ((reset & (1 << EXTRF)) && !(reset & ((1 << PORF) | (1 << BORF) | (1 << WDRF)))) {
+		snapshot_erase(); // Reset button: new game
+		return;
+	}
+	snapshot_resume = snapshot_load(&snapshot_saved) == 0;
+}
+
+
+#endif // _SNAPSHOT_H_
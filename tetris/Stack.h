@@ -0,0 +1,196 @@
+#ifndef _STACK_H_
+#define _STACK_H_
+
+//Stack high-water mark and guard zone
+//
+//Build with -DTETRIS_STACK_CHECK (ATmega328P only). Before main runs, stack_paint fills the free
+//SRAM between the end of .bss (_end) and the top of the stack with STACK_CANARY. The stack grows
+//down towards _end, so the painted bytes still left at the bottom are headroom that has never been
+//used. The lowest STACK_GUARD of them are the guard zone: stack_check (every tick) stops the game
+//with STACK OVERFLOW on the LCD as soon as any guard byte has been written, before the stack
+//reaches .bss.
+//
+//stack_headroom and stack_peak scan the paint and can be called at any time. stack_report (once per
+//tetromino) writes the headroom to GPIOR2:GPIOR1 in TETRIS_PROFILE builds, where the simavr cycle
+//suite reads it. A byte the stack used can hold STACK_CANARY by chance, so the numbers are exact
+//only to the first such byte, which is rare at the deepest point of the stack.
+//Include after LCD1602.h.
+
+
+#define STACK_CANARY 0xC5
+#define STACK_GUARD 32 // Bytes at the bottom of the painted area that the stack must never reach
+#define STACK_GPIOR1_ADDRESS 0x4A // Data space addresses of GPIOR1 and GPIOR2, for the simavr cycle suite
+#define STACK_GPIOR2_ADDRESS 0x4B
+
+
+
+#ifdef TETRIS_STACK_CHECK
+
+extern uint8_t _end; // End of .bss, from the linker
+extern uint8_t __stack; // Top of the stack (RAMEND), from the linker
+
+
+
+
+//---------------------------------------
+// Function: stack_paint
+//
+// Description: Fill SRAM from _end to __stack with STACK_CANARY. Runs in .init1, before the stack and __zero_reg__ are
+//              set up, so it is written in assembly and is never called
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void stack_paint(void) __attribute__((naked, used, section(".init1")));
+void stack_paint(void)
+{
+	__asm__ __volatile__(
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (STACK_CANARY));
+}
+
+
+
+
+//---------------------------------------
+// Function: stack_untouched
+//
+// Description: Lowest byte the stack has written to so far (first byte above _end that lost its paint)
+//
+// Input: None
+// Output: uint8_t *
+//
+//---------------------------------------
+static uint8_t *stack_untouched()
+{
+	uint8_t *p = &_end;
+
+	while (p <= &__stack && *p == STACK_CANARY) {
+		p++;
+	}
+	return p;
+}
+
+
+
+
+//---------------------------------------
+// Function: stack_headroom
+//
+// Description: Bytes between the guard zone and the deepest the stack has been so far
+//
+// Input: None
+// Output: uint16_t
+//
+//---------------------------------------
+uint16_t stack_headroom()
+{
+	uint8_t *lowest = stack_untouched();
+
+	return lowest > &_end + STACK_GUARD ? (uint16_t)(lowest - (&_end + STACK_GUARD)) : 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: stack_peak
+//
+// Description: Most stack bytes used so far
+//
+// Input: None
+// Output: uint16_t
+//
+//---------------------------------------
+uint16_t stack_peak()
+{
+	return (uint16_t)(&__stack + 1 - stack_untouched());
+}
+
+
+
+
+//---------------------------------------
+// Function: stack_overflow
+//
+// Description: Stop the game: the stack has reached the guard zone and the next call could corrupt .bss
+//
+// Input: None
+// Output: None (never returns)
+//
+//---------------------------------------
+void stack_overflow()
+{
+	const char *text = "STACK OVERFLOW";
+
+#ifdef LCD_ASYNC
+	while (lcd_async_count()); // Let Timer0 finish the byte it is sending
+	lcd_async_on = 0;
+#endif
+	cli();
+
+	LCD_clear();
+	LCD_set_cursor(1, 0);
+	while (*text) {
+		LCD_data(*text++);
+	}
+	while (1);
+}
+
+
+
+
+//---------------------------------------
+// Function: stack_check
+//
+// Description: Call stack_overflow if any byte of the guard zone has been written
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+static inline void stack_check()
+{
+	for (uint8_t i = 0; i < STACK_GUARD; i++) {
+		if ((&_end)[i] != STACK_CANARY) {
+			stack_overflow();
+		}
+	}
+}
+
+
+
+
+//---------------------------------------
+// Function: stack_report
+//
+// Description: Write stack_headroom to GPIOR2:GPIOR1 for the simavr cycle suite (TETRIS_PROFILE builds only)
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void stack_report()
+{
+#ifdef TETRIS_PROFILE
+	uint16_t headroom = stack_headroom();
+
+	GPIOR1 = headroom & 0xFF;
+	GPIOR2 = headroom >> 8;
+#endif
+}
+
+#endif // TETRIS_STACK_CHECK
+
+
+#endif // _STACK_H_
@@ -4,6 +4,38 @@ static uint8_t topFilled_char[] = {0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x0
 static uint8_t bottomFilled_char[] = {0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF};
 static uint8_t allFilled_char[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,};
 static int TETRIS_TICK_LENGTH = 500; //value in miliseconds
+static uint8_t tetris_rows_removed = 0; //Rows removed by last tetris_tick
+
+
+#define TETROMINO_TYPES 7 // I, O, T, S, Z, J, L (order used by load_random_tetromino and init_tetromino)
+
+
+//Playfield geometry. Rows run along the LCD_COLUMNS characters of each panel (LCD_PANELS in LCD1602.h), so
+//every panel adds 16 visible rows. Tetrominoes enter in the 3 rows above the visible ones
+#define TETRIS_VISIBLE_ROWS (LCD_COLUMNS * LCD_PANELS)
+#define TETRIS_ROWS (TETRIS_VISIBLE_ROWS + 3) // Second dimension (columns) of tetris_state, 19 with one panel
+#define TETRIS_ENTRY_ROW TETRIS_VISIBLE_ROWS // center_y of a new tetromino
+#define TETRIS_TOP_ROW (TETRIS_VISIBLE_ROWS - 1) // A block left in this row ends the game
+#define TETRIS_TICKS_PER_TETROMINO (TETRIS_ENTRY_ROW + 14) // Ticks load_tetromino gives a tetromino, 30 with one panel
+
+
+//Random number source for tetromino type and orientation. Host programs can define TETRIS_RAND()
+//before including this file to use their own seeded generator instead of rand()
+#ifndef TETRIS_RAND
+#ifdef TETRIS_SNAPSHOT
+//Snapshot.h saves the generator state, which rand() keeps to itself: use the ANSI C example generator instead
+static uint32_t tetris_rand_state = 1;
+
+static inline int tetris_rand() {
+	tetris_rand_state = tetris_rand_state * 1103515245UL + 12345;
+	return (tetris_rand_state >> 16) & 0x7FFF;
+}
+
+#define TETRIS_RAND() tetris_rand()
+#else
+#define TETRIS_RAND() rand()
+#endif // TETRIS_SNAPSHOT
+#endif
 
 
 //Struct to hold tetromino location data
@@ -30,7 +62,7 @@ typedef struct tetromino_location {
 //---------------------------------------
 // Function: create_tetris_characters
 //
-// Description: Save 4 custom characters in LCD Controller 
+// Description: Save 4 custom characters in LCD Controller as character codes 0-3, in one CGRAM burst
 //	1. No bytes set
 //  2. Top 4 bytes set
 //  3. Bottom 4 bytes set
@@ -41,12 +73,9 @@ typedef struct tetromino_location {
 //
 //---------------------------------------
 void create_tetris_characters() {
-	LCD_save_custom_character(0x00, noFilled_char);
-	LCD_save_custom_character(0x08, topFilled_char);
-	LCD_save_custom_character(0x10, bottomFilled_char);
-	LCD_save_custom_character(0x18, allFilled_char);
-
+	uint8_t *tetris_chars[] = {noFilled_char, topFilled_char, bottomFilled_char, allFilled_char};
 	
+	LCD_save_custom_characters(0, tetris_chars, 4);
 }
 
 
@@ -117,9 +146,9 @@ int update_tetromino_location_struct(struct tetromino_location *t_loc_p) {
 	if (((t_loc_p->center_x     +    t_loc_p->c_b1_x[t_loc_p->orientation]) > 3 ) |  ((t_loc_p->center_x     +    t_loc_p->c_b1_x[t_loc_p->orientation]) < 0)
 	|  ((t_loc_p->center_x     +    t_loc_p->c_b2_x[t_loc_p->orientation]) > 3 ) |  ((t_loc_p->center_x     +    t_loc_p->c_b2_x[t_loc_p->orientation]) < 0)
 	|  ((t_loc_p->center_x     +    t_loc_p->c_b3_x[t_loc_p->orientation]) > 3 ) |  ((t_loc_p->center_x     +    t_loc_p->c_b3_x[t_loc_p->orientation]) < 0)
-	|  ((t_loc_p->center_y     +    t_loc_p->c_b1_y[t_loc_p->orientation]) > 18 ) |  ((t_loc_p->center_y     +    t_loc_p->c_b1_y[t_loc_p->orientation]) < 0)
-	|  ((t_loc_p->center_y     +    t_loc_p->c_b2_y[t_loc_p->orientation]) > 18 ) |  ((t_loc_p->center_y     +    t_loc_p->c_b2_y[t_loc_p->orientation]) < 0)	
-	|  ((t_loc_p->center_y     +    t_loc_p->c_b3_y[t_loc_p->orientation]) > 18 ) |  ((t_loc_p->center_y     +    t_loc_p->c_b3_y[t_loc_p->orientation]) < 0)) {
+	|  ((t_loc_p->center_y     +    t_loc_p->c_b1_y[t_loc_p->orientation]) > TETRIS_ROWS - 1 ) |  ((t_loc_p->center_y     +    t_loc_p->c_b1_y[t_loc_p->orientation]) < 0)
+	|  ((t_loc_p->center_y     +    t_loc_p->c_b2_y[t_loc_p->orientation]) > TETRIS_ROWS - 1 ) |  ((t_loc_p->center_y     +    t_loc_p->c_b2_y[t_loc_p->orientation]) < 0)	
+	|  ((t_loc_p->center_y     +    t_loc_p->c_b3_y[t_loc_p->orientation]) > TETRIS_ROWS - 1 ) |  ((t_loc_p->center_y     +    t_loc_p->c_b3_y[t_loc_p->orientation]) < 0)) {
 		return -1;
 	}
 	
@@ -337,6 +366,465 @@ int move_tetromino(struct tetromino_location *t_loc_p, int columns,  uint8_t tet
 
 
 
+#ifdef TETRIS_INPUT_ISR
+
+//Interrupt driven joystick (build with -DTETRIS_INPUT_ISR)
+//setup_ADC starts conversions in the background, ADC_vect alternates between the X and Y channels
+//and pushes the joystick state into joystick_events every time it changes. joystick_update pops
+//them, so a push shorter than a tick is still seen
+#define JOYSTICK_LEFT 0x01
+#define JOYSTICK_RIGHT 0x02
+#define JOYSTICK_DOWN 0x04
+#define JOYSTICK_ROTATE 0x08
+#define JOYSTICK_EVENTS_SIZE 16 // Power of two, up to 128
+
+RING_DEFINE(joystick_events, uint8_t, JOYSTICK_EVENTS_SIZE)
+static uint8_t joystick_sampled = 0; // ADC_vect only: state from the latest conversion of each axis
+static uint8_t joystick_pushed = 0; // ADC_vect only: last state pushed
+static uint8_t joystick_state = 0; // joystick_update only: last state popped
+static volatile uint8_t joystick_raw_x = 128, joystick_raw_y = 128; // ADC_vect only: latest conversion of each axis / 4 (one byte, read without cli)
+
+
+
+
+//---------------------------------------
+// Function: ADC_vect
+//
+// Description: Update joystick_sampled from the finished conversion, start one on the other axis and push joystick_sampled
+//              if it changed (again on a later conversion if joystick_events is full)
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+ISR(ADC_vect)
+{
+	uint16_t value = ADC;
+
+	if (ADMUX & 0x01) { // X on Port C1
+		joystick_raw_x = value >> 2;
+		joystick_sampled &= ~(JOYSTICK_LEFT | JOYSTICK_RIGHT);
+		joystick_sampled |= (value < 250) ? JOYSTICK_LEFT : (value > 750) ? JOYSTICK_RIGHT : 0;
+		ADMUX = 0x40; // Y next
+	}
+	else { // Y on Port C0
+		joystick_raw_y = value >> 2;
+		joystick_sampled &= ~(JOYSTICK_DOWN | JOYSTICK_ROTATE);
+		joystick_sampled |= (value < 250) ? JOYSTICK_DOWN : (value > 750) ? JOYSTICK_ROTATE : 0;
+		ADMUX = 0x41; // X next
+	}
+	ADCSRA |= (1 << ADSC);
+
+	if (joystick_sampled != joystick_pushed && joystick_events_push(joystick_sampled)) {
+		joystick_pushed = joystick_sampled;
+	}
+}
+
+#endif // TETRIS_INPUT_ISR
+
+
+
+
+#ifdef TETRIS_BENCH
+//Benchmark replay (Bench.h). While bench_replaying is set, joystick_read still converts both channels, so the
+//benchmark counts their time, but returns the positions of a fixed script drawn from bench_replay_state
+static uint8_t bench_replaying = 0;
+static uint32_t bench_replay_state = 0;
+#endif
+
+
+
+
+//---------------------------------------
+// Function: joystick_read
+//
+// Description: Read the joystick's X and Y position (0-1023, about 512 at rest)
+//
+// Input: int *X_Val,
+//        int *Y_Val
+//
+// Output: None
+//
+//---------------------------------------
+static inline void joystick_read(int *X_Val, int *Y_Val) {
+
+#ifdef TETRIS_INPUT_ISR
+	*X_Val = joystick_raw_x << 2; // Latest background conversion
+	*Y_Val = joystick_raw_y << 2;
+#else
+	ADMUX = 0X41; // Set to Port C1
+	ADCSRA |= (1<<ADSC);//Trigger conversion in ADC
+	while ( !((1<<ADIF) & ADCSRA));//Spin until conversion in ADC is done
+	*X_Val = ADC;// Grab X value from ADC
+	ADC=0;//Clear ADC registers
+	ADMUX=0x40;//Set to Port C2
+	
+
+	ADCSRA |= (1<<ADSC);// Trigger conversion in ADC
+	while ( !((1<<ADIF) & ADCSRA));// Spin until conversion in ADC is done
+	*Y_Val = ADC; //Grab Y value from ADC
+	ADC=0;//Clear ADC registers
+#endif // TETRIS_INPUT_ISR
+#ifdef TETRIS_BENCH
+	if (bench_replaying) {
+		static const int positions[] = {0, 512, 512, 512, 1023}; // Left / down, rest, right / rotate
+
+		bench_replay_state = bench_replay_state * 1103515245UL + 12345;
+		*X_Val = positions[(bench_replay_state >> 16) % 5];
+		bench_replay_state = bench_replay_state * 1103515245UL + 12345;
+		*Y_Val = positions[(bench_replay_state >> 16) % 5];
+	}
+#endif
+}
+
+
+
+
+#ifdef TETRIS_ANALOG
+
+//Analog joystick (build with -DTETRIS_ANALOG)
+//How far the stick is pushed past its dead zone sets a level 1-ANALOG_LEVELS. The stick is sampled
+//ANALOG_SAMPLES_PER_TICK times per tick (at the tick and then while tetris_tick_wait waits), and each
+//sample adds the level to that axis' count, moving one column (or one row down, on top of gravity) each
+//time the count reaches ANALOG_LEVELS. So a light push moves once per tick, as the digital joystick does,
+//and a full push once per sample. A new push moves at once. Rotate stays once per tick.
+//joystick_calibrate learns the rest position at boot and widens the dead zone by the noise it sees.
+#define ANALOG_SAMPLES_PER_TICK 4
+#define ANALOG_LEVELS 4 // Levels past the dead zone, also the count per move
+#define ANALOG_CALIBRATION_SAMPLES 8 // Readings averaged for the rest position, 250 us apart
+#define ANALOG_DEAD_ZONE 48 // Dead zone either side of the rest position, on top of the spread seen at boot
+#define ANALOG_ROTATE 250 // Rotate when Y is this far above the rest position
+
+static int joystick_center_x = 512, joystick_center_y = 512; // Rest position
+static int joystick_dead_x = ANALOG_DEAD_ZONE, joystick_dead_y = ANALOG_DEAD_ZONE;
+static int8_t joystick_level_x = 0, joystick_level_y = 0; // Level at the last sample, negative = left / down
+static uint8_t joystick_count_x = 0, joystick_count_y = 0;
+
+
+
+
+//---------------------------------------
+// Function: joystick_calibrate
+//
+// Description: Learn the joystick's rest position and dead zone. Call at boot, after setup_ADC, with the stick let go
+//
+// Input: None
+//
+// Output: None
+//
+//---------------------------------------
+void joystick_calibrate() {
+	int X_Val, Y_Val;
+	int min_x = 1023, max_x = 0, min_y = 1023, max_y = 0;
+	long sum_x = 0, sum_y = 0;
+
+	for (int i = 0; i < ANALOG_CALIBRATION_SAMPLES; i++) {
+		_delay_us(250); // With TETRIS_INPUT_ISR, lets ADC_vect convert both axes again
+		joystick_read(&X_Val, &Y_Val);
+		sum_x += X_Val;
+		sum_y += Y_Val;
+		if (X_Val < min_x) min_x = X_Val;
+		if (X_Val > max_x) max_x = X_Val;
+		if (Y_Val < min_y) min_y = Y_Val;
+		if (Y_Val > max_y) max_y = Y_Val;
+	}
+
+	joystick_center_x = sum_x / ANALOG_CALIBRATION_SAMPLES;
+	joystick_center_y = sum_y / ANALOG_CALIBRATION_SAMPLES;
+	joystick_dead_x = ANALOG_DEAD_ZONE + (max_x - min_x);
+	joystick_dead_y = ANALOG_DEAD_ZONE + (max_y - min_y);
+}
+
+
+
+
+//---------------------------------------
+// Function: joystick_level
+//
+// Description: Level of an axis reading: 0 inside the dead zone, 1 to ANALOG_LEVELS as it gets to the end of its range
+//
+// Input: int value,
+//        int center,
+//        int dead
+//
+// Output: int8_t
+//		  Level, negative below the rest position
+//
+//---------------------------------------
+static int8_t joystick_level(int value, int center, int dead) {
+	int past = value - center;
+	int range = 1023 - center - dead; // Range past the dead zone above the rest position
+
+	if (past < 0) {
+		past = -past;
+		range = center - dead;
+	}
+	if (past <= dead || range <= 0) {
+		return 0;
+	}
+
+	int level = 1 + (past - dead - 1) * ANALOG_LEVELS / range; // 1 just past the dead zone
+	if (level > ANALOG_LEVELS) {
+		level = ANALOG_LEVELS;
+	}
+	return value < center ? -level : level;
+}
+
+
+
+
+//---------------------------------------
+// Function: joystick_repeat
+//
+// Description: Add a sample's level to an axis' count
+//
+// Input: int8_t level,
+//        int8_t *last_level,
+//        uint8_t *count
+//
+// Output: int
+//		  1 = Move now
+//		  0 = Don't move
+//
+//---------------------------------------
+static int joystick_repeat(int8_t level, int8_t *last_level, uint8_t *count) {
+	int fresh = (level > 0) != (*last_level > 0) || *last_level == 0;
+
+	*last_level = level;
+	if (level == 0) {
+		*count = 0;
+		return 0;
+	}
+	if (fresh) {
+		*count = 0; // New push, move now
+		return 1;
+	}
+
+	*count += level < 0 ? -level : level;
+	if (*count >= ANALOG_LEVELS) {
+		*count -= ANALOG_LEVELS;
+		return 1;
+	}
+	return 0;
+}
+
+
+
+
+//---------------------------------------
+// Function: joystick_analog_update
+//
+// Description: Sample the joystick and move the tetromino by the auto-repeat counts (rotate only at a tick)
+//
+// Input: struct tetromino_location *t_loc_p,
+//		  int columns
+//        uint8_t tetris_state[][columns],
+//        int tick (1 = sample at the tick, 0 = sample between ticks)
+//
+// Output: int
+//		  Number of moves made
+//
+//---------------------------------------
+int joystick_analog_update(struct tetromino_location *t_loc_p, int columns, uint8_t tetris_state[][columns], int tick) {
+	int X_Val, Y_Val;
+	int moves = 0;
+
+	joystick_read(&X_Val, &Y_Val);
+
+	int8_t level_x = joystick_level(X_Val, joystick_center_x, joystick_dead_x);
+	int8_t level_y = joystick_level(Y_Val, joystick_center_y, joystick_dead_y);
+
+	if (joystick_repeat(level_x, &joystick_level_x, &joystick_count_x)) {
+		move_tetromino(t_loc_p, TETRIS_ROWS, tetris_state, level_x < 0 ? 1 : 0); // 1 = left, 0 = right
+		moves++;
+	}
+
+	if (joystick_repeat(level_y < 0 ? level_y : 0, &joystick_level_y, &joystick_count_y)) {
+		move_tetromino(t_loc_p, TETRIS_ROWS, tetris_state, 2); // Soft drop
+		moves++;
+	}
+
+	if (tick && Y_Val - joystick_center_y > ANALOG_ROTATE) {
+		rotate_tetromino(t_loc_p, TETRIS_ROWS, tetris_state);
+		moves++;
+	}
+
+	return moves;
+}
+
+#endif // TETRIS_ANALOG
+
+
+
+
+#ifdef TETRIS_AUTOPLAY
+
+//Autoplay (build with -DTETRIS_AUTOPLAY)
+//The joystick is replaced by policy_table (PolicyTable.h, generated by host/policy_solver.c). On the
+//first tick of a tetromino, before it is drawn, autoplay_choose reads the surface of the locked blocks
+//and looks up the placement in flash. autoplay_read then stands in for the ADC, pushing the stick
+//left / right and rotate until the tetromino is there, and down after that.
+#ifdef TETRIS_ANALOG
+#error "TETRIS_AUTOPLAY replaces the joystick, build it without TETRIS_ANALOG"
+#endif
+
+static uint8_t autoplay_move = 0; // Placement of the falling tetromino: orientation * 4 + center x
+
+
+
+
+//---------------------------------------
+// Function: autoplay_type
+//
+// Description: Tell a tetromino's type from its block offsets in orientation 0
+//
+// Input: const struct tetromino_location *t_loc_p
+//
+// Output: uint8_t
+//		  Type (init_tetromino), POLICY_TYPES = Not found
+//
+//---------------------------------------
+static uint8_t autoplay_type(const struct tetromino_location *t_loc_p) {
+	const int offsets[6] = {t_loc_p->c_b1_x[0], t_loc_p->c_b1_y[0], t_loc_p->c_b2_x[0], t_loc_p->c_b2_y[0],
+		t_loc_p->c_b3_x[0], t_loc_p->c_b3_y[0]};
+	uint8_t type;
+
+	for (type = 0; type < POLICY_TYPES; type++) {
+		uint8_t i = 0;
+		while (i < 6 && (int8_t)pgm_read_byte(&policy_shapes[type][i]) == offsets[i]) {
+			i++;
+		}
+		if (i == 6) {
+			break;
+		}
+	}
+	return type;
+}
+
+
+
+
+//---------------------------------------
+// Function: autoplay_shape
+//
+// Description: Blocks of a tetromino in an orientation, as bits y * 4 + x of the 4x4 box around them
+//
+// Input: const struct tetromino_location *t_loc_p,
+//        uint8_t orientation,
+//        int *min_x (center x - box left edge)
+//
+// Output: uint16_t
+//
+//---------------------------------------
+static uint16_t autoplay_shape(const struct tetromino_location *t_loc_p, uint8_t orientation, int *min_x) {
+	const int dx[4] = {0, t_loc_p->c_b1_x[orientation], t_loc_p->c_b2_x[orientation], t_loc_p->c_b3_x[orientation]};
+	const int dy[4] = {0, t_loc_p->c_b1_y[orientation], t_loc_p->c_b2_y[orientation], t_loc_p->c_b3_y[orientation]};
+	int min_y = 0;
+	uint16_t shape = 0;
+
+	*min_x = 0;
+	for (uint8_t i = 1; i < 4; i++) {
+		if (dx[i] < *min_x) *min_x = dx[i];
+		if (dy[i] < min_y) min_y = dy[i];
+	}
+	for (uint8_t i = 0; i < 4; i++) {
+		shape |= 1 << ((dy[i] - min_y) * 4 + dx[i] - *min_x);
+	}
+	return shape;
+}
+
+
+
+
+//---------------------------------------
+// Function: autoplay_choose
+//
+// Description: Look up the placement of a tetromino that is not drawn on tetris_state yet in policy_table. Orientations
+//              with the same blocks (the O, and the I, S and Z turned half way) land alike, so the one that takes the
+//              fewest turns from the spawn orientation is played
+//
+// Input: const struct tetromino_location *t_loc_p,
+//		  int columns
+//        uint8_t tetris_state[][columns]
+//
+// Output: uint8_t
+//		  Move: orientation * 4 + center x
+//
+//---------------------------------------
+static uint8_t autoplay_choose(const struct tetromino_location *t_loc_p, int columns, uint8_t tetris_state[][columns]) {
+	uint8_t height[4], lowest = TETRIS_TOP_ROW;
+	uint16_t surface = 0;
+	uint8_t type = autoplay_type(t_loc_p);
+
+	if (type == POLICY_TYPES) {
+		return t_loc_p->orientation * 4 + t_loc_p->center_x; // Unknown tetromino: drop it where it is
+	}
+
+	for (uint8_t x = 0; x < 4; x++) {
+		height[x] = TETRIS_TOP_ROW; // Rows below TETRIS_TOP_ROW, a block in it is game over
+		while (height[x] > 0 && tetris_state[x][height[x] - 1] == 0x00) {
+			height[x]--;
+		}
+		if (height[x] < lowest) {
+			lowest = height[x];
+		}
+	}
+	for (int8_t x = 3; x >= 0; x--) {
+		uint8_t step = height[x] - lowest;
+		surface = surface * POLICY_STEPS + (step < POLICY_STEPS ? step : POLICY_STEPS - 1);
+	}
+
+	uint8_t move = (pgm_read_byte(&policy_table[type][surface / 2]) >> (4 * (surface & 1))) & 0x0F;
+	uint8_t target = move >> 2;
+	int min_x, other_min_x;
+	uint16_t shape = autoplay_shape(t_loc_p, target, &min_x);
+
+	for (uint8_t turns = 0; turns < 4; turns++) {
+		uint8_t orientation = (t_loc_p->orientation + 4 - turns) % 4; // rotate_tetromino turns to orientation - 1
+		if (autoplay_shape(t_loc_p, orientation, &other_min_x) == shape) {
+			return orientation * 4 + (move & 0x03) + min_x - other_min_x;
+		}
+	}
+	return move;
+}
+
+
+
+
+//---------------------------------------
+// Function: autoplay_read
+//
+// Description: Joystick position that takes the tetromino to its placement: left / right first, rotate meanwhile, then
+//              down. Chooses the placement on the tetromino's first tick
+//
+// Input: const struct tetromino_location *t_loc_p,
+//		  int columns
+//        uint8_t tetris_state[][columns],
+//        int *X_Val,
+//        int *Y_Val
+//
+// Output: None
+//
+//---------------------------------------
+static void autoplay_read(const struct tetromino_location *t_loc_p, int columns, uint8_t tetris_state[][columns],
+	int *X_Val, int *Y_Val) {
+
+	if (t_loc_p->center_y == TETRIS_ENTRY_ROW) { // Spawn row: first tick
+		autoplay_move = autoplay_choose(t_loc_p, columns, tetris_state);
+	}
+
+	int x = autoplay_move & 0x03;
+	int orientation = autoplay_move >> 2;
+
+	*X_Val = t_loc_p->center_x < x ? 1023 : t_loc_p->center_x > x ? 0 : 512;
+	*Y_Val = t_loc_p->orientation != orientation ? 1023 : *X_Val == 512 ? 0 : 512;
+}
+
+#endif // TETRIS_AUTOPLAY
+
+
+
+
 //---------------------------------------
 // Function: joystick_update
 //
@@ -351,23 +839,30 @@ int move_tetromino(struct tetromino_location *t_loc_p, int columns,  uint8_t tet
 //---------------------------------------
 void joystick_update(struct tetromino_location *t_loc_p, int columns,  uint8_t tetris_state[][columns]) {
 	
+	PROFILE_BEGIN(PROFILE_INPUT);
 	
+#ifdef TETRIS_ANALOG
+	joystick_analog_update(t_loc_p, columns, tetris_state, 1);
+#else
 	int X_Val =0;
 	int Y_Val =0;
-	
 
-	ADMUX = 0X41; // Set to Port C1
-	ADCSRA |= (1<<ADSC);//Trigger conversion in ADC
-	while ( !((1<<ADIF) & ADCSRA));//Spin until conversion in ADC is done
-	X_Val = ADC;// Grab X value from ADC
-	ADC=0;//Clear ADC registers
-	ADMUX=0x40;//Set to Port C2
-	
+#ifdef TETRIS_AUTOPLAY
+	autoplay_read(t_loc_p, columns, tetris_state, &X_Val, &Y_Val);
+#elif defined(TETRIS_INPUT_ISR)
+	// Every state held since the last tick counts, not just the one the stick is in now
+	uint8_t input = joystick_state;
+	uint8_t event;
+	while (joystick_events_pop(&event)) {
+		input |= event;
+		joystick_state = event;
+	}
+	X_Val = (input & JOYSTICK_LEFT) ? 0 : (input & JOYSTICK_RIGHT) ? 1023 : 512;
+	Y_Val = (input & JOYSTICK_DOWN) ? 0 : (input & JOYSTICK_ROTATE) ? 1023 : 512;
+#else
 
-	ADCSRA |= (1<<ADSC);// Trigger conversion in ADC
-	while ( !((1<<ADIF) & ADCSRA));// Spin until conversion in ADC is done
-	Y_Val = ADC; //Grab Y value from ADC
-	ADC=0;//Clear ADC registers
+	joystick_read(&X_Val, &Y_Val);
+#endif // TETRIS_INPUT_ISR
 
 
 		// 0 == right(Increase x)
@@ -376,27 +871,29 @@ void joystick_update(struct tetromino_location *t_loc_p, int columns,  uint8_t t
 	if (X_Val<250) // Go Left
 
 	{
-		move_tetromino(t_loc_p, 19, tetris_state, 1);
+		move_tetromino(t_loc_p, TETRIS_ROWS, tetris_state, 1);
 	}
 
 	if (X_Val>750) // Go Right
 
 	{
-		move_tetromino(t_loc_p, 19, tetris_state, 0);
+		move_tetromino(t_loc_p, TETRIS_ROWS, tetris_state, 0);
 	}
 
 	if (Y_Val<250) // Go Down
 
 	{
-		move_tetromino(t_loc_p, 19, tetris_state, 2);
+		move_tetromino(t_loc_p, TETRIS_ROWS, tetris_state, 2);
 	}
 
 	if (Y_Val>750) // Rotate
 
 	{
-		rotate_tetromino(t_loc_p, 19, tetris_state);
+		rotate_tetromino(t_loc_p, TETRIS_ROWS, tetris_state);
 	}
+#endif // TETRIS_ANALOG
 	
+	PROFILE_END(PROFILE_INPUT);
 }
 
 
@@ -485,7 +982,7 @@ void update_2_row_tetris_state(int columns, uint8_t tetris_state[][columns]) {
 	
 		for(int i= 0; i<2; i++) {
 			
-			for(int j = 0; j<19; j++) {
+			for(int j = 0; j<columns; j++) {
 				
 				if (tetris_state[2*i][j] == 0x00 && tetris_state[(2*i) + 1][j] == 0x00) {
 					
@@ -520,7 +1017,7 @@ void update_2_row_tetris_state(int columns, uint8_t tetris_state[][columns]) {
 //---------------------------------------
 // Function: print_tetris_state_to_lcd
 //
-// Description: Print rows 4,5 in tetris_state to LCD 1602 display
+// Description: Print rows 4,5 in tetris_state to LCD 1602 display, or to each panel in turn with LCD_PANELS
 //
 // Input: int columns
 //        uint8_t tetris_state[][columns],
@@ -529,21 +1026,36 @@ void update_2_row_tetris_state(int columns, uint8_t tetris_state[][columns]) {
 //---------------------------------------
 void print_tetris_state_to_lcd(int columns, uint8_t tetris_state[][columns]) {
 	
+	PROFILE_BEGIN(PROFILE_RENDER);
+	
 	update_2_row_tetris_state(columns, tetris_state);
 	
+#ifdef LCD_PANEL_RENDER
+	// Panel p shows rows 16p to 16p + 15, only the characters that changed are sent
+	for(int i =0; i<2; i++) {
+		for(int j = 0; j<TETRIS_VISIBLE_ROWS; j++) {
+				lcd_panel_frame[j / LCD_COLUMNS][i * LCD_COLUMNS + j % LCD_COLUMNS] = tetris_state[i+4][j];
+		}
+	}
+	
+	LCD_panel_flush();
+#else
 	
 	for(int i =0; i<2; i++) {
 		LCD_set_cursor(0,i);
-		for(int j = 0; j<19; j++) {
+		for(int j = 0; j<columns; j++) {
 				LCD_data(tetris_state[i+4][j]);
 		}
 
 
 	}
+#endif
 	
-	
+	PROFILE_END(PROFILE_RENDER);
 
-	
+#ifdef TETRIS_BOOT_REPORT
+	boot_frame_drawn();
+#endif
 }
 
 
@@ -555,13 +1067,16 @@ void print_tetris_state_to_lcd(int columns, uint8_t tetris_state[][columns]) {
 // Input: int columns,
 //        uint8_t tetris_state[][columns]
 //
-// Output: None
+// Output: int
+//         Number of rows removed
 //---------------------------------------
-void remove_complete_rows(int columns, uint8_t tetris_state[][columns]) {
+int remove_complete_rows(int columns, uint8_t tetris_state[][columns]) {
+	
+	PROFILE_BEGIN(PROFILE_LINE_CLEAR);
 	
 	int shift = 0;
 	
-	for(int i=0;i<17;i++) {
+	for(int i=0;i<=TETRIS_ENTRY_ROW;i++) {
 		
 		if ((tetris_state[0][i] == 0x03) && (tetris_state[1][i] == 0x03) && (tetris_state[2][i] == 0x03) && (tetris_state[3][i] == 0x03) ) {
 			
@@ -578,6 +1093,9 @@ void remove_complete_rows(int columns, uint8_t tetris_state[][columns]) {
 		
 	}
 	
+	PROFILE_END(PROFILE_LINE_CLEAR);
+	
+	return shift;
 }
 
 
@@ -586,36 +1104,138 @@ void remove_complete_rows(int columns, uint8_t tetris_state[][columns]) {
 
 
 //---------------------------------------
-// Function: load_tetromino
+// Function: add_garbage_rows
 //
-// Description: Drop new tetromino block into display from Y=15 and descend till it lands on an existing block or the bottom of display
+// Description: Push tetris_state up by rows and fill the bottom rows with blocks, leaving a hole in one column.
+//              Blocks pushed above the top row of tetris_state are lost. Call between tetrominoes, not while one is falling
 //
 // Input: int columns,
 //        uint8_t tetris_state[][columns],
-//        struct tetromino_location *t_loc_p
+//        int rows,
+//        int hole (x coordinate of column left empty)
 //
 // Output: None
 //---------------------------------------
-void load_tetromino(int columns, uint8_t tetris_state[][columns], struct tetromino_location *t_loc_p) {
-	update_tetromino_location_struct(t_loc_p);
+void add_garbage_rows(int columns, uint8_t tetris_state[][columns], int rows, int hole) {
 	
-	for (int i=30;i>0;i--) {
+	for(int x=0;x<4;x++) {
 		
+		for(int y=columns-1;y>=0;y--) {
+			
+			if (y >= rows) {
+				tetris_state[x][y] = tetris_state[x][y - rows];
+			}
+			else {
+				tetris_state[x][y] = (x == hole) ? 0x00 : 0x03;
+			}
+		}
+	}
+}
+
 
-		joystick_update(t_loc_p, 19, tetris_state);
 
-		int rc = update_tetris_state(t_loc_p, 19, tetris_state);
 
-		if (rc == 0) {
 
-			print_tetris_state_to_lcd(19,tetris_state);
+
+//---------------------------------------
+// Function: tetris_tick
+//
+// Description: Run one tick of the falling tetromino: read joystick, descend one row and print tetris_state to LCD. Completed rows are removed once tetromino has landed
+//
+// Input: int columns,
+//        uint8_t tetris_state[][columns],
+//        struct tetromino_location *t_loc_p
+//
+// Output: int
+//		  -1 = Tetromino has landed and completed rows have been removed (count in tetris_rows_removed)
+//         0 = Tetromino is still falling
+//---------------------------------------
+int tetris_tick(int columns, uint8_t tetris_state[][columns], struct tetromino_location *t_loc_p) {
+
+#ifdef TETRIS_STACK_CHECK
+	stack_check(); // Deepest calls of the last tick are done, before this one is timed
+#endif
+	PROFILE_BEGIN(PROFILE_TICK);
+
+	tetris_rows_removed = 0;
+	joystick_update(t_loc_p, TETRIS_ROWS, tetris_state);
+
+	int rc = update_tetris_state(t_loc_p, TETRIS_ROWS, tetris_state);
+
+	if (rc == 0) {
+
+		print_tetris_state_to_lcd(TETRIS_ROWS,tetris_state);
+		PROFILE_END(PROFILE_TICK);
+		return 0;
+	}
+	
+	tetris_rows_removed = remove_complete_rows(TETRIS_ROWS, tetris_state);
+	print_tetris_state_to_lcd(TETRIS_ROWS,tetris_state);
+	PROFILE_END(PROFILE_TICK);
+	return -1;
+}
+
+
+
+
+
+
+//---------------------------------------
+// Function: tetris_tick_wait
+//
+// Description: Wait TETRIS_TICK_LENGTH till the next tetris_tick. With TETRIS_ANALOG the joystick is sampled while waiting,
+//              and tetris_state is printed to LCD again if the tetromino moved
+//
+// Input: int columns,
+//        uint8_t tetris_state[][columns],
+//        struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void tetris_tick_wait(int columns, uint8_t tetris_state[][columns], struct tetromino_location *t_loc_p) {
+#ifdef TETRIS_ANALOG
+	for (int i = 1; i < ANALOG_SAMPLES_PER_TICK; i++) {
+		_delay_ms(TETRIS_TICK_LENGTH / ANALOG_SAMPLES_PER_TICK);
+		PROFILE_BEGIN(PROFILE_INPUT);
+		int moves = joystick_analog_update(t_loc_p, columns, tetris_state, 0);
+		PROFILE_END(PROFILE_INPUT);
+		if (moves) {
+			print_tetris_state_to_lcd(TETRIS_ROWS,tetris_state);
 		}
-		else{
-			remove_complete_rows(19, tetris_state);
-			print_tetris_state_to_lcd(19,tetris_state);
+	}
+	_delay_ms(TETRIS_TICK_LENGTH / ANALOG_SAMPLES_PER_TICK);
+#else
+	(void)tetris_state;
+	(void)t_loc_p;
+	_delay_ms(TETRIS_TICK_LENGTH);
+#endif
+}
+
+
+
+
+
+
+//---------------------------------------
+// Function: load_tetromino
+//
+// Description: Drop new tetromino block into display from Y=15 and descend till it lands on an existing block or the bottom of display
+//
+// Input: int columns,
+//        uint8_t tetris_state[][columns],
+//        struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void load_tetromino(int columns, uint8_t tetris_state[][columns], struct tetromino_location *t_loc_p) {
+	update_tetromino_location_struct(t_loc_p);
+	
+	for (int i=TETRIS_TICKS_PER_TETROMINO;i>0;i--) {
+		
+		if (tetris_tick(columns, tetris_state, t_loc_p) != 0) {
 			return;
 		}
-		_delay_ms(TETRIS_TICK_LENGTH);
+		tetris_tick_wait(columns, tetris_state, t_loc_p);
 
 		
 	}
@@ -628,16 +1248,15 @@ void load_tetromino(int columns, uint8_t tetris_state[][columns], struct tetromi
 
 
 //---------------------------------------
-// Function: load_J_tetromino
+// Function: init_J_tetromino
 //
-// Description: Create struct tetromino_location pointer with specific data for J Tetromino and call load_tetromino function
+// Description: Fill struct tetromino_location pointer with specific data for J Tetromino
 //
-// Input: int columns,
-//        uint8_t tetris_state[][columns]
+// Input: struct tetromino_location *t_loc_p
 //
 // Output: None
 //---------------------------------------
-void load_J_tetromino(int columns, uint8_t tetris_state[][columns]) {
+void init_J_tetromino(struct tetromino_location *t_loc_p) {
 	// Orientation = 0
 	// [B1][B2]
 	// [C]
@@ -649,9 +1268,9 @@ void load_J_tetromino(int columns, uint8_t tetris_state[][columns]) {
 	
 	
 	struct tetromino_location t_loc = {
-		rand() % 4, //orientation
+		TETRIS_RAND() % 4, //orientation
 		2, //entry_row
-		16,			//entry_column
+		TETRIS_ENTRY_ROW,			//entry_column
 		
 		{0, -1, 0, 1}, //c_b1_x
 		{1, 0, -1, 0}, //c_b1_y
@@ -664,23 +1283,41 @@ void load_J_tetromino(int columns, uint8_t tetris_state[][columns]) {
 			
 		0,0, 0,0, 0,0};
 
-	load_tetromino(columns, tetris_state, &t_loc);
+	*t_loc_p = t_loc;
 	
 }
 
 
 
+
 //---------------------------------------
-// Function: load_I_tetromino
+// Function: load_J_tetromino
 //
-// Description: Create struct tetromino_location pointer with specific data for I Tetromino and call load_tetromino function
+// Description: Create struct tetromino_location with specific data for J Tetromino and call load_tetromino function
 //
 // Input: int columns,
 //        uint8_t tetris_state[][columns]
 //
 // Output: None
 //---------------------------------------
-void load_I_tetromino(int columns, uint8_t tetris_state[][columns]) {
+void load_J_tetromino(int columns, uint8_t tetris_state[][columns]) {
+	struct tetromino_location t_loc;
+	init_J_tetromino(&t_loc);
+	load_tetromino(columns, tetris_state, &t_loc);
+}
+
+
+
+//---------------------------------------
+// Function: init_I_tetromino
+//
+// Description: Fill struct tetromino_location pointer with specific data for I Tetromino
+//
+// Input: struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_I_tetromino(struct tetromino_location *t_loc_p) {
 
 		// Orientation = 0
 		// [B1]
@@ -697,7 +1334,7 @@ void load_I_tetromino(int columns, uint8_t tetris_state[][columns]) {
 	struct tetromino_location t_loc = {
 			0, //orientation
 			2, //entry_row
-			16,			//entry_column
+			TETRIS_ENTRY_ROW,			//entry_column
 			
 			{0, -1, 0, 1}, //c_b1_x
 			{1, 0, -1, 0}, //c_b1_y
@@ -710,22 +1347,40 @@ void load_I_tetromino(int columns, uint8_t tetris_state[][columns]) {
 			
 		0,0, 0,0, 0,0};
 
-	load_tetromino(columns, tetris_state, &t_loc);
+	*t_loc_p = t_loc;
 	
 }
 
 
+
+
 //---------------------------------------
-// Function: load_O_tetromino
+// Function: load_I_tetromino
 //
-// Description: Create struct tetromino_location pointer with specific data for O Tetromino and call load_tetromino function
+// Description: Create struct tetromino_location with specific data for I Tetromino and call load_tetromino function
 //
 // Input: int columns,
 //        uint8_t tetris_state[][columns]
 //
 // Output: None
 //---------------------------------------
-void load_O_tetromino(int columns, uint8_t tetris_state[][columns]) {
+void load_I_tetromino(int columns, uint8_t tetris_state[][columns]) {
+	struct tetromino_location t_loc;
+	init_I_tetromino(&t_loc);
+	load_tetromino(columns, tetris_state, &t_loc);
+}
+
+
+//---------------------------------------
+// Function: init_O_tetromino
+//
+// Description: Fill struct tetromino_location pointer with specific data for O Tetromino
+//
+// Input: struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_O_tetromino(struct tetromino_location *t_loc_p) {
 	
 		// Orientation = 0
 		// [C ][B1]
@@ -738,9 +1393,9 @@ void load_O_tetromino(int columns, uint8_t tetris_state[][columns]) {
 		
 		
 	struct tetromino_location t_loc = {
-			rand() % 4, //orientation
+			TETRIS_RAND() % 4, //orientation
 			2, //entry_row
-			16,			//entry_column
+			TETRIS_ENTRY_ROW,			//entry_column
 			
 			{1, 0, -1, 0}, //c_b1_x
 			{0, 1, 0, -1}, //c_b1_y
@@ -753,7 +1408,7 @@ void load_O_tetromino(int columns, uint8_t tetris_state[][columns]) {
 			
 		0,0, 0,0, 0,0};
 
-	load_tetromino(columns, tetris_state, &t_loc);
+	*t_loc_p = t_loc;
 	
 	
 }
@@ -762,16 +1417,34 @@ void load_O_tetromino(int columns, uint8_t tetris_state[][columns]) {
 
 
 //---------------------------------------
-// Function: load_T_tetromino
+// Function: load_O_tetromino
 //
-// Description: Create struct tetromino_location pointer with specific data for T Tetromino and call load_tetromino function
+// Description: Create struct tetromino_location with specific data for O Tetromino and call load_tetromino function
 //
 // Input: int columns,
 //        uint8_t tetris_state[][columns]
 //
 // Output: None
 //---------------------------------------
-void load_T_tetromino(int columns, uint8_t tetris_state[][columns]) {
+void load_O_tetromino(int columns, uint8_t tetris_state[][columns]) {
+	struct tetromino_location t_loc;
+	init_O_tetromino(&t_loc);
+	load_tetromino(columns, tetris_state, &t_loc);
+}
+
+
+
+
+//---------------------------------------
+// Function: init_T_tetromino
+//
+// Description: Fill struct tetromino_location pointer with specific data for T Tetromino
+//
+// Input: struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_T_tetromino(struct tetromino_location *t_loc_p) {
 	
 		// Orientation = 0
 		// [B1][C ][B2]
@@ -784,9 +1457,9 @@ void load_T_tetromino(int columns, uint8_t tetris_state[][columns]) {
 		
 		
 	struct tetromino_location t_loc = {
-			rand() % 4, //orientation
+			TETRIS_RAND() % 4, //orientation
 			2, //entry_row
-			16,			//entry_column
+			TETRIS_ENTRY_ROW,			//entry_column
 			
 			{-1, 0, 1, 0}, //c_b1_x
 			{0, -1, 0, 1}, //c_b1_y
@@ -799,23 +1472,41 @@ void load_T_tetromino(int columns, uint8_t tetris_state[][columns]) {
 			
 		0,0, 0,0, 0,0};
 
-	load_tetromino(columns, tetris_state, &t_loc);
+	*t_loc_p = t_loc;
 	
 }
 
 
 
+
 //---------------------------------------
-// Function: load_S_tetromino
+// Function: load_T_tetromino
 //
-// Description: Create struct tetromino_location pointer with specific data for S Tetromino and call load_tetromino function
+// Description: Create struct tetromino_location with specific data for T Tetromino and call load_tetromino function
 //
 // Input: int columns,
 //        uint8_t tetris_state[][columns]
 //
 // Output: None
 //---------------------------------------
-void load_S_tetromino(int columns, uint8_t tetris_state[][columns]) {
+void load_T_tetromino(int columns, uint8_t tetris_state[][columns]) {
+	struct tetromino_location t_loc;
+	init_T_tetromino(&t_loc);
+	load_tetromino(columns, tetris_state, &t_loc);
+}
+
+
+
+//---------------------------------------
+// Function: init_S_tetromino
+//
+// Description: Fill struct tetromino_location pointer with specific data for S Tetromino
+//
+// Input: struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_S_tetromino(struct tetromino_location *t_loc_p) {
 		// Orientation = 0
 		//	   [B2][B1]
 		// [B3][C ]
@@ -827,9 +1518,9 @@ void load_S_tetromino(int columns, uint8_t tetris_state[][columns]) {
 		
 		
 	struct tetromino_location t_loc = {
-			rand() % 4, //orientation
+			TETRIS_RAND() % 4, //orientation
 			2, //entry_row
-			16,			//entry_column
+			TETRIS_ENTRY_ROW,			//entry_column
 			
 			{1, -1, -1, 1}, //c_b1_x
 			{1, 1, -1, -1}, //c_b1_y
@@ -842,7 +1533,7 @@ void load_S_tetromino(int columns, uint8_t tetris_state[][columns]) {
 			
 		0,0, 0,0, 0,0};//Block1, Block2, Block3
 		
-	load_tetromino(columns, tetris_state, &t_loc);
+	*t_loc_p = t_loc;
 	
 }
 
@@ -850,16 +1541,34 @@ void load_S_tetromino(int columns, uint8_t tetris_state[][columns]) {
 
 
 //---------------------------------------
-// Function: load_Z_tetromino
+// Function: load_S_tetromino
 //
-// Description: Create struct tetromino_location pointer with specific data for Z Tetromino and call load_tetromino function
+// Description: Create struct tetromino_location with specific data for S Tetromino and call load_tetromino function
 //
 // Input: int columns,
 //        uint8_t tetris_state[][columns]
 //
 // Output: None
 //---------------------------------------
-void load_Z_tetromino(int columns, uint8_t tetris_state[][columns]) {
+void load_S_tetromino(int columns, uint8_t tetris_state[][columns]) {
+	struct tetromino_location t_loc;
+	init_S_tetromino(&t_loc);
+	load_tetromino(columns, tetris_state, &t_loc);
+}
+
+
+
+
+//---------------------------------------
+// Function: init_Z_tetromino
+//
+// Description: Fill struct tetromino_location pointer with specific data for Z Tetromino
+//
+// Input: struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_Z_tetromino(struct tetromino_location *t_loc_p) {
 
 		// Orientation = 0
 		// [B1][B2]
@@ -872,9 +1581,9 @@ void load_Z_tetromino(int columns, uint8_t tetris_state[][columns]) {
 		
 		
 		struct tetromino_location t_loc = {
-			rand() % 4, //orientation
+			TETRIS_RAND() % 4, //orientation
 			2, //entry_row
-			16,			//entry_column
+			TETRIS_ENTRY_ROW,			//entry_column
 			
 			{-1, 1, 1, -1}, //c_b1_x
 			{1, 1, -1, -1}, //c_b1_y
@@ -887,26 +1596,44 @@ void load_Z_tetromino(int columns, uint8_t tetris_state[][columns]) {
 			
 		0,0, 0,0, 0,0};//Block1, Block2, Block3
 		
-		load_tetromino(columns, tetris_state, &t_loc);
+		*t_loc_p = t_loc;
 	
 }
 
 
 
 
-
-
 //---------------------------------------
-// Function: load_L_tetromino
+// Function: load_Z_tetromino
 //
-// Description: Create struct tetromino_location pointer with specific data for L Tetromino and call load_tetromino function
+// Description: Create struct tetromino_location with specific data for Z Tetromino and call load_tetromino function
 //
 // Input: int columns,
 //        uint8_t tetris_state[][columns]
 //
 // Output: None
 //---------------------------------------
-void load_L_tetromino(int columns, uint8_t tetris_state[][columns]) {
+void load_Z_tetromino(int columns, uint8_t tetris_state[][columns]) {
+	struct tetromino_location t_loc;
+	init_Z_tetromino(&t_loc);
+	load_tetromino(columns, tetris_state, &t_loc);
+}
+
+
+
+
+
+
+//---------------------------------------
+// Function: init_L_tetromino
+//
+// Description: Fill struct tetromino_location pointer with specific data for L Tetromino
+//
+// Input: struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_L_tetromino(struct tetromino_location *t_loc_p) {
 
 		// Orientation = 0
 		// [B2][B1]
@@ -919,9 +1646,9 @@ void load_L_tetromino(int columns, uint8_t tetris_state[][columns]) {
 		
 		
 		struct tetromino_location t_loc = {
-			rand() % 4, //orientation
+			TETRIS_RAND() % 4, //orientation
 			2, //entry_row
-			16,			//entry_column
+			TETRIS_ENTRY_ROW,			//entry_column
 			
 			{0, -1, 0, 1}, //c_b1_x
 			{1, 0, -1, 0}, //c_b1_y
@@ -934,15 +1661,32 @@ void load_L_tetromino(int columns, uint8_t tetris_state[][columns]) {
 			
 		0,0, 0,0, 0,0};
 		
-		struct tetromino_location *t_loc_p = &t_loc;
-		
-		load_tetromino(columns, tetris_state, t_loc_p);
+		*t_loc_p = t_loc;
 	
 }
 
 
 
 
+//---------------------------------------
+// Function: load_L_tetromino
+//
+// Description: Create struct tetromino_location with specific data for L Tetromino and call load_tetromino function
+//
+// Input: int columns,
+//        uint8_t tetris_state[][columns]
+//
+// Output: None
+//---------------------------------------
+void load_L_tetromino(int columns, uint8_t tetris_state[][columns]) {
+	struct tetromino_location t_loc;
+	init_L_tetromino(&t_loc);
+	load_tetromino(columns, tetris_state, &t_loc);
+}
+
+
+
+
 
 //---------------------------------------
 // Function: load_random_tetromino
@@ -956,7 +1700,7 @@ void load_L_tetromino(int columns, uint8_t tetris_state[][columns]) {
 // Output: None
 //---------------------------------------
 void load_random_tetromino(int columns, uint8_t tetris_state[][columns]) {
-	int rand_num = rand() % 7;
+	int rand_num = TETRIS_RAND() % TETROMINO_TYPES;
 	
 	switch(rand_num)
 	{
@@ -991,3 +1735,65 @@ void load_random_tetromino(int columns, uint8_t tetris_state[][columns]) {
 }
 
 
+
+
+//---------------------------------------
+// Function: init_tetromino
+//
+// Description: Fill struct tetromino_location for tetromino type (0-6, see TETROMINO_TYPES) without loading it
+//
+// Input: int type,
+//        struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_tetromino(int type, struct tetromino_location *t_loc_p) {
+	switch(type)
+	{
+		case 0:
+			init_I_tetromino(t_loc_p);
+			break;
+	
+		case 1:
+			init_O_tetromino(t_loc_p);
+			break;
+	
+		case 2:
+			init_T_tetromino(t_loc_p);
+			break;
+	
+		case 3:
+			init_S_tetromino(t_loc_p);
+			break;
+	
+		case 4:
+			init_Z_tetromino(t_loc_p);
+			break;
+	
+		case 5:
+			init_J_tetromino(t_loc_p);
+			break;
+	
+		case 6:
+			init_L_tetromino(t_loc_p);
+			break;
+	}	
+}
+
+
+
+
+
+
+//---------------------------------------
+// Function: init_random_tetromino
+//
+// Description: Fill struct tetromino_location pointer with specific data for a random Tetromino
+//
+// Input: struct tetromino_location *t_loc_p
+//
+// Output: None
+//---------------------------------------
+void init_random_tetromino(struct tetromino_location *t_loc_p) {
+	init_tetromino(TETRIS_RAND() % TETROMINO_TYPES, t_loc_p);
+}
@@ -0,0 +1,183 @@
+#ifndef _USART_H_
+#define _USART_H_
+
+//USART0 on PD0 (RXD) and PD1 (TXD)
+#define USART_BAUD 250000UL // Exact at 16 MHz (UBRR = 3), 40 us per byte
+#define USART_UBRR ((F_CPU / (16UL * USART_BAUD)) - 1)
+#define USART_RX_BUFFER_SIZE 32 // Power of two, up to 128
+#define USART_TX_BUFFER_SIZE 64 // Power of two, up to 128
+
+
+//Received bytes, pushed by USART_RX_vect and popped by USART_receive_byte.
+//USART0 only buffers 2 bytes, so without the interrupt bytes arriving during LCD writes or delays are lost
+RING_DEFINE(usart_rx, uint8_t, USART_RX_BUFFER_SIZE)
+static volatile uint8_t usart_rx_dropped = 0; // Bytes lost because usart_rx was full
+
+//Bytes to send, pushed by USART_send_byte and popped by USART_UDRE_vect, so sending does not wait for the wire
+RING_DEFINE(usart_tx, uint8_t, USART_TX_BUFFER_SIZE)
+
+
+
+
+//---------------------------------------
+// Function: setup_USART
+//
+// Description: Initialize USART0 for 8 data bits, no parity, 1 stop bit at USART_BAUD, with receive interrupt
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void setup_USART()
+{
+	UBRR0H = (uint8_t)(USART_UBRR >> 8);
+	UBRR0L = (uint8_t)USART_UBRR;
+	UCSR0A = 0x00; // Normal speed
+	UCSR0B = (1 << RXCIE0) | (1 << RXEN0) | (1 << TXEN0); // Enable receive interrupt, receiver and transmitter
+	UCSR0C = (1 << UCSZ01) | (1 << UCSZ00); // 8N1
+	sei();
+}
+
+
+
+
+
+//---------------------------------------
+// Function: USART_RX_vect
+//
+// Description: Push received byte into usart_rx
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+ISR(USART_RX_vect)
+{
+	uint8_t data = UDR0;
+
+	if (!usart_rx_push(data)) {
+		usart_rx_dropped++;
+	}
+}
+
+
+
+
+
+//---------------------------------------
+// Function: USART_UDRE_vect
+//
+// Description: Move next byte from usart_tx into the transmit buffer, or turn this interrupt off once usart_tx is empty
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+ISR(USART_UDRE_vect)
+{
+	uint8_t data;
+
+	if (usart_tx_pop(&data)) {
+		UDR0 = data;
+	}
+	else {
+		UCSR0B &= ~(1 << UDRIE0);
+	}
+}
+
+
+
+
+
+//---------------------------------------
+// Function: USART_send_byte
+//
+// Description: Queue byte in usart_tx, waiting only while it is full, and make sure USART_UDRE_vect is on.
+//              The read-modify-write of UCSR0B can race with USART_UDRE_vect turning UDRIE0 off, which at worst
+//              costs one extra interrupt that finds usart_tx empty
+//
+// Input: uint8_t
+// Output: None
+//
+//---------------------------------------
+void USART_send_byte(uint8_t data)
+{
+	while (!usart_tx_push(data)); // Spin while usart_tx is full, USART_UDRE_vect is emptying it
+	UCSR0B |= (1 << UDRIE0);
+}
+
+
+
+
+
+//---------------------------------------
+// Function: USART_receive_byte
+//
+// Description: Pop received byte from usart_rx without waiting
+//
+// Input: None
+// Output: int
+//		  -1 = No byte received
+//		  Otherwise received byte (0-255)
+//
+//---------------------------------------
+int USART_receive_byte()
+{
+	uint8_t data;
+
+	if (!usart_rx_pop(&data)) {
+		return -1;
+	}
+	return data;
+}
+
+
+
+
+
+//---------------------------------------
+// Function: USART_send_string
+//
+// Description: Send null terminated string
+//
+// Input: const char *
+// Output: None
+//
+//---------------------------------------
+void USART_send_string(const char *str)
+{
+	while (*str) {
+		USART_send_byte(*str++);
+	}
+}
+
+
+
+
+
+//---------------------------------------
+// Function: USART_send_number
+//
+// Description: Send unsigned number as decimal text
+//
+// Input: uint32_t
+// Output: None
+//
+//---------------------------------------
+void USART_send_number(uint32_t number)
+{
+	char digits[10];
+	uint8_t count = 0;
+
+	do {
+		digits[count++] = '0' + number % 10;
+		number /= 10;
+	} while (number);
+
+	while (count) {
+		USART_send_byte(digits[--count]);
+	}
+}
+
+
+#endif // _USART_H_
@@ -0,0 +1,427 @@
+#ifndef _VERSUS_H_
+#define _VERSUS_H_
+
+//Versus mode: two boards linked over USART0 (TXD of each board to RXD of the other, common GND)
+//
+//Every frame is 5 bytes:
+//  [VERSUS_SYNC] [type | game parity] [sequence] [payload] [CRC-8 of the 3 bytes before it]
+//Each board sends a TICK frame every tick. Its payload holds the garbage rows sent to the other
+//board (bits 0-2), the column left open in them (bits 3-4) and a topped out flag (bit 7).
+//Tick t only runs once the other board's frame for tick t - VERSUS_INPUT_DELAY is in, so the
+//boards stay within VERSUS_INPUT_DELAY ticks of each other and link latency shorter than that
+//never stalls the game. Garbage received is added before the next tetromino spawns.
+//A board left waiting for a frame (lost or corrupted) asks for it again with RESEND, and each
+//board keeps its last VERSUS_WINDOW TICK frames to answer with. Reset both boards together:
+//a board that restarts mid game starts on the wrong game parity.
+
+#define VERSUS_SYNC 0xA5
+#define VERSUS_HELLO 0x01 // Ready to start a game
+#define VERSUS_TICK 0x02
+#define VERSUS_PING 0x03 // Answered with PONG carrying the same sequence and payload
+#define VERSUS_PONG 0x04
+#define VERSUS_RESEND 0x05 // Ask for TICK frame sequence (of the game parity in the type byte) again
+#define VERSUS_TYPE_MASK 0x0F
+#define VERSUS_PARITY 0x80 // Game number & 1, frames left over from the last game are ignored
+
+#define VERSUS_GARBAGE_MASK 0x07
+#define VERSUS_HOLE_SHIFT 3
+#define VERSUS_TOPPED_OUT 0x80
+
+#define VERSUS_INPUT_DELAY 2 // Ticks
+#define VERSUS_WINDOW 8 // TICK frames kept each way, power of two larger than VERSUS_INPUT_DELAY
+#define VERSUS_HELLO_INTERVAL 20 // Milliseconds between HELLO frames while waiting for other board
+#define VERSUS_RESEND_INTERVAL 20 // Milliseconds between RESEND frames while waiting for a TICK frame
+
+
+//Garbage rows sent for 0-4 rows removed at once
+static const uint8_t versus_garbage_rows[5] = {0, 0, 1, 2, 4};
+
+
+//Struct to hold link state and statistics
+typedef struct versus_link {
+
+	uint8_t parity;
+	uint8_t hello_received;
+
+	uint8_t rx_count; // Bytes of current frame received after VERSUS_SYNC
+	uint8_t rx_frame[4];
+
+	uint8_t remote_valid[VERSUS_WINDOW];
+	uint8_t remote_sequence[VERSUS_WINDOW];
+	uint8_t remote_payload[VERSUS_WINDOW];
+
+	uint8_t sent_valid[VERSUS_WINDOW];
+	uint8_t sent_frame[VERSUS_WINDOW][3]; // Type, sequence and payload of TICK frames sent
+
+	uint8_t pong_received, pong_sequence;
+
+	uint8_t garbage_rows, garbage_hole; // Garbage to add before next tetromino
+	uint8_t remote_topped_out;
+
+	uint16_t frames_sent, frames_received, crc_errors, stalls, resends;
+
+} versus_link;
+
+static versus_link versus;
+
+
+
+
+//---------------------------------------
+// Function: versus_crc8
+//
+// Description: CRC-8 (polynomial 0x07) of length bytes
+//
+// Input: const uint8_t *data,
+//        uint8_t length
+// Output: uint8_t
+//
+//---------------------------------------
+uint8_t versus_crc8(const uint8_t *data, uint8_t length)
+{
+	uint8_t crc = 0;
+
+	while (length--) {
+		crc ^= *data++;
+		for (uint8_t i = 0; i < 8; i++) {
+			crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
+		}
+	}
+	return crc;
+}
+
+
+
+
+
+//---------------------------------------
+// Function: versus_send_raw
+//
+// Description: Send VERSUS_SYNC, the 3 frame bytes and their CRC
+//
+// Input: const uint8_t frame[] (type | parity, sequence, payload)
+// Output: None
+//
+//---------------------------------------
+void versus_send_raw(const uint8_t frame[])
+{
+	USART_send_byte(VERSUS_SYNC);
+	USART_send_byte(frame[0]);
+	USART_send_byte(frame[1]);
+	USART_send_byte(frame[2]);
+	USART_send_byte(versus_crc8(frame, 3));
+	versus.frames_sent++;
+}
+
+
+
+
+
+//---------------------------------------
+// Function: versus_send_frame
+//
+// Description: Send one frame of the current game to the other board. TICK frames are kept for RESEND
+//
+// Input: uint8_t type,
+//        uint8_t sequence,
+//        uint8_t payload
+// Output: None
+//
+//---------------------------------------
+void versus_send_frame(uint8_t type, uint8_t sequence, uint8_t payload)
+{
+	uint8_t frame[3] = {type | versus.parity, sequence, payload};
+
+	if (type == VERSUS_TICK) {
+		uint8_t slot = sequence & (VERSUS_WINDOW - 1);
+		versus.sent_valid[slot] = 1;
+		versus.sent_frame[slot][0] = frame[0];
+		versus.sent_frame[slot][1] = frame[1];
+		versus.sent_frame[slot][2] = frame[2];
+	}
+	versus_send_raw(frame);
+}
+
+
+
+
+
+//---------------------------------------
+// Function: versus_handle_frame
+//
+// Description: Act on a frame with a valid CRC
+//
+// Input: const uint8_t frame[] (type, sequence, payload)
+// Output: None
+//
+//---------------------------------------
+void versus_handle_frame(const uint8_t frame[])
+{
+	uint8_t type = frame[0] & VERSUS_TYPE_MASK;
+
+	versus.frames_received++;
+
+	if (type == VERSUS_PING) {
+		versus_send_frame(VERSUS_PONG, frame[1], frame[2]);
+	}
+	else if (type == VERSUS_PONG) {
+		versus.pong_received = 1;
+		versus.pong_sequence = frame[1];
+	}
+	else if (type == VERSUS_RESEND) {
+		// May be for the last game, if the other board is still finishing it
+		uint8_t slot = frame[1] & (VERSUS_WINDOW - 1);
+		if (versus.sent_valid[slot] && versus.sent_frame[slot][0] == (VERSUS_TICK | (frame[0] & VERSUS_PARITY)) &&
+		versus.sent_frame[slot][1] == frame[1]) {
+			versus_send_raw(versus.sent_frame[slot]);
+		}
+	}
+	else if ((frame[0] & VERSUS_PARITY) != versus.parity) {
+		return; // HELLO or TICK from the last game
+	}
+	else if (type == VERSUS_HELLO) {
+		versus.hello_received = 1;
+	}
+	else if (type == VERSUS_TICK) {
+		uint8_t slot = frame[1] & (VERSUS_WINDOW - 1);
+		versus.hello_received = 1; // Other board has started this game, even if its HELLO was lost
+		versus.remote_valid[slot] = 1;
+		versus.remote_sequence[slot] = frame[1];
+		versus.remote_payload[slot] = frame[2];
+	}
+}
+
+
+
+
+
+//---------------------------------------
+// Function: versus_receive
+//
+// Description: Read all bytes waiting in USART0 and handle every complete frame
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void versus_receive()
+{
+	int data;
+
+	while ((data = USART_receive_byte()) >= 0) {
+
+		if (versus.rx_count == 0) {
+			if (data == VERSUS_SYNC) {
+				versus.rx_count = 1;
+			}
+			continue;
+		}
+
+		if (versus.rx_count < 4) {
+			versus.rx_frame[versus.rx_count - 1] = data;
+			versus.rx_count++;
+			continue;
+		}
+
+		versus.rx_count = 0;
+		if (versus_crc8(versus.rx_frame, 3) == data) {
+			versus_handle_frame(versus.rx_frame);
+		}
+		else {
+			versus.crc_errors++; // Resynchronise on next VERSUS_SYNC
+		}
+	}
+}
+
+
+
+
+
+//---------------------------------------
+// Function: versus_start
+//
+// Description: Reset link for a new game and wait till the other board is ready for it too
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void versus_start()
+{
+	// Frames sent in the last game stay in sent_frame till overwritten, for RESEND
+	versus.parity ^= VERSUS_PARITY;
+	versus.hello_received = 0;
+	versus.garbage_rows = 0;
+	versus.remote_topped_out = 0;
+	for (uint8_t i = 0; i < VERSUS_WINDOW; i++) {
+		versus.remote_valid[i] = 0;
+	}
+
+	while (!versus.hello_received) {
+		versus_send_frame(VERSUS_HELLO, 0, 0);
+		for (uint8_t ms = 0; ms < VERSUS_HELLO_INTERVAL && !versus.hello_received; ms++) {
+			versus_receive();
+			_delay_ms(1);
+		}
+	}
+
+	versus_send_frame(VERSUS_HELLO, 0, 0); // Other board may have missed the ones sent before it was ready
+}
+
+
+
+
+
+//---------------------------------------
+// Function: versus_sync_tick
+//
+// Description: Send this board's TICK frame for tick and wait for the other board's frame for tick - VERSUS_INPUT_DELAY,
+//              asking for it again every VERSUS_RESEND_INTERVAL, then queue the garbage it carries
+//
+// Input: uint16_t tick,
+//        uint8_t payload
+// Output: None
+//
+//---------------------------------------
+void versus_sync_tick(uint16_t tick, uint8_t payload)
+{
+	PROFILE_BEGIN(PROFILE_LINK);
+
+	versus_send_frame(VERSUS_TICK, (uint8_t)tick, payload);
+	versus_receive();
+
+	if (tick < VERSUS_INPUT_DELAY) {
+		PROFILE_END(PROFILE_LINK);
+		return;
+	}
+
+	uint8_t sequence = (uint8_t)(tick - VERSUS_INPUT_DELAY);
+	uint8_t slot = sequence & (VERSUS_WINDOW - 1);
+
+	if (!(versus.remote_valid[slot] && versus.remote_sequence[slot] == sequence)) {
+		versus.stalls++;
+		for (uint16_t waited = 1; !(versus.remote_valid[slot] && versus.remote_sequence[slot] == sequence); waited++) {
+			_delay_us(100);
+			versus_receive();
+			if (waited % (VERSUS_RESEND_INTERVAL * 10) == 0) {
+				versus_send_frame(VERSUS_RESEND, sequence, 0);
+				versus.resends++;
+			}
+		}
+	}
+
+	uint8_t remote = versus.remote_payload[slot];
+	versus.remote_valid[slot] = 0;
+
+	if (remote & VERSUS_GARBAGE_MASK) {
+		versus.garbage_rows += remote & VERSUS_GARBAGE_MASK;
+		if (versus.garbage_rows > 4) {
+			versus.garbage_rows = 4;
+		}
+		versus.garbage_hole = (remote >> VERSUS_HOLE_SHIFT) & 0x03;
+	}
+	if (remote & VERSUS_TOPPED_OUT) {
+		versus.remote_topped_out = 1;
+	}
+
+	PROFILE_END(PROFILE_LINK);
+}
+
+
+
+
+
+//---------------------------------------
+// Function: versus_show_result
+//
+// Description: Show WIN or LOSE on LCD for 2 seconds
+//
+// Input: uint8_t win
+// Output: None
+//
+//---------------------------------------
+void versus_show_result(uint8_t win)
+{
+	const char *text = win ? "WIN" : "LOSE";
+
+	LCD_clear();
+	LCD_set_cursor(6, 0);
+	while (*text) {
+		LCD_data(*text++);
+	}
+	_delay_ms(2000);
+	LCD_clear();
+}
+
+
+
+
+
+//---------------------------------------
+// Function: Versus
+//
+// Description: Play one versus game: same as Tetris() with garbage rows exchanged with the other board every tick.
+//              Returns when either board tops out
+//
+// Input: None
+// Output: None
+//
+//---------------------------------------
+void Versus()
+{
+	uint8_t tetris_state[6][TETRIS_ROWS] = {{0x00}};
+	uint16_t tick = 0;
+
+	versus_start();
+
+	while(1) {
+
+		if (versus.garbage_rows) {
+			add_garbage_rows(TETRIS_ROWS, tetris_state, versus.garbage_rows, versus.garbage_hole);
+			versus.garbage_rows = 0;
+		}
+
+		struct tetromino_location t_loc;
+		init_random_tetromino(&t_loc);
+		update_tetromino_location_struct(&t_loc);
+
+		for (int i=TETRIS_TICKS_PER_TETROMINO;i>0;i--) {
+
+			int rc = tetris_tick(TETRIS_ROWS, tetris_state, &t_loc);
+			uint8_t payload = 0;
+
+			if ((rc != 0) | (i == 1)) {
+				// Tetromino finished, same check as Tetris()
+				payload = versus_garbage_rows[tetris_rows_removed] | ((TETRIS_RAND() & 0x03) << VERSUS_HOLE_SHIFT);
+				if ( (tetris_state[0][TETRIS_TOP_ROW] != 0x00) |
+				(tetris_state[1][TETRIS_TOP_ROW] != 0x00) |
+				(tetris_state[2][TETRIS_TOP_ROW] != 0x00) |
+				(tetris_state[3][TETRIS_TOP_ROW] != 0x00) ) {
+					payload |= VERSUS_TOPPED_OUT;
+				}
+			}
+
+			versus_sync_tick(tick++, payload);
+
+			if (payload & VERSUS_TOPPED_OUT) {
+				versus_show_result(0);
+				return;
+			}
+			if (versus.remote_topped_out) {
+				versus_show_result(1);
+				return;
+			}
+			if (rc != 0) {
+				break;
+			}
+			tetris_tick_wait(TETRIS_ROWS, tetris_state, &t_loc);
+		}
+#ifdef TETRIS_STACK_CHECK
+		stack_report();
+#endif
+	}
+}
+
+
+
+#endif // _VERSUS_H_
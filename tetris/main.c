@@ -16,9 +16,57 @@
 #include <util/delay.h>
 #include <time.h>
 #include <stdio.h>
-
+#include <stdlib.h>
+#ifdef TETRIS_SNAPSHOT
+#include <stddef.h>
+#include <avr/eeprom.h>
+#endif
+#ifdef TETRIS_AUTOPLAY
+#include <avr/pgmspace.h>
+#endif
+
+#if defined(TETRIS_VERSUS) && defined(TETRIS_SAMPLE)
+#error "TETRIS_SAMPLE dumps over USART0, which TETRIS_VERSUS uses for the link"
+#endif
+#if defined(TETRIS_VERSUS) && defined(TETRIS_BOOT_REPORT)
+#error "TETRIS_BOOT_REPORT sends its line over USART0, which TETRIS_VERSUS uses for the link"
+#endif
+
+#if defined(TETRIS_VERSUS) || defined(TETRIS_BOOT_REPORT) || defined(TETRIS_SAMPLE) || defined(TETRIS_BENCH)
+#define TETRIS_USART
+#endif
+
+#if defined(TETRIS_USART) || defined(TETRIS_INPUT_ISR) || defined(LCD_ASYNC) || defined(TETRIS_STACK_CHECK)
+#include <avr/interrupt.h>
+#endif
+
+#include "Ring.h"    //Contains single producer, single consumer rings shared between ISRs and the game loop
+#include "Profile.h" //Contains profiling markers, enabled with -DTETRIS_PROFILE
 #include "LCD1602.h" //Contains functions to communicate with LCD1602 display
+#ifdef TETRIS_USART
+#include "USART.h"  //Contains functions to send and receive bytes over USART0
+#endif
+#ifdef TETRIS_SAMPLE
+#include "Sampler.h" //Contains the Timer2 sampling profiler, dumped over USART0
+#endif
+#include "Boot.h"    //Contains boot phase timestamps, reported over USART0 with -DTETRIS_BOOT_REPORT
+#ifdef TETRIS_STACK_CHECK
+#include "Stack.h"  //Contains stack painting, high-water mark and guard zone check
+#endif
+#ifdef TETRIS_AUTOPLAY
+#include "PolicyTable.h" //Contains the placement policy played by -DTETRIS_AUTOPLAY, generated by host/policy_solver.c
+#endif
 #include "Tetris.h"  //Contains functions which controls Tetris data structures and logic
+#ifdef TETRIS_BENCH
+#include "Bench.h"  //Contains the benchmarks run when the joystick is held at power on
+#endif
+#ifdef TETRIS_SNAPSHOT
+#include "Snapshot.h" //Contains game snapshots saved to EEPROM and resumed after a power cut
+#endif
+
+#ifdef TETRIS_VERSUS
+#include "Versus.h" //Contains two player mode played against a second board over USART0
+#endif
 
 
 //---------------------------------------
@@ -31,25 +79,59 @@
 // Output: None
 //---------------------------------------
 void Tetris() {
+#ifdef TETRIS_SNAPSHOT
+	struct tetromino_location t_loc;
+	uint16_t score = 0, pieces = 0;
+	uint8_t type;
+#else
 	srand(time(NULL));
-	uint8_t tetris_state[6][19] = 
-	{{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,0x00,0x00,     0x00, 0x00,0x00,  },
-	 {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,0x00,0x00,     0x00, 0x00,0x00,  },
-	 {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,0x00,0x00,     0x00, 0x00,0x00,  },
-	 {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,0x00,0x00,     0x00, 0x00,0x00   },
-	
-	 {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,0x00,0x00,     0x00, 0x00,0x00,  },
-	 {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,0x00,0x00,     0x00, 0x00,0x00   }};
+#endif
+	uint8_t tetris_state[6][TETRIS_ROWS] = {{0x00}};
+
+#ifdef TETRIS_SNAPSHOT
+	if (snapshot_resume && snapshot_restore(&snapshot_saved, tetris_state, &t_loc) == 0) {
+		score = snapshot_saved.score; // Resume with the tetromino that was about to be loaded
+		pieces = snapshot_saved.pieces;
+		type = snapshot_saved.piece & 0x07;
+	}
+	else {
+		tetris_rand_state = time(NULL);
+		type = TETRIS_RAND() % TETROMINO_TYPES;
+		init_tetromino(type, &t_loc);
+	}
+	snapshot_resume = 0;
+#endif
 	
 	while(1) {
 		
-		load_random_tetromino(19,tetris_state);
-
-		if ( (tetris_state[0][15] != 0x00) |
-		(tetris_state[1][15] != 0x00) |
-		(tetris_state[2][15] != 0x00) |
-		(tetris_state[3][15] != 0x00) ) {
+#ifdef TETRIS_SNAPSHOT
+		if (pieces % SNAPSHOT_EVERY == 0) {
+			snapshot_take(&snapshot_saved, tetris_state, &t_loc, type, score, pieces);
+			snapshot_save(&snapshot_saved);
+		}
+		load_tetromino(TETRIS_ROWS, tetris_state, &t_loc);
+		score += tetris_rows_removed;
+		pieces++;
+		type = TETRIS_RAND() % TETROMINO_TYPES;
+		init_tetromino(type, &t_loc);
+#else
+		load_random_tetromino(TETRIS_ROWS,tetris_state);
+#endif
+#ifdef TETRIS_STACK_CHECK
+		stack_report();
+#endif
+#ifdef TETRIS_SAMPLE
+		sample_dump(); // Samples of the last tetromino
+#endif
+
+		if ( (tetris_state[0][TETRIS_TOP_ROW] != 0x00) |
+		(tetris_state[1][TETRIS_TOP_ROW] != 0x00) |
+		(tetris_state[2][TETRIS_TOP_ROW] != 0x00) |
+		(tetris_state[3][TETRIS_TOP_ROW] != 0x00) ) {
 			
+#ifdef TETRIS_SNAPSHOT
+			snapshot_erase(); // Game over: the next power on starts a new game
+#endif
 			return;
 		}
 
@@ -65,13 +147,43 @@ void Tetris() {
 
 int main(void)
 {
+ PROFILE_BEGIN(PROFILE_BOOT);
+#ifdef TETRIS_SAMPLE
+ sample_start(); //Start the sampling profiler, boot included
+#endif
+ BOOT_START(); // Start Timer1 for boot timestamps
  setup_AVR_ports(); // Setup Port B and C in Atmega328p
+ BOOT_TIMESTAMP(BOOT_PORTS);
  setup_ADC(); //Setup ADC with initial settings
+#ifdef TETRIS_ANALOG
+ joystick_calibrate(); //Learn joystick rest position and dead zone, the stick must be let go at power on
+#endif
+ BOOT_TIMESTAMP(BOOT_ADC);
  LCD_init(); // initialize LCD controller
+ BOOT_TIMESTAMP(BOOT_LCD);
  create_tetris_characters(); //Add 4 custom characters to CGRAM to be used for displaying Tetromino blocks
- _delay_ms(500); // wait
+ BOOT_TIMESTAMP(BOOT_GLYPHS);
+#ifdef LCD_ASYNC
+ LCD_async_start(); //Send all further LCD output from Timer0 interrupt
+#endif
+#ifdef TETRIS_USART
+ setup_USART(); //Setup USART0 for link to second board and boot report
+#endif
+ PROFILE_END(PROFILE_BOOT);
+#ifdef TETRIS_BENCH
+ if (bench_joystick_held()) {
+	bench_run(NULL); //Joystick held at power on: measure the hardware before the first game
+ }
+#endif
+#ifdef TETRIS_SNAPSHOT
+ snapshot_boot(); //Load the game to resume from EEPROM, unless the reset button was pressed
+#endif
 
  while(1){
+#ifdef TETRIS_VERSUS
+	Versus();
+#else
 	Tetris();		
+#endif
  }
 }
\ No newline at end of file